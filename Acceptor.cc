@@ -1,16 +1,24 @@
 #include "Acceptor.h"
 #include "Logger.h"
+#include "EventLoop.h"
 #include "InetAddress.h"
+#include "Metrics.h"
 
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <netinet/in.h>
 #include <errno.h>
+#include <fcntl.h>
 #include <unistd.h>
 
-static int createNonBlocking()
+static int openIdleFd()
 {
-    int sockfd = ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    return ::open("/dev/null", O_RDONLY | O_CLOEXEC);
+}
+
+static int createNonBlocking(sa_family_t family)
+{
+    int sockfd = ::socket(family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
     if (sockfd < 0) 
     {
         LOG_FATAL("%s:%s:%d listen socket create err:%d \n", __FILE__, __FUNCTION__, __LINE__, errno);
@@ -20,10 +28,22 @@ static int createNonBlocking()
 
 Acceptor::Acceptor(EventLoop *loop, const InetAddress &listenAddr, bool reusePort)
     : loop_(loop), 
-	acceptSocket_(createNonBlocking()), 
+	acceptSocket_(createNonBlocking(listenAddr.family())), 
 	acceptChannel_(loop, acceptSocket_.fd()),
-      listenning_(false)
+      listenning_(false),
+      idleFd_(openIdleFd()),
+      throttled_(false),
+      fdExhausted_(false),
+      retryDelay_(0.1),
+      batchSize_(kDefaultBatchSize),
+      incomingCpu_(-1)
 {
+    if (listenAddr.isUnixPath())
+    {
+        // 上次进程退出时留下的socket文件会导致bind失败
+        unixPath_ = listenAddr.unixPath();
+        ::unlink(unixPath_.c_str());
+    }
     acceptSocket_.setReuseAddr(true);
     acceptSocket_.setReusePort(true);
     acceptSocket_.bindAddress(listenAddr); // bind函数
@@ -34,40 +54,128 @@ Acceptor::Acceptor(EventLoop *loop, const InetAddress &listenAddr, bool reusePor
 
 Acceptor::~Acceptor()
 {
+    if (fdExhausted_)
+    {
+        loop_->cancel(retryTimer_);
+    }
     acceptChannel_.disableAll();
     acceptChannel_.remove();
+    if (!unixPath_.empty())
+    {
+        ::unlink(unixPath_.c_str());
+    }
+    if (idleFd_ >= 0)
+    {
+        ::close(idleFd_);
+    }
 }
 
 void Acceptor::listen()
 {
     listenning_ = true;
-    acceptSocket_.listen(); // listen
-    acceptChannel_.enableReading();
+    acceptSocket_.applyListenOptions(options_);
+    if (incomingCpu_ >= 0 && !acceptSocket_.setIncomingCpu(incomingCpu_))
+    {
+        LOG_ERROR("listen sockfd:%d set SO_INCOMING_CPU failed:%d \n", acceptSocket_.fd(), errno);
+    }
+    acceptSocket_.listen(options_.listenBacklog); // listen
+    updateAccepting();
+}
+
+void Acceptor::setThrottled(bool on)
+{
+    if (throttled_ != on)
+    {
+        throttled_ = on;
+        LOG_INFO("Acceptor fd=%d %s accepting: connection limit \n", acceptSocket_.fd(), on ? "pause" : "resume");
+        updateAccepting();
+    }
+}
+
+// 只有状态变化时才修改epoll中的注册
+void Acceptor::updateAccepting()
+{
+    bool on = accepting();
+    if (on && !acceptChannel_.isReading())
+    {
+        acceptChannel_.enableReading();
+    }
+    else if (!on && acceptChannel_.isReading())
+    {
+        acceptChannel_.disableReading();
+    }
+}
+
+void Acceptor::handleFdExhausted()
+{
+    // 用预留的描述符腾出位置，接受并立即关闭这个连接
+    if (idleFd_ >= 0)
+    {
+        ::close(idleFd_);
+        idleFd_ = ::accept(acceptSocket_.fd(), nullptr, nullptr);
+        if (idleFd_ >= 0)
+        {
+            ::close(idleFd_);
+        }
+        idleFd_ = openIdleFd();
+    }
+    if (fdExhausted_)
+    {
+        return;
+    }
+    // 只在进入暂停时打一次日志，而不是每个被拒绝的连接一条
+    LOG_ERROR("%s:%s:%d sockfd reached limit, pause accepting for %.3fs \n",
+              __FILE__, __FUNCTION__, __LINE__, retryDelay_);
+    fdExhausted_ = true;
+    updateAccepting();
+    retryTimer_ = loop_->runAfter(retryDelay_, [this]() {
+        fdExhausted_ = false;
+        updateAccepting();
+    });
 }
 
 // listenfd有事件发生了，即有新用户进行连接了，
+// 一次循环accept到EAGAIN或者batchSize_个连接，连接风暴时不必每个连接都经过一轮epoll_wait
 void Acceptor::handleRead()
 {
-    InetAddress peerAddr;
-    int connfd = acceptSocket_.accept(&peerAddr);
-    if (connfd >= 0)
+    for (int i = 0; i < batchSize_ && accepting(); ++i)
     {
-        if (newConnectionCb_) //newConnectionCb_由acceptor所在的TcpServer调用setNewConnectionCallback()函数进行设置
+        InetAddress peerAddr;
+        int connfd = acceptSocket_.accept(&peerAddr);
+        if (connfd >= 0)
         {
-            //newConnectionCb_被注册为TcpServer::newConnection
-            newConnectionCb_(connfd, peerAddr); // 轮询找到subLoop，唤醒分发当前新客户端的Channel
+            Metrics::add(Metrics::kConnectionsAccepted, 1);
+            if (newConnectionCb_) //newConnectionCb_由acceptor所在的TcpServer调用setNewConnectionCallback()函数进行设置
+            {
+                //newConnectionCb_被注册为TcpServer::newConnection
+                newConnectionCb_(connfd, peerAddr); // 轮询找到subLoop，唤醒分发当前新客户端的Channel
+            }
+            else
+            {
+                ::close(connfd);
+            }
+            continue;
         }
-        else
+
+        int saveErrno = errno;
+        if (saveErrno == EAGAIN) // accept队列已经取空
         {
-            ::close(connfd);
+            break;
         }
-    }
-    else
-    {
-        LOG_ERROR("%s:%s:%d accept err: %d \n", __FILE__, __FUNCTION__, __LINE__, errno);
-        if (errno == EMFILE) // 资源用完了
+        Metrics::add(Metrics::kAcceptErrors, 1);
+        if (saveErrno == EMFILE || saveErrno == ENFILE) // 资源用完了
         {
-            LOG_ERROR("%s:%s:%d sockfd reached limit \n", __FILE__, __FUNCTION__, __LINE__);
+            handleFdExhausted();
+            break;
+        }
+        if (saveErrno != ECONNABORTED && saveErrno != EINTR) // 对端在accept之前就断开了，继续取下一个
+        {
+            LOG_ERROR("%s:%s:%d accept err: %d \n", __FILE__, __FUNCTION__, __LINE__, saveErrno);
+            break;
         }
     }
-}
\ No newline at end of file
+    if (batchEndCb_)
+    {
+        batchEndCb_();
+    }
+}
@@ -3,16 +3,33 @@
 #include "noncopyable.h"
 #include "Socket.h"
 #include "Channel.h"
+#include "TimerId.h"
+#include "SocketOptions.h"
 
 #include <functional>
+#include <string>
+#include <vector>
 
 class EventLoop;
 class InetAddress;
 
+/**************************
+ * 监听socket是水平触发的，accept失败时如果什么都不做，同一个连接会被反复上报，loop空转占满CPU
+ * 文件描述符用完(EMFILE/ENFILE)时:
+ *   1. 关闭预留的idleFd_腾出一个描述符，accept这个连接后立即关闭，再重新打开idleFd_，
+ *      让对端马上收到关闭而不是一直等在accept队列里
+ *   2. 暂停监听socket上的读事件，retryDelay之后恢复
+ * 另外所属的TcpServer连接数到达上限时通过setThrottled暂停accept，新连接留在内核的accept队列中
+ * 以上接口都只能在loop线程中调用
+ **************************/
 class Acceptor : noncopyable
 {
 public:
     using NewConnectionCallback = std::function<void(int sockfd, const InetAddress &)>;
+    using BatchEndCallback = std::function<void()>;
+
+    static const int kDefaultBatchSize = 32;
+
     Acceptor(EventLoop *loop, const InetAddress &listenAddr, bool reusePort);
     ~Acceptor();
 
@@ -20,15 +37,49 @@ public:
     {
         newConnectionCb_ = cb;
     }
+    // 一次可读事件中accept完所有连接之后回调，TcpServer在这里把这批连接按subloop一次性分发出去
+    void setBatchEndCallback(const BatchEndCallback &cb) { batchEndCb_ = cb; }
+    // 一次可读事件中最多accept的连接数，1就是每个连接都经过一轮epoll_wait
+    void setBatchSize(int batchSize) { batchSize_ = batchSize > 0 ? batchSize : 1; }
+    // 监听socket的选项和backlog，需要在listen之前设置
+    void setSocketOptions(const SocketOptions &options) { options_ = options; }
+    // listen之前给监听socket设置SO_INCOMING_CPU，-1表示不设置(默认)
+    void setIncomingCpu(int cpu) { incomingCpu_ = cpu; }
+    // 见Socket::attachCpuSteeringProgram，需要在组里所有的socket都listen之后调用
+    bool attachCpuSteeringProgram(const std::vector<int> &listenerCpus)
+    {
+        return acceptSocket_.attachCpuSteeringProgram(listenerCpus);
+    }
+    // 描述符用完之后暂停accept的时间，默认0.1秒
+    void setRetryDelay(double seconds) { retryDelay_ = seconds; }
 
     bool listenning() const { return listenning_; }
     void listen();
+
+    // 是否暂停accept，到达连接数上限时由TcpServer设置
+    void setThrottled(bool on);
+    // 当前是否在监听新连接
+    bool accepting() const { return listenning_ && !throttled_ && !fdExhausted_; }
+
 private:
     void handleRead();
+    void handleFdExhausted();
+    void updateAccepting();
 
     EventLoop *loop_; // Acceptor用的就死用户定义的那个baseLoop，也称作mainLoop
     Socket acceptSocket_;
     Channel acceptChannel_;
     NewConnectionCallback newConnectionCb_;
+    BatchEndCallback batchEndCb_;
     bool listenning_;
+    std::string unixPath_; // 监听在文件系统路径上的Unix域socket，析构时删除
+
+    int idleFd_;         // 预留的描述符，描述符用完时用它腾出位置拒绝连接
+    bool throttled_;     // 连接数到达上限
+    bool fdExhausted_;   // 描述符用完，等待retryTimer_
+    double retryDelay_;
+    TimerId retryTimer_;
+    int batchSize_;
+    SocketOptions options_;
+    int incomingCpu_;
 };
\ No newline at end of file
@@ -0,0 +1,217 @@
+#include "AsyncLogging.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <chrono>
+
+static void writeStdout(const char *data, size_t len)
+{
+    while (len > 0)
+    {
+        ssize_t n = ::write(STDOUT_FILENO, data, len);
+        if (n < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            return; // 标准输出已经不可写，后台线程不能再写日志报告自己的错误
+        }
+        data += n;
+        len -= n;
+    }
+}
+
+AsyncLogging::AsyncLogging(double flushInterval, size_t bufferSize)
+    : flushInterval_(flushInterval),
+      bufferSize_(bufferSize),
+      policy_(kBlock),
+      maxBuffers_(16),
+      write_(writeStdout),
+      running_(false),
+      thread_(std::bind(&AsyncLogging::threadFunc, this), "AsyncLogging"),
+      currentBuffer_(new LogBuffer(bufferSize)),
+      nextBuffer_(new LogBuffer(bufferSize)),
+      flushRequested_(0),
+      flushCompleted_(0),
+      dropped_(0)
+{
+    buffers_.reserve(maxBuffers_);
+}
+
+AsyncLogging::~AsyncLogging()
+{
+    if (running_)
+    {
+        stop();
+    }
+}
+
+void AsyncLogging::start()
+{
+    running_ = true;
+    thread_.start();
+}
+
+void AsyncLogging::stop()
+{
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        running_ = false;
+        cond_.notify_one();
+        drained_.notify_all();
+    }
+    thread_.join();
+}
+
+AsyncLogging::BufferPtr AsyncLogging::newBuffer()
+{
+    if (!freeBuffers_.empty())
+    {
+        BufferPtr buffer = std::move(freeBuffers_.back());
+        freeBuffers_.pop_back();
+        return buffer;
+    }
+    return BufferPtr(new LogBuffer(bufferSize_));
+}
+
+void AsyncLogging::append(const char *line, size_t len)
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (currentBuffer_->avail() >= len)
+    {
+        ::memcpy(currentBuffer_->data.data() + currentBuffer_->len, line, len);
+        currentBuffer_->len += len;
+        return;
+    }
+
+    // 当前缓冲区写满，交给后台线程
+    while (buffers_.size() >= maxBuffers_ && running_)
+    {
+        if (policy_ == kDrop)
+        {
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        drained_.wait(lock);
+    }
+    if (!running_ && buffers_.size() >= maxBuffers_) // 后台线程没有运行，不能无限制地攒下去
+    {
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    buffers_.push_back(std::move(currentBuffer_));
+    if (nextBuffer_)
+    {
+        currentBuffer_ = std::move(nextBuffer_);
+    }
+    else
+    {
+        currentBuffer_ = newBuffer();
+    }
+    if (len > currentBuffer_->avail())
+    {
+        // 比整个缓冲区还长的一行截断保存，末尾仍然是换行
+        len = currentBuffer_->avail();
+        ::memcpy(currentBuffer_->data.data(), line, len - 1);
+        currentBuffer_->data[len - 1] = '\n';
+    }
+    else
+    {
+        ::memcpy(currentBuffer_->data.data(), line, len);
+    }
+    currentBuffer_->len = len;
+    cond_.notify_one();
+}
+
+void AsyncLogging::flush()
+{
+    // running_由stop在锁内修改，这里也要在锁内读
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (!running_)
+    {
+        return;
+    }
+    uint64_t ticket = ++flushRequested_;
+    cond_.notify_one();
+    while (flushCompleted_ < ticket && running_)
+    {
+        drained_.wait(lock);
+    }
+}
+
+void AsyncLogging::writeBuffers(const std::vector<BufferPtr> &buffers)
+{
+    for (const BufferPtr &buffer : buffers)
+    {
+        if (buffer->len > 0)
+        {
+            write_(buffer->data.data(), buffer->len);
+        }
+    }
+    uint64_t dropped = dropped_.exchange(0, std::memory_order_relaxed);
+    if (dropped > 0)
+    {
+        char msg[128];
+        int n = snprintf(msg, sizeof msg, "[ERROR] AsyncLogging dropped %llu log lines\n",
+                         static_cast<unsigned long long>(dropped));
+        write_(msg, n);
+    }
+    if (sinkFlush_)
+    {
+        sinkFlush_();
+    }
+}
+
+void AsyncLogging::threadFunc()
+{
+    std::vector<BufferPtr> buffersToWrite;
+    buffersToWrite.reserve(maxBuffers_ + 1);
+    bool running = true;
+    while (running)
+    {
+        uint64_t flushTicket;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            if (buffers_.empty() && flushRequested_ == flushCompleted_ && running_)
+            {
+                cond_.wait_for(lock, std::chrono::duration<double>(flushInterval_));
+            }
+            // 当前缓冲区不管满不满都换出来，前端马上换上备用缓冲区继续写
+            buffers_.push_back(std::move(currentBuffer_));
+            buffersToWrite.swap(buffers_);
+            currentBuffer_ = newBuffer();
+            if (!nextBuffer_)
+            {
+                nextBuffer_ = newBuffer();
+            }
+            flushTicket = flushRequested_;
+            running = running_;
+        }
+
+        writeBuffers(buffersToWrite); // 在锁外写
+
+        std::unique_lock<std::mutex> lock(mutex_);
+        for (BufferPtr &buffer : buffersToWrite)
+        {
+            // 最多保留两个备用缓冲区，突发流量过后多分配的内存要还给系统
+            if (freeBuffers_.size() < 2)
+            {
+                buffer->len = 0;
+                freeBuffers_.push_back(std::move(buffer));
+            }
+        }
+        buffersToWrite.clear();
+        flushCompleted_ = flushTicket;
+        drained_.notify_all();
+    }
+
+    // 最后一次换出之后前端可能还提交了日志
+    std::unique_lock<std::mutex> lock(mutex_);
+    buffers_.push_back(std::move(currentBuffer_));
+    writeBuffers(buffers_);
+    buffers_.clear();
+    currentBuffer_ = newBuffer();
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include "noncopyable.h"
+#include "Thread.h"
+
+#include <functional>
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+#include <stdint.h>
+
+/****************
+ * 异步日志后端(双缓冲):
+ * 前端线程在Logger中把整行格式化好，append只在锁内memcpy到当前缓冲区；
+ * 当前缓冲区写满后挂到待写队列，换上备用缓冲区继续写。
+ * 后台线程被唤醒或者每隔flushInterval秒把待写队列和当前缓冲区整体换出来，在锁外用大块write写到sink，
+ * 写完的缓冲区再还回来作为备用，稳定之后不再分配内存。
+ * 待写的缓冲区达到maxBuffers时按过载策略处理: kBlock阻塞写日志的线程直到后台写完，kDrop丢弃并计数
+ * 用法:
+ *     AsyncLogging async;
+ *     async.start();
+ *     Logger::instance().setOutput(std::bind(&AsyncLogging::append, &async, _1, _2));
+ *     Logger::instance().setFlush(std::bind(&AsyncLogging::flush, &async));
+ * *************/
+class AsyncLogging : noncopyable
+{
+public:
+    using WriteFunc = std::function<void(const char *data, size_t len)>;
+    using FlushFunc = std::function<void()>;
+
+    enum OverloadPolicy
+    {
+        kBlock,
+        kDrop,
+    };
+
+    static const size_t kBufferSize = 4 * 1024 * 1024;
+
+    explicit AsyncLogging(double flushInterval = 1.0, size_t bufferSize = kBufferSize);
+    ~AsyncLogging();
+
+    // 后台线程的输出目标，默认写到标准输出(fd 1)，需要在start之前设置
+    void setSink(const WriteFunc &write, const FlushFunc &flush = FlushFunc())
+    {
+        write_ = write;
+        sinkFlush_ = flush;
+    }
+    // 需要在start之前设置
+    void setOverloadPolicy(OverloadPolicy policy, size_t maxBuffers = 16)
+    {
+        policy_ = policy;
+        maxBuffers_ = maxBuffers;
+    }
+
+    void start();
+    // 写完已经提交的日志后退出后台线程
+    void stop();
+
+    // 前端接口，可以在任意线程中调用
+    void append(const char *line, size_t len);
+    // 阻塞到调用之前提交的日志都交给sink之后返回，用于FATAL退出之前
+    void flush();
+
+    uint64_t droppedLines() const { return dropped_.load(std::memory_order_relaxed); }
+
+private:
+    struct LogBuffer
+    {
+        explicit LogBuffer(size_t size) : data(size), len(0) {}
+        size_t avail() const { return data.size() - len; }
+        std::vector<char> data;
+        size_t len;
+    };
+    using BufferPtr = std::unique_ptr<LogBuffer>;
+
+    void threadFunc();
+    BufferPtr newBuffer();
+    void writeBuffers(const std::vector<BufferPtr> &buffers);
+
+    const double flushInterval_;
+    const size_t bufferSize_;
+    OverloadPolicy policy_;
+    size_t maxBuffers_;
+    WriteFunc write_;
+    FlushFunc sinkFlush_;
+    bool running_;
+    Thread thread_;
+
+    std::mutex mutex_;
+    std::condition_variable cond_;     // 通知后台线程有写满的缓冲区或者flush请求
+    std::condition_variable drained_;  // 通知前端后台线程写完了一批
+    BufferPtr currentBuffer_;
+    BufferPtr nextBuffer_;
+    std::vector<BufferPtr> buffers_;   // 写满待写的缓冲区
+    std::vector<BufferPtr> freeBuffers_; // 后台写完还回来的缓冲区
+    uint64_t flushRequested_;
+    uint64_t flushCompleted_;
+    std::atomic<uint64_t> dropped_;
+};
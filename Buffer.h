@@ -4,6 +4,7 @@
 #include <vector>
 #include <string>
 #include <algorithm>
+#include <utility>
 
 // 网络库底层的缓冲器类型定义
 class Buffer
@@ -19,6 +20,13 @@ public:
     {
     }
 
+    void swap(Buffer &rhs)
+    {
+        buffer_.swap(rhs.buffer_);
+        std::swap(readerIndex_, rhs.readerIndex_);
+        std::swap(writerIndex_, rhs.writerIndex_);
+    }
+
     size_t readAbleBytes() const
     {
         return writerIndex_ - readerIndex_;
@@ -34,6 +42,12 @@ public:
         return readerIndex_;
     }
 
+    // 底层数组实际占用的内存
+    size_t internalCapacity() const
+    {
+        return buffer_.capacity();
+    }
+
     // 返回缓冲区中可读数据的起始地址
     const char *peek() const
     {
@@ -93,6 +107,14 @@ public:
         writerIndex_ += len;
     }
 
+    // 在可读数据之前写入len字节，len不能超过prependAbleBytes()，kCheapPrepend预留的空间就是给消息头用的
+    void prepend(const void *data, size_t len)
+    {
+        readerIndex_ -= len;
+        const char *d = static_cast<const char *>(data);
+        std::copy(d, d + len, begin() + readerIndex_);
+    }
+
     char *beginWrite()
     {
         return begin() + writerIndex_;
@@ -102,6 +124,12 @@ public:
         return begin() + writerIndex_;
     }
 
+    // 直接往beginWrite()写入len字节数据之后调用
+    void hasWritten(size_t len)
+    {
+        writerIndex_ += len;
+    }
+
     // 从fd文件描述符上读取数据
     ssize_t readFd(int fd, int *saveErrno);
     // 通过fd发送数据
@@ -14,4 +14,5 @@ using WriteCompleteCallback = std::function<void(const TcpConnectionPtr &)>;
 using MessageCallback = std::function<void(const TcpConnectionPtr &,
  Buffer *, 
  TimeStamp)>;
-using HighWaterMarkCallback = std::function<void(const TcpConnectionPtr &, size_t)>;
\ No newline at end of file
+using HighWaterMarkCallback = std::function<void(const TcpConnectionPtr &, size_t)>;
+using LowWaterMarkCallback = std::function<void(const TcpConnectionPtr &, size_t)>;
\ No newline at end of file
@@ -65,7 +65,7 @@ void Channel::handleEvent(TimeStamp receiveTime)
 // 根据epoller通知的channel发生的具体事件，由channel负责调用具体的回调函数
 void Channel::handleEventWithGuard(TimeStamp receiveTime)
 {
-    LOG_INFO("channel handleEvents revents:%d\n", revents_);
+    LOG_DEBUG("channel handleEvents revents:%d\n", revents_);
     // 发生异常了
     if ((revents_ & EPOLLHUP) && !(revents_ & EPOLLIN))
     {
@@ -75,6 +75,7 @@ void Channel::handleEventWithGuard(TimeStamp receiveTime)
         }
     }
 
+    // 开启MSG_ZEROCOPY的连接，其发送完成通知也是通过EPOLLERR上报的，由errorCallback_读取错误队列
     if (revents_ & EPOLLERR)
     {
         if (errorCallback_)
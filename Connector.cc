@@ -0,0 +1,216 @@
+#include "Connector.h"
+#include "Channel.h"
+#include "EventLoop.h"
+#include "Logger.h"
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <algorithm>
+
+const int Connector::kMaxRetryDelayMs;
+const int Connector::kInitRetryDelayMs;
+
+static int getSocketError(int sockfd)
+{
+    int optval;
+    socklen_t optlen = sizeof optval;
+    if (::getsockopt(sockfd, SOL_SOCKET, SO_ERROR, &optval, &optlen) < 0)
+    {
+        return errno;
+    }
+    return optval;
+}
+
+// 连接本机上没有监听的临时端口时，可能连上自己(源端口恰好等于目的端口)
+static bool isSelfConnect(int sockfd)
+{
+    sockaddr_in local, peer;
+    socklen_t len = sizeof local;
+    ::memset(&local, 0, sizeof local);
+    ::memset(&peer, 0, sizeof peer);
+    ::getsockname(sockfd, (sockaddr *)&local, &len);
+    len = sizeof peer;
+    ::getpeername(sockfd, (sockaddr *)&peer, &len);
+    return local.sin_port == peer.sin_port && local.sin_addr.s_addr == peer.sin_addr.s_addr;
+}
+
+Connector::Connector(EventLoop *loop, const InetAddress &serverAddr)
+    : loop_(loop),
+      serverAddr_(serverAddr),
+      connect_(false),
+      state_(kDisconnected),
+      retryDelayMs_(kInitRetryDelayMs)
+{
+}
+
+Connector::~Connector()
+{
+    if (channel_)
+    {
+        LOG_ERROR("Connector::dtor fd=%d still connecting \n", channel_->fd());
+    }
+}
+
+void Connector::start()
+{
+    connect_ = true;
+    loop_->runInLoop(std::bind(&Connector::startInLoop, shared_from_this()));
+}
+
+void Connector::startInLoop()
+{
+    if (connect_ && state_ == kDisconnected)
+    {
+        connect();
+    }
+}
+
+void Connector::stop()
+{
+    connect_ = false;
+    loop_->queueInLoop(std::bind(&Connector::stopInLoop, shared_from_this()));
+}
+
+void Connector::stopInLoop()
+{
+    loop_->cancel(retryTimer_);
+    if (state_ == kConnecting)
+    {
+        setState(kDisconnected);
+        ::close(removeAndResetChannel());
+    }
+}
+
+void Connector::restart()
+{
+    setState(kDisconnected);
+    retryDelayMs_ = kInitRetryDelayMs;
+    connect_ = true;
+    startInLoop();
+}
+
+void Connector::connect()
+{
+    int sockfd = ::socket(serverAddr_.family(), SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (sockfd < 0)
+    {
+        LOG_FATAL("%s:%s:%d socket create err:%d \n", __FILE__, __FUNCTION__, __LINE__, errno);
+    }
+    int ret = ::connect(sockfd, serverAddr_.sockAddr(), serverAddr_.sockAddrLen());
+    int savedErrno = (ret == 0) ? 0 : errno;
+    switch (savedErrno)
+    {
+    case 0:
+    case EINPROGRESS:
+    case EINTR:
+    case EISCONN:
+        connecting(sockfd);
+        break;
+
+    case EAGAIN: // 本地临时端口用完了
+    case EADDRINUSE:
+    case EADDRNOTAVAIL:
+    case ECONNREFUSED:
+    case ENETUNREACH:
+    case ENOENT: // Unix域socket文件还没有创建
+        retry(sockfd);
+        break;
+
+    default:
+        LOG_ERROR("Connector::connect to %s error %d \n", serverAddr_.toIpPort().c_str(), savedErrno);
+        ::close(sockfd);
+        break;
+    }
+}
+
+// 等待socket可写，可写说明connect已经有了结果
+void Connector::connecting(int sockfd)
+{
+    setState(kConnecting);
+    channel_.reset(new Channel(loop_, sockfd));
+    channel_->setWriteCallback(std::bind(&Connector::handleWrite, this));
+    channel_->setErrorCallback(std::bind(&Connector::handleError, this));
+    channel_->enableWriting();
+}
+
+int Connector::removeAndResetChannel()
+{
+    channel_->disableAll();
+    channel_->remove();
+    int sockfd = channel_->fd();
+    // 当前正处在channel_的回调中，不能在这里直接释放
+    loop_->queueInLoop(std::bind(&Connector::resetChannel, shared_from_this()));
+    return sockfd;
+}
+
+void Connector::resetChannel()
+{
+    channel_.reset();
+}
+
+void Connector::handleWrite()
+{
+    if (state_ != kConnecting)
+    {
+        return;
+    }
+    int sockfd = removeAndResetChannel();
+    int err = getSocketError(sockfd);
+    if (err)
+    {
+        LOG_ERROR("Connector::handleWrite connect to %s error %d \n", serverAddr_.toIpPort().c_str(), err);
+        retry(sockfd);
+    }
+    else if (!serverAddr_.isUnix() && isSelfConnect(sockfd))
+    {
+        LOG_ERROR("Connector::handleWrite self connect \n");
+        retry(sockfd);
+    }
+    else
+    {
+        setState(kConnected);
+        if (connect_)
+        {
+            newConnectionCallback_(sockfd);
+        }
+        else
+        {
+            ::close(sockfd);
+        }
+    }
+}
+
+void Connector::handleError()
+{
+    if (state_ == kConnecting)
+    {
+        int sockfd = removeAndResetChannel();
+        LOG_ERROR("Connector::handleError SO_ERROR=%d \n", getSocketError(sockfd));
+        retry(sockfd);
+    }
+}
+
+void Connector::retry(int sockfd)
+{
+    ::close(sockfd);
+    setState(kDisconnected);
+    if (connect_)
+    {
+        LOG_INFO("Connector::retry connecting to %s in %d ms \n",
+                 serverAddr_.toIpPort().c_str(), retryDelayMs_);
+        // 定时器持有weak_ptr，Connector销毁后不再重试
+        std::weak_ptr<Connector> weakSelf(shared_from_this());
+        retryTimer_ = loop_->runAfter(retryDelayMs_ / 1000.0, [weakSelf]()
+                                      {
+                                          std::shared_ptr<Connector> self = weakSelf.lock();
+                                          if (self)
+                                          {
+                                              self->startInLoop();
+                                          }
+                                      });
+        retryDelayMs_ = std::min(retryDelayMs_ * 2, kMaxRetryDelayMs);
+    }
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "noncopyable.h"
+#include "InetAddress.h"
+#include "TimerId.h"
+
+#include <functional>
+#include <memory>
+#include <atomic>
+
+class Channel;
+class EventLoop;
+
+/**************************
+ * 主动发起连接，供TcpClient使用
+ * 非阻塞connect之后把socket注册到loop上等待可写，连接成功后把sockfd交给newConnectionCallback_；
+ * 失败时按指数退避(从kInitRetryDelayMs开始翻倍，最多kMaxRetryDelayMs)定时重试
+ **************************/
+class Connector : noncopyable, public std::enable_shared_from_this<Connector>
+{
+public:
+    using NewConnectionCallback = std::function<void(int sockfd)>;
+
+    static const int kMaxRetryDelayMs = 30 * 1000;
+    static const int kInitRetryDelayMs = 500;
+
+    Connector(EventLoop *loop, const InetAddress &serverAddr);
+    ~Connector();
+
+    void setNewConnectionCallback(const NewConnectionCallback &cb) { newConnectionCallback_ = cb; }
+
+    void start();   // 可以在任意线程中调用
+    void restart(); // 只能在loop线程中调用，退避时间从头开始
+    void stop();    // 可以在任意线程中调用
+
+    const InetAddress &serverAddress() const { return serverAddr_; }
+
+private:
+    enum States
+    {
+        kDisconnected,
+        kConnecting,
+        kConnected,
+    };
+
+    void setState(States s) { state_ = s; }
+    void startInLoop();
+    void stopInLoop();
+    void connect();
+    void connecting(int sockfd);
+    void handleWrite();
+    void handleError();
+    void retry(int sockfd);
+    int removeAndResetChannel();
+    void resetChannel();
+
+    EventLoop *loop_;
+    InetAddress serverAddr_;
+    std::atomic_bool connect_; // 是否需要连接，stop之后不再重试
+    std::atomic_int state_;
+    std::unique_ptr<Channel> channel_; // 只在connect进行中存在
+    NewConnectionCallback newConnectionCallback_;
+    int retryDelayMs_;
+    TimerId retryTimer_;
+};
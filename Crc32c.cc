@@ -0,0 +1,91 @@
+#include "Crc32c.h"
+
+#include <string.h>
+
+#if defined(__x86_64__)
+#include <nmmintrin.h>
+#endif
+
+namespace Crc32c
+{
+    namespace
+    {
+        const uint32_t kPolynomial = 0x82F63B78; // Castagnoli多项式的反射形式
+
+        struct Table
+        {
+            uint32_t entries[256];
+            Table()
+            {
+                for (uint32_t i = 0; i < 256; ++i)
+                {
+                    uint32_t crc = i;
+                    for (int bit = 0; bit < 8; ++bit)
+                    {
+                        crc = (crc & 1) ? (crc >> 1) ^ kPolynomial : crc >> 1;
+                    }
+                    entries[i] = crc;
+                }
+            }
+        };
+
+        uint32_t extendSoftware(uint32_t crc, const char *data, size_t n)
+        {
+            static const Table table;
+            const unsigned char *p = reinterpret_cast<const unsigned char *>(data);
+            uint32_t c = ~crc;
+            while (n-- > 0)
+            {
+                c = table.entries[(c ^ *p++) & 0xff] ^ (c >> 8);
+            }
+            return ~c;
+        }
+
+#if defined(__x86_64__)
+        // 只给这个函数打开SSE4.2，整个库仍然可以在不支持的CPU上运行
+        __attribute__((target("sse4.2"))) uint32_t extendHardware(uint32_t crc, const char *data, size_t n)
+        {
+            uint64_t c = ~crc;
+            while (n >= 8)
+            {
+                uint64_t word;
+                ::memcpy(&word, data, sizeof word);
+                c = _mm_crc32_u64(c, word);
+                data += 8;
+                n -= 8;
+            }
+            uint32_t c32 = static_cast<uint32_t>(c);
+            while (n-- > 0)
+            {
+                c32 = _mm_crc32_u8(c32, static_cast<unsigned char>(*data++));
+            }
+            return ~c32;
+        }
+#endif
+
+        typedef uint32_t (*ExtendFunc)(uint32_t, const char *, size_t);
+
+        ExtendFunc chooseExtend()
+        {
+#if defined(__x86_64__)
+            if (__builtin_cpu_supports("sse4.2"))
+            {
+                return extendHardware;
+            }
+#endif
+            return extendSoftware;
+        }
+
+        const ExtendFunc kExtend = chooseExtend();
+    }
+
+    uint32_t extend(uint32_t crc, const char *data, size_t n)
+    {
+        return kExtend(crc, data, n);
+    }
+
+    bool hardwareAccelerated()
+    {
+        return kExtend != extendSoftware;
+    }
+}
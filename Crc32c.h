@@ -0,0 +1,19 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+// CRC32C(Castagnoli)校验，支持SSE4.2的CPU上用crc32指令计算，否则查表计算
+namespace Crc32c
+{
+    // 在crc的基础上继续计算[data, data+n)，crc为0表示从头开始
+    uint32_t extend(uint32_t crc, const char *data, size_t n);
+
+    inline uint32_t value(const char *data, size_t n)
+    {
+        return extend(0, data, n);
+    }
+
+    // 当前CPU是否使用了硬件指令
+    bool hardwareAccelerated();
+}
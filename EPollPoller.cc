@@ -2,6 +2,7 @@
 #include "Logger.h"
 #include "Channel.h"
 #include "TimeStamp.h"
+#include "Metrics.h"
 
 #include <memory.h>
 #include <unistd.h>
@@ -32,16 +33,18 @@ EPoller::~EPoller()
 // 重写基类Poller的抽象方法
 TimeStamp EPoller::poll(int timeoutMs, ChannelLists *activeChannels)
 {
-    // 实际上应该用LOG_DEBUG输出日志更为合理
-    LOG_INFO("func=%s => fd total count:%lu \n", __FUNCTION__, channelsMap_.size());
+    // 每次poll和每个事件都会经过这里，只在DEBUG级别输出
+    LOG_DEBUG("func=%s => fd total count:%lu \n", __FUNCTION__, channelsMap_.size());
 
     // &*events_.begin() 获取vector数组首元素的地址
     int numEvents = ::epoll_wait(epollfd_, &*events_.begin(), static_cast<int>(events_.size()), timeoutMs);
     int saveErrno = errno;
     TimeStamp now(TimeStamp::now());
+    Metrics::add(Metrics::kEpollWakeups, 1);
     if (numEvents > 0)
     {
-        LOG_INFO("%d events hanppened \n", numEvents);
+        Metrics::add(Metrics::kEpollEvents, numEvents);
+        LOG_DEBUG("%d events hanppened \n", numEvents);
         fillActiveChannels(numEvents, activeChannels);
         // 由于此处采用的是LT模式，未处理的事件会不断上报，直到事件被处理。
         // 此处numEvent等于event_.size()时就需要对event_进行手动扩容了
@@ -74,7 +77,7 @@ TimeStamp EPoller::poll(int timeoutMs, ChannelLists *activeChannels)
 void EPoller::updateChannel(Channel *ch)
 {
     const int index = ch->index(); // index对应于三个状态：kNew、kAdded和kDelete
-    LOG_INFO("func=%s => fd=%d events=%d index=%d \n", __FUNCTION__, ch->fd(), ch->events(), index);
+    LOG_DEBUG("func=%s => fd=%d events=%d index=%d \n", __FUNCTION__, ch->fd(), ch->events(), index);
 
     if (index == kNew || index == kDelete)
     {
@@ -106,7 +109,7 @@ void EPoller::removeChannel(Channel *ch)
 {
     int fd = ch->fd();
     channelsMap_.erase(fd);
-    LOG_INFO("func=%s => fd=%d \n", __FUNCTION__, fd);
+    LOG_DEBUG("func=%s => fd=%d \n", __FUNCTION__, fd);
 
     int index = ch->index();
     if (index == kAdded)
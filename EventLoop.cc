@@ -2,6 +2,9 @@
 #include "Logger.h"
 #include "Poller.h"
 #include "Channel.h"
+#include "TimerQueue.h"
+#include "LatencyStats.h"
+#include "Metrics.h"
 
 #include <sys/eventfd.h>
 #include <unistd.h>
@@ -30,9 +33,13 @@ EventLoop::EventLoop()
       quit_(false),
       callingPendingFunctors_(false),
       threadId_(CurrentThread::tid()),
+      pollReturnNanos_(0),
+      latencyTracing_(false),
+      latencyStats_(new LatencyStats()),
       poller_(Poller::newDefaultPoller(this)),
       wakeupFd_(createEventfd()),
-      wakeupChannel_(new Channel(this, wakeupFd_))
+      wakeupChannel_(new Channel(this, wakeupFd_)),
+      timerQueue_(new TimerQueue(this))
 {
     LOG_DEBUG("EventLoop Created %p in thread %d \n", this, threadId_);
     if (t_loopInThisThread)
@@ -71,6 +78,7 @@ void EventLoop::loop()
         activeChannels_.clear();
         // poller_ 监听两类fd：一种是clientFd，另一种是weakupFd
         pollReturnTime_ = poller_->poll(kPollTimeMs, &activeChannels_);
+        pollReturnNanos_ = latencyTracing_.load(std::memory_order_relaxed) ? LatencyStats::nowNanos() : 0;
         for (auto channel : activeChannels_)
         {
             // poller监听哪些channel发生了事件，然后上报给EventLoop，通知channel处理相应的事件
@@ -84,6 +92,8 @@ void EventLoop::loop()
         执行之前mainloop注册的回调操作
         **/
         doPendingFunctors();
+        // 本轮事件处理和回调中合并起来的写操作在这里统一发送
+        doIterationEndFunctors();
     }
 
     LOG_INFO("EventLoop %p stop looping. \n", this);
@@ -117,7 +127,7 @@ void EventLoop::runInLoop(Functor cb)
     }
     else // 在非当前loop线程中执行cb，就需要唤醒loop所在线程并执行cb
     {
-        queueInLoop(cb);
+        queueInLoop(std::move(cb)); // cb可能捕获了大块数据(如send(std::string &&)),移动而不是拷贝
     }
 }
 
@@ -126,8 +136,9 @@ void EventLoop::queueInLoop(Functor cb)
 {
     {
         std::unique_lock<std::mutex> lock(mutex_);
-        pendingsFunctors_.emplace_back(cb);
+        pendingsFunctors_.emplace_back(std::move(cb));
     }
+    Metrics::add(Metrics::kPendingFunctors, 1);
     // 唤醒相应的 需要执行上面回调操作的loop线程了
     //||callingPendingFunctors_作用：当前loop正在执行回调，但是loop又有了新的回调，因此需要重新唤醒一次
     if (!isInLoopThread() || callingPendingFunctors_)
@@ -136,6 +147,28 @@ void EventLoop::queueInLoop(Functor cb)
     }
 }
 
+void EventLoop::runAtIterationEnd(Functor cb)
+{
+    iterationEndFunctors_.emplace_back(std::move(cb));
+}
+
+TimerId EventLoop::runAfter(double delay, Functor cb)
+{
+    int64_t when = Timer::now() + static_cast<int64_t>(delay * Timer::kMicroSecondsPerSecond);
+    return timerQueue_->addTimer(std::move(cb), when, 0.0);
+}
+
+TimerId EventLoop::runEvery(double interval, Functor cb)
+{
+    int64_t when = Timer::now() + static_cast<int64_t>(interval * Timer::kMicroSecondsPerSecond);
+    return timerQueue_->addTimer(std::move(cb), when, interval);
+}
+
+void EventLoop::cancel(TimerId timerId)
+{
+    timerQueue_->cancel(timerId);
+}
+
 void EventLoop::handleRead()
 {
     uint64_t one = 1;
@@ -185,10 +218,26 @@ void EventLoop::doPendingFunctors() // 执行回调,注册回调由TCPServer类
         std::unique_lock<std::mutex> lock(mutex_);
         functors.swap(pendingsFunctors_);
     }
+    Metrics::add(Metrics::kPendingFunctors, -static_cast<int64_t>(functors.size()));
 
     for (const Functor &functor : functors)
     {
         functor(); // 执行当前loop需要执行的回调操作
     }
     callingPendingFunctors_ = false;
+}
+
+void EventLoop::doIterationEndFunctors()
+{
+    std::vector<Functor> functors;
+    functors.swap(iterationEndFunctors_);
+
+    // 这里queueInLoop的回调(如writeCompleteCallback_)要到下一轮才执行，
+    // 置位callingPendingFunctors_让queueInLoop唤醒loop，避免阻塞在poll里
+    callingPendingFunctors_ = true;
+    for (const Functor &functor : functors)
+    {
+        functor();
+    }
+    callingPendingFunctors_ = false;
 }
\ No newline at end of file
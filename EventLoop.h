@@ -3,6 +3,7 @@
 #include "noncopyable.h"
 #include "TimeStamp.h"
 #include "CurrentThread.h"
+#include "TimerId.h"
 
 #include <functional>
 #include <vector>
@@ -13,6 +14,8 @@
 // 前置声明
 class Channel;
 class Poller;
+class TimerQueue;
+class LatencyStats;
 
 // 事件循环类 主要包含了两个模块Channel 和Poller（epoll的抽象） 一个线程一个Loop
 class EventLoop : public noncopyable
@@ -29,11 +32,27 @@ public:
     void quit();
 
     // 在当前loop中循环cb，供运行loop所在线程中的函数调用
+    // 本轮poll返回的时间，每轮只读一次时钟，事件回调和本轮的其他回调中可以直接用它代替TimeStamp::now()
     TimeStamp pollReturnTime() const { return pollReturnTime_; }
+    // 开启延迟统计后，本轮poll返回时的单调时钟(纳秒)，作为采样连接上各阶段的起点；未开启时为0
+    int64_t pollReturnNanos() const { return pollReturnNanos_; }
+    // 开启/关闭本loop的延迟统计，可以在任意线程中调用；关闭时每轮只多一次标志判断
+    void setLatencyTracing(bool on) { latencyTracing_.store(on, std::memory_order_relaxed); }
+    bool latencyTracing() const { return latencyTracing_.load(std::memory_order_relaxed); }
+    // 本loop上采样连接的各阶段延迟直方图，可以在任意线程中读取
+    LatencyStats &latencyStats() { return *latencyStats_; }
     void runInLoop(Functor cb);
     // 把cb放入队列中，唤醒loop所在的线程，执行cb，供运行在和loop所在线程不同的线程种的函数调用
     void queueInLoop(Functor cb);
 
+    // 在本轮的事件和回调都处理完之后执行cb，只能在loop线程中调用，用于合并一轮之中的多次写操作
+    void runAtIterationEnd(Functor cb);
+
+    // 定时器，可以在任意线程中调用，回调在loop线程中执行，时间单位为秒
+    TimerId runAfter(double delay, Functor cb);
+    TimerId runEvery(double interval, Functor cb);
+    void cancel(TimerId timerId);
+
     // 用来唤醒loop所在的线程
     void wakeUp();
 
@@ -50,18 +69,23 @@ public:
 private:
     void handleRead();        // 唤醒
     void doPendingFunctors(); // 执行回调
+    void doIterationEndFunctors();
 
     using ChannelList = std::vector<Channel *>;
     std::atomic_bool looping_; // 原子操作，通过CAS实现的
     std::atomic_bool quit_;    // 标识退出loop循环
     const pid_t threadId_;     // 记录当前loop所在线程的id
     TimeStamp pollReturnTime_; // poller返回发生事件的channels的时间点
+    int64_t pollReturnNanos_;
+    std::atomic_bool latencyTracing_;
+    std::unique_ptr<LatencyStats> latencyStats_;
     std::unique_ptr<Poller> poller_;
 
     // wakeUpFd_主要作用：当mainLoop获取一个新用户的channel，通过轮询算法选择一个subloop，通过该成员唤醒subloop处理channel
     // 由Linux中比较新的系统调用eventfd创建wakeupFd_
     int wakeupFd_;
     std::unique_ptr<Channel> wakeupChannel_; // 封装wakeupFd_以及其感兴趣的事件，完成主loop唤醒workLoop
+    std::unique_ptr<TimerQueue> timerQueue_; // 析构时要从poller_中移除timerfd，必须声明在poller_之后
 
 
     ChannelList activeChannels_;    // eventLoop所管理的所有channel
@@ -70,4 +94,5 @@ private:
     std::atomic_bool callingPendingFunctors_; // 标识当前loop是否有需要执行的回调操作
     std::vector<Functor> pendingsFunctors_;    // 存储loop需要执行的所有回调操作
     std::mutex mutex_;                        // 互斥锁用来保护上面vector容器的线程安全操作
+    std::vector<Functor> iterationEndFunctors_; // 本轮结束时执行的回调，只在loop线程中访问，不需要加锁
 };
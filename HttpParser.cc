@@ -0,0 +1,251 @@
+#include "HttpParser.h"
+
+#include <string.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+const size_t HttpParser::kDefaultMaxHeaderSize;
+const size_t HttpParser::kDefaultMaxBodySize;
+
+// 返回[p, end)中第一个等于a或b的字符的位置，找不到时返回end
+// 一次比较16个字节，查找CRLF时a和b都传'\r'，切分头部时传':'和'\r'一遍扫描同时定位分隔符和行尾
+static const char *findEither(const char *p, const char *end, char a, char b)
+{
+#if defined(__SSE2__)
+    const __m128i va = _mm_set1_epi8(a);
+    const __m128i vb = _mm_set1_epi8(b);
+    while (end - p >= 16)
+    {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+        int mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(chunk, va), _mm_cmpeq_epi8(chunk, vb)));
+        if (mask != 0)
+        {
+            return p + __builtin_ctz(mask);
+        }
+        p += 16;
+    }
+#endif
+    for (; p < end; ++p)
+    {
+        if (*p == a || *p == b)
+        {
+            return p;
+        }
+    }
+    return end;
+}
+
+// 行尾的CRLF位置，没有完整的CRLF时返回nullptr
+static const char *findCrlf(const char *p, const char *end)
+{
+    while ((p = findEither(p, end, '\r', '\r')) < end - 1)
+    {
+        if (p[1] == '\n')
+        {
+            return p;
+        }
+        ++p;
+    }
+    return nullptr;
+}
+
+static StringPiece trim(const char *begin, const char *end)
+{
+    while (begin < end && (*begin == ' ' || *begin == '\t'))
+    {
+        ++begin;
+    }
+    while (end > begin && (end[-1] == ' ' || end[-1] == '\t'))
+    {
+        --end;
+    }
+    return StringPiece(begin, end - begin);
+}
+
+HttpParser::HttpParser(size_t maxHeaderSize, size_t maxBodySize)
+    : maxHeaderSize_(maxHeaderSize),
+      maxBodySize_(maxBodySize),
+      scanned_(0),
+      headerLen_(0),
+      bodyLen_(0),
+      errorStatus_(0)
+{
+}
+
+HttpParser::Result HttpParser::fail(int status)
+{
+    errorStatus_ = status;
+    scanned_ = headerLen_ = bodyLen_ = 0;
+    return kError;
+}
+
+HttpParser::Result HttpParser::parse(const char *data, size_t len, TimeStamp receiveTime,
+                                     HttpRequest *request, size_t *consumed)
+{
+    const char *end = data + len;
+    bool headerParsed = false;
+    if (headerLen_ == 0)
+    {
+        // 从上次停下的位置继续找头部结尾的空行
+        const char *p = data + scanned_;
+        while (true)
+        {
+            p = findEither(p, end, '\r', '\r');
+            if (end - p < 4)
+            {
+                scanned_ = p - data;
+                break;
+            }
+            if (p[1] == '\n' && p[2] == '\r' && p[3] == '\n')
+            {
+                headerLen_ = p + 4 - data;
+                break;
+            }
+            ++p;
+        }
+        if (headerLen_ == 0 || headerLen_ > maxHeaderSize_)
+        {
+            return len > maxHeaderSize_ ? fail(431) : kNeedMore;
+        }
+
+        request->reset();
+        if (!parseHeaders(data, data + headerLen_, request))
+        {
+            return kError;
+        }
+        headerParsed = true;
+    }
+
+    if (len < headerLen_ + bodyLen_)
+    {
+        return kNeedMore;
+    }
+    if (!headerParsed)
+    {
+        // 等待请求体期间缓冲区可能被挪动过，之前的视图已经失效，重新解析一遍头部
+        request->reset();
+        parseHeaders(data, data + headerLen_, request);
+    }
+    request->body_ = StringPiece(data + headerLen_, bodyLen_);
+    request->receiveTime_ = receiveTime;
+    *consumed = headerLen_ + bodyLen_;
+    scanned_ = headerLen_ = bodyLen_ = 0;
+    return kComplete;
+}
+
+bool HttpParser::parseRequestLine(const char *begin, const char *end, HttpRequest *request)
+{
+    const char *space = findEither(begin, end, ' ', ' ');
+    if (space == end)
+    {
+        return false;
+    }
+    StringPiece method(begin, space - begin);
+    request->methodString_ = method;
+    if (method == "GET")
+        request->method_ = HttpRequest::kGet;
+    else if (method == "POST")
+        request->method_ = HttpRequest::kPost;
+    else if (method == "HEAD")
+        request->method_ = HttpRequest::kHead;
+    else if (method == "PUT")
+        request->method_ = HttpRequest::kPut;
+    else if (method == "DELETE")
+        request->method_ = HttpRequest::kDelete;
+    else if (method == "OPTIONS")
+        request->method_ = HttpRequest::kOptions;
+    else if (method == "PATCH")
+        request->method_ = HttpRequest::kPatch;
+    else
+        return false;
+
+    const char *target = space + 1;
+    space = findEither(target, end, ' ', ' ');
+    if (space == end || space == target)
+    {
+        return false;
+    }
+    const char *question = findEither(target, space, '?', '?');
+    request->path_ = StringPiece(target, question - target);
+    if (question != space)
+    {
+        request->query_ = StringPiece(question + 1, space - question - 1);
+    }
+
+    StringPiece version(space + 1, end - space - 1);
+    if (version == "HTTP/1.1")
+        request->version_ = HttpRequest::kHttp11;
+    else if (version == "HTTP/1.0")
+        request->version_ = HttpRequest::kHttp10;
+    else
+        return false;
+    return true;
+}
+
+bool HttpParser::parseHeaders(const char *begin, const char *end, HttpRequest *request)
+{
+    const char *lineEnd = findCrlf(begin, end);
+    if (!parseRequestLine(begin, lineEnd, request))
+    {
+        fail(400);
+        return false;
+    }
+
+    bool hasContentLength = false;
+    size_t contentLength = 0;
+    // 头部块以空行结尾，最后一个CRLF之前的都是头部行
+    const char *headersEnd = end - 2;
+    for (const char *line = lineEnd + 2; line < headersEnd; line = lineEnd + 2)
+    {
+        const char *colon = findEither(line, headersEnd, ':', '\r');
+        if (colon == headersEnd || *colon != ':' || colon == line)
+        {
+            fail(400);
+            return false;
+        }
+        lineEnd = findCrlf(colon, end);
+        HttpRequest::Header header(StringPiece(line, colon - line), trim(colon + 1, lineEnd));
+        request->headers_.push_back(header);
+
+        if (header.first.caseEqual("Content-Length"))
+        {
+            size_t value = 0;
+            if (header.second.empty() || header.second.size() > 18)
+            {
+                fail(400);
+                return false;
+            }
+            for (char c : header.second)
+            {
+                if (c < '0' || c > '9')
+                {
+                    fail(400);
+                    return false;
+                }
+                value = value * 10 + (c - '0');
+            }
+            if (hasContentLength && value != contentLength)
+            {
+                fail(400);
+                return false;
+            }
+            hasContentLength = true;
+            contentLength = value;
+        }
+        else if (header.first.caseEqual("Transfer-Encoding"))
+        {
+            // 不支持分块编码的请求体
+            fail(501);
+            return false;
+        }
+    }
+    if (contentLength > maxBodySize_)
+    {
+        fail(413);
+        return false;
+    }
+    bodyLen_ = contentLength;
+    return true;
+}
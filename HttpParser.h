@@ -0,0 +1,47 @@
+#pragma once
+
+#include "noncopyable.h"
+#include "HttpRequest.h"
+#include "TimeStamp.h"
+
+#include <stddef.h>
+
+/**************************
+ * 增量式HTTP/1.x请求解析器，每个连接一个
+ * 每次从连接未消费数据的开头调用parse，数据不完整时记住已经扫描过的位置，
+ * 下次只扫描新到的数据；解析结果中的字段是指向传入数据的视图，不做拷贝
+ **************************/
+class HttpParser : noncopyable
+{
+public:
+    enum Result
+    {
+        kNeedMore, // 请求还不完整
+        kComplete, // 解析出一个完整的请求
+        kError,    // 请求有误，errorStatus()给出应答的状态码
+    };
+
+    static const size_t kDefaultMaxHeaderSize = 64 * 1024;
+    static const size_t kDefaultMaxBodySize = 8 * 1024 * 1024;
+
+    explicit HttpParser(size_t maxHeaderSize = kDefaultMaxHeaderSize,
+                        size_t maxBodySize = kDefaultMaxBodySize);
+
+    // data必须指向尚未消费的第一个字节，kComplete时*consumed为这个请求占用的字节数
+    Result parse(const char *data, size_t len, TimeStamp receiveTime,
+                 HttpRequest *request, size_t *consumed);
+
+    int errorStatus() const { return errorStatus_; }
+
+private:
+    bool parseRequestLine(const char *begin, const char *end, HttpRequest *request);
+    bool parseHeaders(const char *begin, const char *end, HttpRequest *request);
+    Result fail(int status);
+
+    const size_t maxHeaderSize_;
+    const size_t maxBodySize_;
+    size_t scanned_;   // 已经确认不含头部结束标志的字节数
+    size_t headerLen_; // 头部已经完整时的长度(含结尾空行)，0表示还在等待头部
+    size_t bodyLen_;
+    int errorStatus_;
+};
@@ -0,0 +1,89 @@
+#pragma once
+
+#include "StringPiece.h"
+#include "TimeStamp.h"
+
+#include <vector>
+#include <utility>
+
+/**************************
+ * 解析出来的一个HTTP请求，除了method/version之外的字段都是指向连接inputBuffer_的视图，
+ * 只在HttpServer回调期间有效，需要保留的话调用asString()拷贝出来
+ **************************/
+class HttpRequest
+{
+public:
+    enum Method
+    {
+        kInvalid,
+        kGet,
+        kPost,
+        kHead,
+        kPut,
+        kDelete,
+        kOptions,
+        kPatch,
+    };
+    enum Version
+    {
+        kUnknown,
+        kHttp10,
+        kHttp11,
+    };
+    using Header = std::pair<StringPiece, StringPiece>;
+
+    HttpRequest() : method_(kInvalid), version_(kUnknown) {}
+
+    Method method() const { return method_; }
+    Version version() const { return version_; }
+    StringPiece methodString() const { return methodString_; }
+    StringPiece path() const { return path_; }
+    StringPiece query() const { return query_; }
+    StringPiece body() const { return body_; }
+    const std::vector<Header> &headers() const { return headers_; }
+    TimeStamp receiveTime() const { return receiveTime_; }
+
+    // 头部名称不区分大小写，不存在时返回空视图
+    StringPiece getHeader(const StringPiece &field) const
+    {
+        for (const Header &header : headers_)
+        {
+            if (header.first.caseEqual(field))
+            {
+                return header.second;
+            }
+        }
+        return StringPiece();
+    }
+
+    // HTTP/1.1默认长连接，HTTP/1.0需要显式带上Connection: Keep-Alive
+    bool keepAlive() const
+    {
+        StringPiece connection = getHeader("Connection");
+        if (version_ == kHttp11)
+        {
+            return !connection.caseEqual("close");
+        }
+        return connection.caseEqual("keep-alive");
+    }
+
+    void reset()
+    {
+        method_ = kInvalid;
+        version_ = kUnknown;
+        methodString_ = path_ = query_ = body_ = StringPiece();
+        headers_.clear(); // 保留容量，同一连接上的后续请求不再分配内存
+    }
+
+private:
+    friend class HttpParser;
+
+    Method method_;
+    Version version_;
+    StringPiece methodString_;
+    StringPiece path_;
+    StringPiece query_;
+    StringPiece body_;
+    std::vector<Header> headers_;
+    TimeStamp receiveTime_;
+};
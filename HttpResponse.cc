@@ -0,0 +1,83 @@
+#include "HttpResponse.h"
+#include "Buffer.h"
+
+#include <stdio.h>
+
+static StringPiece defaultReason(int code)
+{
+    switch (code)
+    {
+    case 200:
+        return "OK";
+    case 204:
+        return "No Content";
+    case 301:
+        return "Moved Permanently";
+    case 302:
+        return "Found";
+    case 304:
+        return "Not Modified";
+    case 400:
+        return "Bad Request";
+    case 403:
+        return "Forbidden";
+    case 404:
+        return "Not Found";
+    case 413:
+        return "Payload Too Large";
+    case 431:
+        return "Request Header Fields Too Large";
+    case 500:
+        return "Internal Server Error";
+    case 501:
+        return "Not Implemented";
+    case 503:
+        return "Service Unavailable";
+    default:
+        return "Unknown";
+    }
+}
+
+void HttpResponse::addHeader(const StringPiece &field, const StringPiece &value)
+{
+    headers_.append(field.data(), field.size());
+    headers_.append(": ", 2);
+    headers_.append(value.data(), value.size());
+    headers_.append("\r\n", 2);
+}
+
+void HttpResponse::appendHeadTo(Buffer *output, const StringPiece &dateHeader) const
+{
+    char buf[64];
+    int code = statusCode_ == kUnknown ? 500 : statusCode_;
+    int n = snprintf(buf, sizeof buf, "HTTP/1.%d %d ", http10_ ? 0 : 1, code);
+    output->append(buf, n);
+    StringPiece reason = statusMessage_.empty() ? defaultReason(code) : StringPiece(statusMessage_);
+    output->append(reason.data(), reason.size());
+    output->append("\r\n", 2);
+
+    output->append(dateHeader.data(), dateHeader.size());
+    if (closeConnection_)
+    {
+        output->append("Connection: close\r\n", 19);
+    }
+    else if (http10_)
+    {
+        // HTTP/1.0默认关闭连接，不带这个头部客户端会认为连接已经关闭
+        output->append("Connection: keep-alive\r\n", 24);
+    }
+    n = snprintf(buf, sizeof buf, "Content-Length: %zu\r\n", body_.size());
+    output->append(buf, n);
+    output->append(headers_.data(), headers_.size());
+    output->append("\r\n", 2);
+}
+
+void HttpResponse::reset(bool close, bool http10)
+{
+    statusCode_ = kUnknown;
+    statusMessage_.clear();
+    closeConnection_ = close;
+    http10_ = http10;
+    headers_.clear();
+    body_.clear();
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include "StringPiece.h"
+
+#include <string>
+#include <utility>
+
+class Buffer;
+
+// 应用在HttpServer回调中填写的HTTP应答，同一个连接上的应答对象会被复用
+class HttpResponse
+{
+public:
+    enum HttpStatusCode
+    {
+        kUnknown,
+        k200Ok = 200,
+        k204NoContent = 204,
+        k301MovedPermanently = 301,
+        k302Found = 302,
+        k304NotModified = 304,
+        k400BadRequest = 400,
+        k403Forbidden = 403,
+        k404NotFound = 404,
+        k413PayloadTooLarge = 413,
+        k431RequestHeaderFieldsTooLarge = 431,
+        k500InternalServerError = 500,
+        k501NotImplemented = 501,
+        k503ServiceUnavailable = 503,
+    };
+
+    explicit HttpResponse(bool close = false)
+        : statusCode_(kUnknown),
+          closeConnection_(close),
+          http10_(false)
+    {
+    }
+
+    // 状态码对应的默认原因短语，setStatusMessage可以覆盖
+    void setStatusCode(HttpStatusCode code) { statusCode_ = code; }
+    void setStatusMessage(const std::string &message) { statusMessage_ = message; }
+    HttpStatusCode statusCode() const { return statusCode_; }
+
+    void setCloseConnection(bool on) { closeConnection_ = on; }
+    bool closeConnection() const { return closeConnection_; }
+    // 请求是HTTP/1.0时状态行也用1.0，保持连接时要显式带上Connection: keep-alive
+    void setHttp10(bool on) { http10_ = on; }
+
+    void setContentType(const StringPiece &contentType) { addHeader("Content-Type", contentType); }
+    // 同名头部不去重，按添加顺序输出
+    void addHeader(const StringPiece &field, const StringPiece &value);
+
+    void setBody(const std::string &body) { body_ = body; }
+    void setBody(std::string &&body) { body_ = std::move(body); }
+    std::string &body() { return body_; }
+
+    // 输出状态行和全部头部(含Date和Content-Length)，以空行结尾，body由HttpServer决定拷贝还是交给连接
+    void appendHeadTo(Buffer *output, const StringPiece &dateHeader) const;
+
+    // 清空内容准备下一个请求，保留已分配的内存
+    void reset(bool close, bool http10 = false);
+
+private:
+    HttpStatusCode statusCode_;
+    std::string statusMessage_;
+    bool closeConnection_;
+    bool http10_;
+    std::string headers_; // 已经格式化好的"Field: value\r\n"序列
+    std::string body_;
+};
@@ -0,0 +1,160 @@
+#include "HttpServer.h"
+#include "HttpParser.h"
+#include "Logger.h"
+
+#include <memory>
+#include <time.h>
+#include <stdio.h>
+
+// 应答体达到这个大小时直接交给连接发送，由writev和头部一起写出，小的应答体拷进头部所在的缓冲区
+static const size_t kGatherBodyBytes = 4096;
+
+// 每个连接的解析状态，request/response在连接的整个生命周期中复用
+struct HttpContext
+{
+    HttpContext(size_t maxHeaderSize, size_t maxBodySize)
+        : parser(maxHeaderSize, maxBodySize),
+          closing(false)
+    {
+    }
+
+    HttpParser parser;
+    HttpRequest request;
+    HttpResponse response;
+    Buffer output; // 本次messageCallback中所有应答的头部和小的应答体
+    bool closing;  // 已经决定关闭连接，不再处理后续请求
+};
+
+// 每个线程缓存一份格式化好的Date头部，每秒最多格式化一次；
+// now取自本轮poll返回的时间，不需要再读时钟
+static StringPiece cachedDateHeader(TimeStamp now)
+{
+    static const char *kWeekdays[] = {"Sun", "Mon", "Tue", "Wed", "Thu", "Fri", "Sat"};
+    static const char *kMonths[] = {"Jan", "Feb", "Mar", "Apr", "May", "Jun",
+                                    "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"};
+    static __thread time_t t_lastSecond = 0;
+    static __thread char t_dateHeader[64];
+    static __thread int t_dateLen = 0;
+
+    time_t seconds = now.secondsSinceEpoch();
+    if (seconds != t_lastSecond)
+    {
+        tm tmTime;
+        ::gmtime_r(&seconds, &tmTime);
+        t_dateLen = snprintf(t_dateHeader, sizeof t_dateHeader,
+                             "Date: %s, %02d %s %04d %02d:%02d:%02d GMT\r\n",
+                             kWeekdays[tmTime.tm_wday], tmTime.tm_mday, kMonths[tmTime.tm_mon],
+                             tmTime.tm_year + 1900, tmTime.tm_hour, tmTime.tm_min, tmTime.tm_sec);
+        t_lastSecond = seconds;
+    }
+    return StringPiece(t_dateHeader, t_dateLen);
+}
+
+static void defaultHttpCallback(const HttpRequest &, HttpResponse *resp)
+{
+    resp->setStatusCode(HttpResponse::k404NotFound);
+    resp->setCloseConnection(true);
+}
+
+HttpServer::HttpServer(EventLoop *loop, const InetAddress &listenAddr, const std::string &name,
+                       TcpServer::Option option)
+    : server_(loop, listenAddr, name, option),
+      httpCallback_(defaultHttpCallback),
+      maxHeaderSize_(HttpParser::kDefaultMaxHeaderSize),
+      maxBodySize_(HttpParser::kDefaultMaxBodySize)
+{
+    server_.setConnectionCallback(
+        std::bind(&HttpServer::onConnection, this, std::placeholders::_1));
+    server_.setMessageCallback(
+        std::bind(&HttpServer::onMessage, this,
+                  std::placeholders::_1, std::placeholders::_2, std::placeholders::_3));
+    // 管道化的多个应答在本轮事件循环结束时合并成一次writev
+    server_.setCorkWrites(true);
+}
+
+void HttpServer::onConnection(const TcpConnectionPtr &conn)
+{
+    if (conn->connected())
+    {
+        conn->setContext(std::make_shared<HttpContext>(maxHeaderSize_, maxBodySize_));
+    }
+}
+
+void HttpServer::onMessage(const TcpConnectionPtr &conn, Buffer *buf, TimeStamp receiveTime)
+{
+    HttpContext *context = static_cast<HttpContext *>(conn->getContext().get());
+    if (context->closing)
+    {
+        buf->retrieveAll();
+        return;
+    }
+
+    Buffer &output = context->output;
+    HttpResponse &response = context->response;
+    StringPiece date = cachedDateHeader(receiveTime);
+    size_t offset = 0;
+    while (!context->closing)
+    {
+        size_t consumed = 0;
+        HttpParser::Result result = context->parser.parse(buf->peek() + offset, buf->readAbleBytes() - offset,
+                                                          receiveTime, &context->request, &consumed);
+        if (result == HttpParser::kNeedMore)
+        {
+            break;
+        }
+        if (result == HttpParser::kError)
+        {
+            // 出错之后无法再找到下一个请求的边界，应答错误并关闭连接
+            response.reset(true);
+            response.setStatusCode(static_cast<HttpResponse::HttpStatusCode>(context->parser.errorStatus()));
+            response.appendHeadTo(&output, date);
+            context->closing = true;
+            break;
+        }
+        offset += consumed;
+
+        const HttpRequest &request = context->request;
+        response.reset(!request.keepAlive(), request.version() == HttpRequest::kHttp10);
+        httpCallback_(request, &response);
+        context->closing = response.closeConnection();
+
+        response.appendHeadTo(&output, date);
+        std::string &body = response.body();
+        if (request.method() == HttpRequest::kHead || body.empty())
+        {
+            continue;
+        }
+        if (body.size() < kGatherBodyBytes)
+        {
+            output.append(body.data(), body.size());
+        }
+        else
+        {
+            // 先交出前面的头部保证顺序，应答体整块交给连接，不再拷贝
+            if (output.readAbleBytes() > 0)
+            {
+                conn->send(output.peek(), output.readAbleBytes());
+                output.retrieveAll();
+            }
+            conn->send(std::move(body));
+        }
+    }
+
+    if (context->closing)
+    {
+        buf->retrieveAll();
+    }
+    else
+    {
+        buf->retrieve(offset);
+    }
+    if (output.readAbleBytes() > 0)
+    {
+        conn->send(output.peek(), output.readAbleBytes());
+        output.retrieveAll();
+    }
+    if (context->closing)
+    {
+        conn->shutdown();
+    }
+}
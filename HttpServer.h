@@ -0,0 +1,42 @@
+#pragma once
+
+#include "TcpServer.h"
+#include "HttpRequest.h"
+#include "HttpResponse.h"
+#include "noncopyable.h"
+
+#include <functional>
+#include <string>
+
+/**************************
+ * 基于TcpServer的HTTP/1.1服务器
+ * 支持长连接和管道化请求：一次读到的多个请求依次回调，应答按请求顺序写回；
+ * 连接开启了合并写，同一轮事件循环中的所有应答最后由一次writev发出，
+ * 较大的应答体直接交给连接作为单独的iovec，不拷贝进发送缓冲区
+ **************************/
+class HttpServer : noncopyable
+{
+public:
+    // 在连接所在的loop线程中同步回调，request中的视图只在回调期间有效
+    using HttpCallback = std::function<void(const HttpRequest &, HttpResponse *)>;
+
+    HttpServer(EventLoop *loop, const InetAddress &listenAddr, const std::string &name,
+               TcpServer::Option option = TcpServer::kNoReusePort);
+
+    void setHttpCallback(const HttpCallback &cb) { httpCallback_ = cb; }
+    void setThreadNum(int numThreads) { server_.setThreadNum(numThreads); }
+    // 超过限制的请求分别以431/413应答并关闭连接
+    void setMaxHeaderSize(size_t size) { maxHeaderSize_ = size; }
+    void setMaxBodySize(size_t size) { maxBodySize_ = size; }
+
+    void start() { server_.start(); }
+
+private:
+    void onConnection(const TcpConnectionPtr &conn);
+    void onMessage(const TcpConnectionPtr &conn, Buffer *buf, TimeStamp receiveTime);
+
+    TcpServer server_;
+    HttpCallback httpCallback_;
+    size_t maxHeaderSize_;
+    size_t maxBodySize_;
+};
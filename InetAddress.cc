@@ -1,8 +1,10 @@
 #include <strings.h>
 #include <string.h>
+#include <stddef.h>
 #include <iostream>
 
 #include "InetAddress.h"
+#include "Logger.h"
 
 InetAddress::InetAddress(uint16_t port, std::string ip)
 {
@@ -10,10 +12,70 @@ InetAddress::InetAddress(uint16_t port, std::string ip)
     addr_.sin_family = AF_INET;
     addr_.sin_port = htons(port);
     addr_.sin_addr.s_addr = inet_addr(ip.c_str()); // 把字符串转成一个整数以及网络字节序
+    len_ = sizeof addr_;
+}
+
+InetAddress InetAddress::fromUnixPath(const std::string &path)
+{
+    InetAddress addr;
+    bzero(&addr.unixAddr_, sizeof(addr.unixAddr_));
+    addr.unixAddr_.sun_family = AF_UNIX;
+    size_t len = path.size();
+    if (len >= sizeof(addr.unixAddr_.sun_path))
+    {
+        LOG_ERROR("InetAddress::fromUnixPath path too long: %s \n", path.c_str());
+        len = sizeof(addr.unixAddr_.sun_path) - 1;
+    }
+    ::memcpy(addr.unixAddr_.sun_path, path.data(), len);
+    if (len > 0 && path[0] == '@')
+    {
+        // 抽象命名空间: sun_path[0]为'\0'，名字的长度由地址长度决定
+        addr.unixAddr_.sun_path[0] = '\0';
+        addr.len_ = static_cast<socklen_t>(offsetof(sockaddr_un, sun_path) + len);
+    }
+    else
+    {
+        addr.len_ = static_cast<socklen_t>(offsetof(sockaddr_un, sun_path) + len + 1);
+    }
+    return addr;
+}
+
+void InetAddress::setSockAddr(const sockaddr *addr, socklen_t len)
+{
+    if (len > sizeof(unixAddr_))
+    {
+        len = sizeof(unixAddr_);
+    }
+    bzero(&unixAddr_, sizeof(unixAddr_));
+    ::memcpy(&unixAddr_, addr, len);
+    len_ = len;
+}
+
+bool InetAddress::isUnixPath() const
+{
+    return isUnix() && len_ > offsetof(sockaddr_un, sun_path) + 1 && unixAddr_.sun_path[0] != '\0';
+}
+
+std::string InetAddress::unixPath() const
+{
+    if (!isUnix() || len_ <= offsetof(sockaddr_un, sun_path))
+    {
+        return std::string(); // 未命名的socket，比如客户端一侧
+    }
+    size_t len = len_ - offsetof(sockaddr_un, sun_path);
+    if (unixAddr_.sun_path[0] == '\0')
+    {
+        return "@" + std::string(unixAddr_.sun_path + 1, len - 1);
+    }
+    return std::string(unixAddr_.sun_path, strnlen(unixAddr_.sun_path, len));
 }
 
 std::string InetAddress::toIp() const
 {
+    if (isUnix())
+    {
+        return unixPath();
+    }
     // addr_ 里面的IP地址转成点分十进制的
     char buf[64] = {0};
     ::inet_ntop(AF_INET, &addr_.sin_addr, buf, sizeof(buf));
@@ -22,6 +84,10 @@ std::string InetAddress::toIp() const
 
 std::string InetAddress::toIpPort() const
 {
+    if (isUnix())
+    {
+        return "unix:" + unixPath();
+    }
     // ip:port
     char buf[64] = {0};
     ::inet_ntop(AF_INET, &addr_.sin_addr, buf, sizeof(buf));
@@ -33,11 +99,11 @@ std::string InetAddress::toIpPort() const
 
 uint16_t InetAddress::toPort() const
 {
-    return ntohs(addr_.sin_port);
+    return isUnix() ? 0 : ntohs(addr_.sin_port);
 }
 
 // int main()
 // {
 //     InetAddress addr(8080);
 //     std::cout << addr.toIpPort() << std::endl;
-// }
\ No newline at end of file
+// }
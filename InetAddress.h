@@ -1,20 +1,50 @@
 #pragma once
 #include <arpa/inet.h>
 #include <netinet/in.h>
+#include <sys/un.h>
 #include <string>
 
+/****************
+ * socket地址，IPv4(sockaddr_in)或者Unix域(sockaddr_un)
+ * Unix域地址用fromUnixPath创建，以'@'开头的名字表示抽象命名空间(不在文件系统里创建文件)
+ * *************/
 class InetAddress
 {
 public:
-    explicit InetAddress(const sockaddr_in &addr) : addr_(addr) {}
+    explicit InetAddress(const sockaddr_in &addr) : addr_(addr), len_(sizeof addr) {}
     explicit InetAddress(uint16_t port=0, std::string ip = "127.0.0.1");
+
+    // 路径以'@'开头时使用抽象命名空间，"@name"对应内核里的"\0name"
+    static InetAddress fromUnixPath(const std::string &path);
+
     std::string toIp() const;
-    std::string toIpPort() const;
+    std::string toIpPort() const; // Unix域地址返回"unix:路径"
     uint16_t toPort() const;
 
+    sa_family_t family() const { return addr_.sin_family; }
+    bool isUnix() const { return family() == AF_UNIX; }
+    // 绑定在文件系统路径上的Unix域地址，监听socket关闭后需要删除对应的文件
+    bool isUnixPath() const;
+    std::string unixPath() const;
+
+    // 只对IPv4地址有意义
     const sockaddr_in *getSockAddr() const { return &addr_; }
-    void setSockAddr(const sockaddr_in &addr) { addr_ = addr; }
+    void setSockAddr(const sockaddr_in &addr)
+    {
+        addr_ = addr;
+        len_ = sizeof addr;
+    }
+
+    // 不区分地址族，用于bind/connect/accept
+    const sockaddr *sockAddr() const { return reinterpret_cast<const sockaddr *>(&unixAddr_); }
+    socklen_t sockAddrLen() const { return len_; }
+    void setSockAddr(const sockaddr *addr, socklen_t len);
 
 private:
-    sockaddr_in addr_;
-};
\ No newline at end of file
+    union
+    {
+        sockaddr_in addr_;
+        sockaddr_un unixAddr_;
+    };
+    socklen_t len_; // Unix域地址的实际长度，抽象命名空间的名字不以'\0'结尾，必须靠长度确定
+};
@@ -0,0 +1,166 @@
+#include "LatencyStats.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdio.h>
+#include <time.h>
+
+LatencyHistogram::Snapshot::Snapshot()
+    : buckets(kNumBuckets, 0),
+      count(0),
+      sum(0),
+      max(0)
+{
+}
+
+void LatencyHistogram::Snapshot::merge(const Snapshot &other)
+{
+    for (int i = 0; i < kNumBuckets; ++i)
+    {
+        buckets[i] += other.buckets[i];
+    }
+    count += other.count;
+    sum += other.sum;
+    max = std::max(max, other.max);
+}
+
+int64_t LatencyHistogram::Snapshot::percentile(double q) const
+{
+    if (count == 0)
+    {
+        return 0;
+    }
+    // 第rank个样本(从1开始)所在的桶，rank = ceil(q * count)，向下取整会偏低一个样本
+    double r = std::ceil(q * static_cast<double>(count));
+    uint64_t rank = r < 1 ? 1 : (r >= static_cast<double>(count) ? count : static_cast<uint64_t>(r));
+    uint64_t seen = 0;
+    for (int i = 0; i < kNumBuckets; ++i)
+    {
+        seen += buckets[i];
+        if (seen >= rank)
+        {
+            return std::min(bucketUpperBound(i), max);
+        }
+    }
+    return max;
+}
+
+LatencyHistogram::LatencyHistogram()
+{
+    reset();
+}
+
+/*
+ * 小于kSubBuckets的值每个值一个桶；
+ * 其余的值按最高位的位置e分组，每组再按最高位之后的kSubBucketBits位细分
+ */
+int LatencyHistogram::bucketIndex(int64_t nanos)
+{
+    if (nanos < kSubBuckets)
+    {
+        return nanos < 0 ? 0 : static_cast<int>(nanos);
+    }
+    int exponent = 63 - __builtin_clzll(static_cast<uint64_t>(nanos));
+    if (exponent > kMaxExponent)
+    {
+        return kNumBuckets - 1;
+    }
+    int sub = static_cast<int>((nanos >> (exponent - kSubBucketBits)) & (kSubBuckets - 1));
+    return (exponent - kSubBucketBits + 1) * kSubBuckets + sub;
+}
+
+int64_t LatencyHistogram::bucketUpperBound(int index)
+{
+    if (index < kSubBuckets)
+    {
+        return index;
+    }
+    int exponent = index / kSubBuckets - 1 + kSubBucketBits;
+    int sub = index % kSubBuckets;
+    int64_t width = int64_t(1) << (exponent - kSubBucketBits);
+    return (kSubBuckets + sub) * width + width - 1;
+}
+
+void LatencyHistogram::record(int64_t nanos)
+{
+    increment(buckets_[bucketIndex(nanos)], 1);
+    increment(sum_, nanos > 0 ? nanos : 0);
+    if (nanos > max_.load(std::memory_order_relaxed))
+    {
+        max_.store(nanos, std::memory_order_relaxed);
+    }
+}
+
+LatencyHistogram::Snapshot LatencyHistogram::snapshot() const
+{
+    Snapshot s;
+    for (int i = 0; i < kNumBuckets; ++i)
+    {
+        s.buckets[i] = buckets_[i].load(std::memory_order_relaxed);
+        s.count += s.buckets[i];
+    }
+    // 样本数取各桶之和，与百分位数的计算保持一致；读取过程中有新样本写入时与sum_可能略有出入
+    s.sum = sum_.load(std::memory_order_relaxed);
+    s.max = max_.load(std::memory_order_relaxed);
+    return s;
+}
+
+void LatencyHistogram::reset()
+{
+    for (int i = 0; i < kNumBuckets; ++i)
+    {
+        buckets_[i].store(0, std::memory_order_relaxed);
+    }
+    sum_.store(0, std::memory_order_relaxed);
+    max_.store(0, std::memory_order_relaxed);
+}
+
+const char *LatencyStats::stageName(Stage stage)
+{
+    static const char *names[kNumStages] = {"queue", "handler", "flush", "total"};
+    return names[stage];
+}
+
+int64_t LatencyStats::nowNanos()
+{
+    timespec ts;
+    ::clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+void LatencyStats::reset()
+{
+    for (int i = 0; i < kNumStages; ++i)
+    {
+        histograms_[i].reset();
+    }
+}
+
+std::string LatencyStats::toString() const
+{
+    LatencyHistogram::Snapshot snapshots[kNumStages];
+    for (int i = 0; i < kNumStages; ++i)
+    {
+        snapshots[i] = histograms_[i].snapshot();
+    }
+    return format(snapshots);
+}
+
+std::string LatencyStats::format(const LatencyHistogram::Snapshot snapshots[kNumStages])
+{
+    std::string result;
+    char line[256];
+    snprintf(line, sizeof line, "%-9s %10s %10s %10s %10s %10s %10s %10s\n",
+             "stage(us)", "count", "mean", "p50", "p90", "p99", "p999", "max");
+    result += line;
+    for (int i = 0; i < kNumStages; ++i)
+    {
+        const LatencyHistogram::Snapshot &s = snapshots[i];
+        snprintf(line, sizeof line, "%-9s %10llu %10.1f %10.1f %10.1f %10.1f %10.1f %10.1f\n",
+                 stageName(static_cast<Stage>(i)), static_cast<unsigned long long>(s.count),
+                 s.mean() / 1e3, s.percentile(0.50) / 1e3, s.percentile(0.90) / 1e3,
+                 s.percentile(0.99) / 1e3, s.percentile(0.999) / 1e3, s.max / 1e3);
+        result += line;
+    }
+    return result;
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include "noncopyable.h"
+
+#include <atomic>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+/****************
+ * 请求处理各阶段的延迟统计，每个EventLoop一份，只由loop线程写入，其他线程可以随时读取快照
+ * 打点位置(都在开启了采样的TcpConnection上):
+ *   epoll返回(EventLoop::pollReturnNanos) -> handleRead开始 -> messageCallback返回
+ *   -> sendInLoop第一次写出响应 -> 输出缓冲区全部写完(写完成回调的时机)
+ * 划分成的阶段:
+ *   kQueue   epoll返回到handleRead开始，同一轮中排在前面的channel的处理时间
+ *   kHandler handleRead开始到messageCallback返回，包括读socket和用户的消息处理
+ *   kFlush   第一次写出响应到全部写完，包括合并写等到本轮结束的时间和等待EPOLLOUT的时间
+ *   kTotal   epoll返回到全部写完
+ * *************/
+
+// 对数分桶的延迟直方图，单位纳秒，每个2的幂区间再细分8个桶，相对误差不超过12.5%
+// 只允许一个线程写入(record)，读取(snapshot)可以在任意线程
+class LatencyHistogram : noncopyable
+{
+public:
+    static const int kSubBucketBits = 3;
+    static const int kSubBuckets = 1 << kSubBucketBits;
+    static const int kMaxExponent = 42; // 2^42纳秒约73分钟，更大的值计入最后一个桶
+    static const int kNumBuckets = (kMaxExponent - kSubBucketBits + 2) * kSubBuckets;
+
+    // 某一时刻的拷贝，用于计算百分位数和合并多个loop的数据
+    struct Snapshot
+    {
+        Snapshot();
+        std::vector<uint64_t> buckets;
+        uint64_t count;
+        uint64_t sum;
+        int64_t max;
+
+        void merge(const Snapshot &other);
+        double mean() const { return count > 0 ? static_cast<double>(sum) / count : 0; }
+        // q取值0~1，返回所在桶的上界，不超过max
+        int64_t percentile(double q) const;
+    };
+
+    LatencyHistogram();
+
+    void record(int64_t nanos);
+    Snapshot snapshot() const;
+    // 与record并发调用时，清零前后的少量样本可能被计入或丢失
+    void reset();
+
+    static int bucketIndex(int64_t nanos);
+    static int64_t bucketUpperBound(int index);
+
+private:
+    // 单写者：load + store即可，不需要带lock前缀的原子加
+    static void increment(std::atomic<uint64_t> &value, uint64_t delta)
+    {
+        value.store(value.load(std::memory_order_relaxed) + delta, std::memory_order_relaxed);
+    }
+
+    std::atomic<uint64_t> buckets_[kNumBuckets];
+    std::atomic<uint64_t> sum_;
+    std::atomic<int64_t> max_;
+};
+
+class LatencyStats : noncopyable
+{
+public:
+    enum Stage
+    {
+        kQueue,
+        kHandler,
+        kFlush,
+        kTotal,
+        kNumStages
+    };
+
+    static const char *stageName(Stage stage);
+    // 打点用的单调时钟，纳秒
+    static int64_t nowNanos();
+
+    void record(Stage stage, int64_t nanos) { histograms_[stage].record(nanos); }
+    LatencyHistogram::Snapshot snapshot(Stage stage) const { return histograms_[stage].snapshot(); }
+    void reset();
+
+    // 每个阶段一行: 样本数、平均值和p50/p90/p99/p999/max，单位微秒
+    std::string toString() const;
+    static std::string format(const LatencyHistogram::Snapshot snapshots[kNumStages]);
+
+private:
+    LatencyHistogram histograms_[kNumStages];
+};
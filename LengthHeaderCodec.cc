@@ -0,0 +1,197 @@
+#include "LengthHeaderCodec.h"
+#include "Buffer.h"
+#include "TcpConnection.h"
+#include "Crc32c.h"
+#include "Logger.h"
+
+#include <algorithm>
+#include <string.h>
+#include <endian.h>
+
+const size_t LengthHeaderCodec::kDefaultMaxFrameSize;
+const size_t LengthHeaderCodec::kChecksumLen;
+
+static int validHeaderLen(int headerLen)
+{
+    if (headerLen != 1 && headerLen != 2 && headerLen != 4 && headerLen != 8)
+    {
+        LOG_FATAL("%s:%s:%d invalid header length %d \n", __FILE__, __FUNCTION__, __LINE__, headerLen);
+    }
+    return headerLen;
+}
+
+LengthHeaderCodec::LengthHeaderCodec(const FrameCallback &cb, int headerLen,
+                                     size_t maxFrameSize, bool checksum)
+    : frameCallback_(cb),
+      headerLen_(validHeaderLen(headerLen)),
+      maxFrameSize_(maxFrameSize),
+      checksum_(checksum)
+{
+}
+
+uint64_t LengthHeaderCodec::readLength(const char *p) const
+{
+    switch (headerLen_)
+    {
+    case 1:
+        return static_cast<uint8_t>(*p);
+    case 2:
+    {
+        uint16_t be16;
+        ::memcpy(&be16, p, sizeof be16);
+        return be16toh(be16);
+    }
+    case 4:
+    {
+        uint32_t be32;
+        ::memcpy(&be32, p, sizeof be32);
+        return be32toh(be32);
+    }
+    default:
+    {
+        uint64_t be64;
+        ::memcpy(&be64, p, sizeof be64);
+        return be64toh(be64);
+    }
+    }
+}
+
+void LengthHeaderCodec::writeLength(char *p, uint64_t len) const
+{
+    switch (headerLen_)
+    {
+    case 1:
+        *p = static_cast<char>(len);
+        break;
+    case 2:
+    {
+        uint16_t be16 = htobe16(static_cast<uint16_t>(len));
+        ::memcpy(p, &be16, sizeof be16);
+        break;
+    }
+    case 4:
+    {
+        uint32_t be32 = htobe32(static_cast<uint32_t>(len));
+        ::memcpy(p, &be32, sizeof be32);
+        break;
+    }
+    default:
+    {
+        uint64_t be64 = htobe64(len);
+        ::memcpy(p, &be64, sizeof be64);
+        break;
+    }
+    }
+}
+
+void LengthHeaderCodec::onMessage(const TcpConnectionPtr &conn, Buffer *buf, TimeStamp receiveTime)
+{
+    const size_t trailerLen = checksum_ ? kChecksumLen : 0;
+    // 先把本次读到的所有完整帧分发完，最后一次性retrieve，避免逐帧移动读指针时缓冲区被复位
+    const char *begin = buf->peek();
+    const char *p = begin;
+    size_t remain = buf->readAbleBytes();
+    while (remain >= static_cast<size_t>(headerLen_))
+    {
+        uint64_t len = readLength(p);
+        if (len > maxFrameSize_)
+        {
+            handleError(conn, buf, kFrameTooLarge);
+            return;
+        }
+        size_t frameLen = headerLen_ + len + trailerLen;
+        if (remain < frameLen)
+        {
+            break;
+        }
+        const char *data = p + headerLen_;
+        if (checksum_)
+        {
+            uint32_t be32;
+            ::memcpy(&be32, data + len, sizeof be32);
+            if (Crc32c::value(data, len) != be32toh(be32))
+            {
+                handleError(conn, buf, kChecksumMismatch);
+                return;
+            }
+        }
+        frameCallback_(conn, data, len, receiveTime);
+        p += frameLen;
+        remain -= frameLen;
+    }
+    buf->retrieve(p - begin);
+}
+
+void LengthHeaderCodec::handleError(const TcpConnectionPtr &conn, Buffer *buf, Error err)
+{
+    buf->retrieveAll();
+    if (errorCallback_)
+    {
+        errorCallback_(conn, err);
+    }
+    else
+    {
+        LOG_ERROR("LengthHeaderCodec %s on connection %s, closing \n",
+                  err == kFrameTooLarge ? "frame too large" : "checksum mismatch",
+                  conn->name().c_str());
+        conn->forceClose();
+    }
+}
+
+bool LengthHeaderCodec::checkFrameSize(size_t len) const
+{
+    // 1/2字节的长度字段本身也限制了帧的大小
+    size_t limit = maxFrameSize_;
+    if (headerLen_ < 8)
+    {
+        limit = std::min<uint64_t>(limit, (1ULL << (headerLen_ * 8)) - 1);
+    }
+    if (len > limit)
+    {
+        LOG_ERROR("LengthHeaderCodec::send frame of %zu bytes exceeds limit %zu \n", len, limit);
+        return false;
+    }
+    return true;
+}
+
+void LengthHeaderCodec::send(const TcpConnectionPtr &conn, const char *data, size_t len) const
+{
+    if (!checkFrameSize(len))
+    {
+        return;
+    }
+    Buffer frame(len + kChecksumLen);
+    frame.append(data, len);
+    send(conn, &frame);
+}
+
+void LengthHeaderCodec::send(const TcpConnectionPtr &conn, Buffer *buf) const
+{
+    size_t len = buf->readAbleBytes();
+    if (!checkFrameSize(len))
+    {
+        buf->retrieveAll();
+        return;
+    }
+    if (checksum_)
+    {
+        uint32_t be32 = htobe32(Crc32c::value(buf->peek(), len));
+        buf->append(reinterpret_cast<const char *>(&be32), sizeof be32);
+    }
+    char header[8];
+    writeLength(header, len);
+    if (buf->prependAbleBytes() >= static_cast<size_t>(headerLen_))
+    {
+        buf->prepend(header, headerLen_);
+        conn->send(buf);
+    }
+    else
+    {
+        // buf的读指针已经用掉了预留空间，只能重新拼一份
+        Buffer frame(headerLen_ + buf->readAbleBytes());
+        frame.append(header, headerLen_);
+        frame.append(buf->peek(), buf->readAbleBytes());
+        buf->retrieveAll();
+        conn->send(&frame);
+    }
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "noncopyable.h"
+#include "Callbacks.h"
+#include "TimeStamp.h"
+
+#include <functional>
+#include <stddef.h>
+#include <stdint.h>
+
+class Buffer;
+
+/**************************
+ * 长度前缀的消息编解码器: | 长度(1/2/4/8字节，网络字节序) | 消息体 | CRC32C(4字节，可选) |
+ * 长度字段只计消息体，CRC32C校验的是消息体
+ *
+ * 用法: server.setMessageCallback(std::bind(&LengthHeaderCodec::onMessage, &codec, _1, _2, _3))
+ * 一次读到的数据中每个完整的帧都会回调一次FrameCallback，传入的data指向连接的inputBuffer_，
+ * 不做拷贝，只在回调期间有效；不完整的帧留在缓冲区中等待后续数据
+ **************************/
+class LengthHeaderCodec : noncopyable
+{
+public:
+    enum Error
+    {
+        kFrameTooLarge,    // 长度字段超过maxFrameSize
+        kChecksumMismatch, // CRC32C校验失败
+    };
+
+    using FrameCallback = std::function<void(const TcpConnectionPtr &, const char *data, size_t len, TimeStamp)>;
+    using ErrorCallback = std::function<void(const TcpConnectionPtr &, Error)>;
+
+    static const size_t kDefaultMaxFrameSize = 64 * 1024 * 1024;
+    static const size_t kChecksumLen = 4;
+
+    // headerLen只能是1、2、4、8
+    explicit LengthHeaderCodec(const FrameCallback &cb,
+                               int headerLen = 4,
+                               size_t maxFrameSize = kDefaultMaxFrameSize,
+                               bool checksum = false);
+
+    // 出错之后缓冲区中剩下的数据已无法定位帧边界，会被全部丢弃。
+    // 默认的处理是记录日志并forceClose连接
+    void setErrorCallback(const ErrorCallback &cb) { errorCallback_ = cb; }
+
+    void onMessage(const TcpConnectionPtr &conn, Buffer *buf, TimeStamp receiveTime);
+
+    // 编码一帧并发送，可以在任意线程中调用
+    void send(const TcpConnectionPtr &conn, const char *data, size_t len) const;
+    // 在buf的预留空间中写入长度、尾部追加校验和后整体交给连接，调用之后buf为空
+    void send(const TcpConnectionPtr &conn, Buffer *buf) const;
+
+    int headerLen() const { return headerLen_; }
+    size_t maxFrameSize() const { return maxFrameSize_; }
+    bool checksum() const { return checksum_; }
+
+private:
+    uint64_t readLength(const char *p) const;
+    void writeLength(char *p, uint64_t len) const;
+    bool checkFrameSize(size_t len) const;
+    void handleError(const TcpConnectionPtr &conn, Buffer *buf, Error err);
+
+    FrameCallback frameCallback_;
+    ErrorCallback errorCallback_;
+    const int headerLen_;
+    const size_t maxFrameSize_;
+    const bool checksum_;
+};
@@ -0,0 +1,212 @@
+#include "LogFile.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+
+LogFile::LogFile(const std::string &basename, size_t rollSize,
+                 int flushInterval, int rollInterval, bool syncToDisk)
+    : basename_(basename),
+      rollSize_(rollSize),
+      flushInterval_(flushInterval),
+      rollInterval_(rollInterval),
+      syncToDisk_(syncToDisk),
+      fp_(nullptr),
+      writtenBytes_(0),
+      flushedBytes_(0),
+      startOfPeriod_(0),
+      lastRoll_(0),
+      lastFlush_(0),
+      syncRunning_(true),
+      syncThread_(std::bind(&LogFile::syncThreadFunc, this), "LogFileSync")
+{
+    rollFileUnlocked();
+    syncThread_.start();
+}
+
+LogFile::~LogFile()
+{
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (fp_)
+        {
+            ::fflush(fp_);
+            if (syncToDisk_)
+            {
+                ::fdatasync(::fileno(fp_));
+            }
+            ::fclose(fp_);
+            fp_ = nullptr;
+        }
+    }
+    {
+        std::unique_lock<std::mutex> lock(syncMutex_);
+        syncRunning_ = false;
+        syncCond_.notify_one();
+    }
+    syncThread_.join();
+}
+
+void LogFile::append(const char *line, size_t len)
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    appendUnlocked(line, len);
+}
+
+void LogFile::flush()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    flushUnlocked();
+}
+
+bool LogFile::rollFile()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    return rollFileUnlocked();
+}
+
+void LogFile::appendUnlocked(const char *line, size_t len)
+{
+    if (fp_ == nullptr)
+    {
+        return;
+    }
+    // 同一个FILE只在锁内使用，不需要stdio自己的锁
+    size_t n = ::fwrite_unlocked(line, 1, len, fp_);
+    writtenBytes_ += n;
+
+    if (writtenBytes_ > rollSize_)
+    {
+        rollFileUnlocked();
+        return;
+    }
+    // time()走vDSO，每行都检查，日志量小的时候也能按时滚动和刷新
+    time_t now = ::time(nullptr);
+    if (now / rollInterval_ * rollInterval_ != startOfPeriod_)
+    {
+        rollFileUnlocked();
+    }
+    else if (now - lastFlush_ >= flushInterval_)
+    {
+        flushUnlocked();
+    }
+}
+
+void LogFile::flushIfDue()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (fp_ != nullptr && writtenBytes_ != flushedBytes_ && ::time(nullptr) - lastFlush_ >= flushInterval_)
+    {
+        flushUnlocked();
+    }
+}
+
+void LogFile::flushUnlocked()
+{
+    if (fp_ == nullptr)
+    {
+        return;
+    }
+    lastFlush_ = ::time(nullptr);
+    flushedBytes_ = writtenBytes_;
+    ::fflush(fp_);
+    if (syncToDisk_)
+    {
+        int fd = ::fcntl(::fileno(fp_), F_DUPFD_CLOEXEC, 0);
+        if (fd >= 0)
+        {
+            std::unique_lock<std::mutex> lock(syncMutex_);
+            syncFds_.push_back(fd);
+            syncCond_.notify_one();
+        }
+    }
+}
+
+// 在构造函数中或者mutex_的锁内调用
+bool LogFile::rollFileUnlocked()
+{
+    time_t now = ::time(nullptr);
+    if (now <= lastRoll_ && fp_ != nullptr)
+    {
+        return false;
+    }
+    std::string filename = getLogFileName(now);
+    FILE *fp = ::fopen(filename.c_str(), "ae"); // O_APPEND|O_CLOEXEC
+    if (fp == nullptr)
+    {
+        // 不能用LOG_ERROR，日志可能正输出到这里
+        fprintf(stderr, "LogFile::rollFile open %s failed: %s\n", filename.c_str(), strerror(errno));
+        return false;
+    }
+    if (fp_)
+    {
+        // 旧文件写进内核之后交给后台线程同步，这里只关闭，之后ioBuffer_才能给新文件用
+        flushUnlocked();
+        ::fclose(fp_);
+    }
+    ::setvbuf(fp, ioBuffer_, _IOFBF, sizeof ioBuffer_);
+    fp_ = fp;
+    filename_ = filename;
+    writtenBytes_ = 0;
+    flushedBytes_ = 0;
+    lastRoll_ = now;
+    lastFlush_ = now;
+    startOfPeriod_ = now / rollInterval_ * rollInterval_;
+    return true;
+}
+
+std::string LogFile::getLogFileName(time_t now) const
+{
+    std::string filename(basename_);
+    char timebuf[32];
+    tm tmResult;
+    ::localtime_r(&now, &tmResult);
+    ::strftime(timebuf, sizeof timebuf, ".%Y%m%d-%H%M%S.", &tmResult);
+    filename += timebuf;
+
+    char hostname[256] = {0};
+    if (::gethostname(hostname, sizeof hostname - 1) != 0)
+    {
+        ::strcpy(hostname, "unknownhost");
+    }
+    filename += hostname;
+
+    char pidbuf[32];
+    snprintf(pidbuf, sizeof pidbuf, ".%d.log", ::getpid());
+    filename += pidbuf;
+    return filename;
+}
+
+void LogFile::syncThreadFunc()
+{
+    const std::chrono::seconds interval(std::max(flushInterval_, 1));
+    while (true)
+    {
+        int fd;
+        {
+            std::unique_lock<std::mutex> lock(syncMutex_);
+            if (syncFds_.empty() && syncRunning_)
+            {
+                syncCond_.wait_for(lock, interval);
+            }
+            if (syncFds_.empty())
+            {
+                if (!syncRunning_)
+                {
+                    return;
+                }
+                // 一段时间没有新的刷新请求，可能是写日志的线程安静下来了；flushIfDue要拿mutex_，先放开syncMutex_
+                lock.unlock();
+                flushIfDue();
+                continue;
+            }
+            fd = syncFds_.front();
+            syncFds_.pop_front();
+        }
+        ::fdatasync(fd);
+        ::close(fd);
+    }
+}
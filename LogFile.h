@@ -0,0 +1,74 @@
+#pragma once
+
+#include "noncopyable.h"
+#include "Thread.h"
+
+#include <string>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <time.h>
+#include <stdio.h>
+
+/****************
+ * 日志文件输出，文件名为 basename.年月日-时分秒.主机名.pid.log
+ * 写入经过一个大的stdio缓冲区，按大小(rollSize)和时间(rollInterval秒，按整点对齐)滚动新文件；
+ * 每隔flushInterval秒fflush一次，而不是每行都刷新；没有新日志时由后台线程按同样的间隔刷新，
+ * 安静下来的进程最后几行日志不会一直留在缓冲区里；
+ * 刷新之后的fdatasync也交给这个后台线程做，写日志的线程不会阻塞在磁盘上
+ * 作为Logger的输出:
+ *     LogFile file("/var/log/server", 512 * 1024 * 1024);
+ *     Logger::instance().setOutput(std::bind(&LogFile::append, &file, _1, _2));
+ *     Logger::instance().setFlush(std::bind(&LogFile::flush, &file));
+ * 或者作为AsyncLogging的sink: async.setSink(std::bind(&LogFile::append, ...), std::bind(&LogFile::flush, ...))
+ * *************/
+class LogFile : noncopyable
+{
+public:
+    LogFile(const std::string &basename, size_t rollSize,
+            int flushInterval = 3, int rollInterval = 24 * 60 * 60, bool syncToDisk = true);
+    ~LogFile();
+
+    // 可以在多个线程中调用
+    void append(const char *line, size_t len);
+    // 把缓冲区写进内核，并请求后台线程fdatasync
+    void flush();
+    // 立即换一个新文件，同一秒内最多换一次
+    bool rollFile();
+
+    const std::string &currentFile() const { return filename_; }
+
+private:
+    static const size_t kIoBufferSize = 256 * 1024;
+
+    void appendUnlocked(const char *line, size_t len);
+    void flushUnlocked();
+    bool rollFileUnlocked();
+    // 后台线程调用: 距上次刷新超过flushInterval并且有没刷新的数据时刷新
+    void flushIfDue();
+    std::string getLogFileName(time_t now) const;
+    void syncThreadFunc();
+
+    const std::string basename_;
+    const size_t rollSize_;
+    const int flushInterval_;
+    const int rollInterval_;
+    const bool syncToDisk_;
+
+    std::mutex mutex_;
+    FILE *fp_;
+    std::string filename_;
+    char ioBuffer_[kIoBufferSize];
+    size_t writtenBytes_;
+    size_t flushedBytes_; // 上次刷新时的writtenBytes_
+    time_t startOfPeriod_;
+    time_t lastRoll_;
+    time_t lastFlush_;
+
+    // 后台线程: 定时刷新，以及fdatasync刷新过的文件(dup出来的fd)，滚动之后旧文件也能同步完再关闭
+    std::mutex syncMutex_;
+    std::condition_variable syncCond_;
+    std::deque<int> syncFds_;
+    bool syncRunning_;
+    Thread syncThread_;
+};
@@ -1,39 +1,66 @@
 #include <iostream>
+#include <string.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <algorithm>
 #include "Logger.h"
 #include "TimeStamp.h"
 
+#ifdef MUDEBUG
+std::atomic_int g_logLevel(DEBUG);
+#else
+std::atomic_int g_logLevel(INFO);
+#endif
+
+// 默认输出，与原来一样每行刷新一次std::cout
+static void defaultOutput(const char *line, size_t len)
+{
+    std::cout.write(line, len);
+    std::cout.flush();
+}
+
+Logger::Logger()
+    : output_(defaultOutput)
+{
+}
+
 Logger &Logger::instance() // 获取唯一的实例对象
 {
     static Logger logger;
     return logger;
 }
-void Logger::setLogLevel(int level) // 设置日志级别
-{
-    logLevel_ = level;
-}
 
 // 写日志 [级别信息] time : msg
-void Logger::log(std::string msg)
+void Logger::log(LogLevel level, const char *fmt, ...)
 {
-    switch (logLevel_)
+    static const char *const kLevelNames[] = {"[DEBUG] ", "[INFO] ", "[ERROR] ", "[FATAL] "};
+    static const size_t kMaxLine = 1024 + 128;
+    // 每个线程在自己的缓冲区里拼好整行，只调用一次output，异步后端的锁内只有一次memcpy
+    static thread_local char line[kMaxLine];
+    size_t len = strlen(kLevelNames[level]);
+    ::memcpy(line, kLevelNames[level], len);
+
+    // 打印时间和msg，时间前缀同一秒内只拷贝缓存
+    len += TimeStamp::now().formatTo(line + len);
+    ::memcpy(line + len, " : ", 3);
+    len += 3;
+
+    va_list args;
+    va_start(args, fmt);
+    int n = vsnprintf(line + len, kMaxLine - len - 1, fmt, args);
+    va_end(args);
+    if (n > 0)
     {
-    case INFO:
-        std::cout << "[INFO] ";
-        break;
-    case DEBUG:
-        std::cout << "[DEBUG] ";
-        break;
-    case ERROR:
-        std::cout << "[ERROR] ";
-        break;
-    case FATAL:
-        std::cout << "[FATAL] ";
-        break;
-
-    default:
-        break;
+        len += std::min(static_cast<size_t>(n), kMaxLine - len - 2); // 超长的日志被截断
     }
+    line[len++] = '\n';
+    output_(line, len);
+}
 
-    // 打印时间和msg
-    std::cout << TimeStamp::now().toString() << " : " << msg << std::endl;
-}
\ No newline at end of file
+void Logger::flush()
+{
+    if (flush_)
+    {
+        flush_();
+    }
+}
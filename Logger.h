@@ -1,74 +1,96 @@
 #pragma once
 
 #include <string>
+#include <functional>
+#include <atomic>
+#include <stdlib.h>
 
 #include "noncopyable.h"
 
-// 定义日志的级别INFO  ERROR FATAL DEBUG WARNING
-
+// 定义日志的级别，数值越大越严重，低于阈值的日志不会被格式化
 enum LogLevel
 {
+    DEBUG, // 调试信息
     INFO,  // 普通信息
     ERROR, // 错误信息
     FATAL, // core信息
-    DEBUG, // 调试信息
 };
 
+// 编译期的最低级别，低于它的日志语句整条被编译器删掉(参数也不会求值)，
+// 比如-DMUDUO_MIN_LOG_LEVEL=1去掉所有LOG_DEBUG，FATAL不受影响
+#ifndef MUDUO_MIN_LOG_LEVEL
+#define MUDUO_MIN_LOG_LEVEL 0
+#endif
+
+// 运行期的最低级别，所有线程共享
+extern std::atomic_int g_logLevel;
+
 // 输出一个日志类
 class Logger : noncopyable
 {
 public:
-    static Logger &instance();   // 获取唯一的实例对象
-    void setLogLevel(int level); // 设置日志级别
-    void log(std::string msg);   // 写日志
+    // 一条完整的日志(含结尾的换行)交给output，默认写到std::cout
+    using OutputFunc = std::function<void(const char *line, size_t len)>;
+    using FlushFunc = std::function<void()>;
+
+    static Logger &instance(); // 获取唯一的实例对象
+
+    // 设置运行期的日志级别阈值，可以在任意线程中随时调用；默认INFO，定义了MUDEBUG时为DEBUG
+    static void setLogLevel(LogLevel level) { g_logLevel.store(level, std::memory_order_relaxed); }
+    static LogLevel logLevel() { return static_cast<LogLevel>(g_logLevel.load(std::memory_order_relaxed)); }
+    static bool enabled(LogLevel level) { return level >= g_logLevel.load(std::memory_order_relaxed); }
+
+    // 写日志，调用方已经判断过级别，格式化直接写进线程局部的行缓冲区
+    void log(LogLevel level, const char *fmt, ...) __attribute__((format(printf, 3, 4)));
+
+    // 在其他线程开始写日志之前设置，比如换成AsyncLogging::append
+    void setOutput(const OutputFunc &output) { output_ = output; }
+    // FATAL日志在退出进程之前会调用
+    void setFlush(const FlushFunc &flush) { flush_ = flush; }
+    void flush();
 
 private:
-    // 设置日志级别
-    int logLevel_;
-    Logger() {}
+    OutputFunc output_;
+    FlushFunc flush_;
+    Logger();
 };
 
-#define LOG_INFO(logmsgformat, ...)                       \
-    do                                                    \
-    {                                                     \
-        Logger &logger = Logger::instance();              \
-        logger.setLogLevel(INFO);                         \
-        char buf[1024] = {0};                             \
-        snprintf(buf, 1024, logmsgformat, ##__VA_ARGS__); \
-        logger.log(buf);                                  \
-    } while (0);
-
-#ifdef MUDEBUG
-#define LOG_DEBUG(logmsgformat, ...)                      \
-    do                                                    \
-    {                                                     \
-        Logger &logger = Logger::instance();              \
-        logger.setLogLevel(DEBUG);                        \
-        char buf[1024] = {0};                             \
-        snprintf(buf, 1024, logmsgformat, ##__VA_ARGS__); \
-        logger.log(buf);                                   \
-    } while (0);
-#else
-#define LOG_DEBUG(logmsgformat, ...)
-#endif
+// 关闭的日志语句只有一次比较，格式化和参数求值都在分支之内
+#define MUDUO_LOG_ENABLED(level) ((level) >= MUDUO_MIN_LOG_LEVEL && Logger::enabled(level))
+
+#define LOG_DEBUG(logmsgformat, ...)                                             \
+    do                                                                           \
+    {                                                                            \
+        if (__builtin_expect(MUDUO_LOG_ENABLED(DEBUG), 0))                       \
+        {                                                                        \
+            Logger::instance().log(DEBUG, logmsgformat, ##__VA_ARGS__);          \
+        }                                                                        \
+    } while (0)
+
+#define LOG_INFO(logmsgformat, ...)                                              \
+    do                                                                           \
+    {                                                                            \
+        if (MUDUO_LOG_ENABLED(INFO))                                             \
+        {                                                                        \
+            Logger::instance().log(INFO, logmsgformat, ##__VA_ARGS__);           \
+        }                                                                        \
+    } while (0)
+
+#define LOG_ERROR(logmsgformat, ...)                                             \
+    do                                                                           \
+    {                                                                            \
+        if (MUDUO_LOG_ENABLED(ERROR))                                            \
+        {                                                                        \
+            Logger::instance().log(ERROR, logmsgformat, ##__VA_ARGS__);          \
+        }                                                                        \
+    } while (0)
 
-#define LOG_ERROR(logmsgformat, ...)                      \
-    do                                                    \
-    {                                                     \
-        Logger &logger = Logger::instance();              \
-        logger.setLogLevel(ERROR);                        \
-        char buf[1024] = {0};                             \
-        snprintf(buf, 1024, logmsgformat, ##__VA_ARGS__); \
-        logger.log(buf);                                   \
-    } while (0);
-
-#define LOG_FATAL(logmsgformat, ...)                      \
-    do                                                    \
-    {                                                     \
-        Logger &logger = Logger::instance();              \
-        logger.setLogLevel(FATAL);                        \
-        char buf[1024] = {0};                             \
-        snprintf(buf, 1024, logmsgformat, ##__VA_ARGS__); \
-        logger.log(buf);                                  \
-        exit(-1);                                         \
-    } while (0);
+// FATAL不受阈值影响，写完刷新输出后退出进程
+#define LOG_FATAL(logmsgformat, ...)                                             \
+    do                                                                           \
+    {                                                                            \
+        Logger &logger = Logger::instance();                                     \
+        logger.log(FATAL, logmsgformat, ##__VA_ARGS__);                          \
+        logger.flush();                                                          \
+        exit(-1);                                                                \
+    } while (0)
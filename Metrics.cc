@@ -0,0 +1,194 @@
+#include "Metrics.h"
+
+#include <mutex>
+#include <stdio.h>
+#include <inttypes.h>
+
+__thread Metrics::Shard *Metrics::t_shard = nullptr;
+
+namespace
+{
+
+struct MetricInfo
+{
+    const char *name;
+    const char *help;
+    bool gauge;
+};
+
+const MetricInfo kMetricInfos[Metrics::kNumMetrics] = {
+    {"mymuduo_connections_accepted_total", "Connections accepted by Acceptor.", false},
+    {"mymuduo_accept_errors_total", "Failed accept() calls.", false},
+    {"mymuduo_server_connections", "Connections currently managed by TcpServer instances.", true},
+    {"mymuduo_connections_open", "Live TcpConnection objects, including client side.", true},
+    {"mymuduo_connections_closed_total", "Connections closed.", false},
+    {"mymuduo_bytes_read_total", "Bytes read from sockets.", false},
+    {"mymuduo_bytes_written_total", "Bytes written to sockets.", false},
+    {"mymuduo_buffer_bytes", "Memory held by connection input and output buffers.", true},
+    {"mymuduo_high_water_mark_hits_total", "Times pending output crossed the high water mark.", false},
+    {"mymuduo_epoll_wakeups_total", "epoll_wait returns.", false},
+    {"mymuduo_epoll_events_total", "Events returned by epoll_wait.", false},
+    {"mymuduo_pending_functors", "Functors queued to event loops and not yet run.", true},
+    {"mymuduo_steered_connections_total", "Connections accepted in CPU steering mode.", false},
+    {"mymuduo_steered_cpu_matches_total", "Steered connections whose RX CPU matched the serving loop's CPU.", false},
+};
+
+// 所有线程的Shard，以及已退出线程的累计值
+class Registry : noncopyable
+{
+public:
+    static Registry &instance()
+    {
+        // 不析构: 其他线程退出时可能晚于静态对象的析构
+        static Registry *registry = new Registry();
+        return *registry;
+    }
+
+    void add(Metrics::Shard *shard)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        shards_.push_back(shard);
+    }
+
+    // 线程退出: 把它的值并入retired_再移除
+    void retire(Metrics::Shard *shard)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (int i = 0; i < Metrics::kNumMetrics; ++i)
+        {
+            retired_[i] += shard->values[i].load(std::memory_order_relaxed);
+        }
+        for (size_t i = 0; i < shards_.size(); ++i)
+        {
+            if (shards_[i] == shard)
+            {
+                shards_[i] = shards_.back();
+                shards_.pop_back();
+                break;
+            }
+        }
+    }
+
+    void addRetired(Metrics::Id id, int64_t delta)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        retired_[id] += delta;
+    }
+
+    std::vector<int64_t> sum()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::vector<int64_t> values(retired_, retired_ + Metrics::kNumMetrics);
+        for (Metrics::Shard *shard : shards_)
+        {
+            for (int i = 0; i < Metrics::kNumMetrics; ++i)
+            {
+                values[i] += shard->values[i].load(std::memory_order_relaxed);
+            }
+        }
+        return values;
+    }
+
+private:
+    Registry()
+    {
+        for (int i = 0; i < Metrics::kNumMetrics; ++i)
+        {
+            retired_[i] = 0;
+        }
+    }
+
+    std::mutex mutex_;
+    std::vector<Metrics::Shard *> shards_;
+    int64_t retired_[Metrics::kNumMetrics];
+};
+
+// 线程退出时析构，注销本线程的Shard；Shard直接放在thread_local对象里，保证按缓存行对齐
+struct ShardOwner
+{
+    ShardOwner()
+    {
+        for (int i = 0; i < Metrics::kNumMetrics; ++i)
+        {
+            shard.values[i].store(0, std::memory_order_relaxed);
+        }
+        Registry::instance().add(&shard);
+    }
+    ~ShardOwner()
+    {
+        Registry::instance().retire(&shard);
+    }
+
+    Metrics::Shard shard;
+};
+
+__thread bool t_exited = false;
+
+} // namespace
+
+void Metrics::addSlow(Id id, int64_t delta)
+{
+    if (t_exited)
+    {
+        // 本线程的thread_local对象已经析构，之后的记录很少，直接加锁累计
+        Registry::instance().addRetired(id, delta);
+        return;
+    }
+    struct Guard
+    {
+        ~Guard()
+        {
+            t_shard = nullptr;
+            t_exited = true;
+        }
+        ShardOwner owner;
+    };
+    static thread_local Guard guard;
+    t_shard = &guard.owner.shard;
+    add(id, delta);
+}
+
+std::vector<int64_t> Metrics::snapshot()
+{
+    return Registry::instance().sum();
+}
+
+std::string Metrics::prometheusText()
+{
+    std::vector<int64_t> values = snapshot();
+    std::string text;
+    char line[256];
+    for (int i = 0; i < kNumMetrics; ++i)
+    {
+        const MetricInfo &info = kMetricInfos[i];
+        snprintf(line, sizeof line, "# HELP %s %s\n# TYPE %s %s\n%s %" PRId64 "\n",
+                 info.name, info.help, info.name, info.gauge ? "gauge" : "counter", info.name, values[i]);
+        text += line;
+    }
+    // 平均每次唤醒处理的事件数(进程启动以来)，短时间窗口内的值用两个counter的rate之比
+    double perWakeup = values[kEpollWakeups] > 0
+                           ? static_cast<double>(values[kEpollEvents]) / values[kEpollWakeups]
+                           : 0;
+    snprintf(line, sizeof line,
+             "# HELP mymuduo_epoll_events_per_wakeup Average events per epoll_wait return since start.\n"
+             "# TYPE mymuduo_epoll_events_per_wakeup gauge\n"
+             "mymuduo_epoll_events_per_wakeup %.3f\n",
+             perWakeup);
+    text += line;
+    return text;
+}
+
+const char *Metrics::name(Id id)
+{
+    return kMetricInfos[id].name;
+}
+
+const char *Metrics::help(Id id)
+{
+    return kMetricInfos[id].help;
+}
+
+bool Metrics::isGauge(Id id)
+{
+    return kMetricInfos[id].gauge;
+}
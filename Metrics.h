@@ -0,0 +1,77 @@
+#pragma once
+
+#include "noncopyable.h"
+
+#include <atomic>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+/****************
+ * 库内置的运行指标: 一组固定的计数器(counter)和仪表(gauge)
+ * 每个线程只写自己的一份MetricsShard，单写者只需要relaxed的load+store，不加锁也没有带lock前缀的原子加；
+ * 读取(snapshot)时在锁内把所有线程的值加起来，线程退出时它的值并入全局的累计值，不会丢失
+ * gauge也按增量记录(如连接对象构造+1、析构-1)，各线程增量之和就是当前值，增减可以发生在不同的线程
+ * 各指标的来源:
+ *   Acceptor      kConnectionsAccepted kAcceptErrors
+ *   TcpServer     kServerConnections kSteeredConnections kSteeredCpuMatches
+ *   TcpConnection kConnectionsOpen kConnectionsClosed kBytesRead kBytesWritten kBufferBytes kHighWaterMarkHits
+ *   EPoller       kEpollWakeups kEpollEvents
+ *   EventLoop     kPendingFunctors
+ * 通过MetricsServer以Prometheus文本格式对外提供
+ * *************/
+class Metrics : noncopyable
+{
+public:
+    enum Id
+    {
+        kConnectionsAccepted, // counter 成功accept的连接数
+        kAcceptErrors,        // counter accept失败次数
+        kServerConnections,   // gauge   各TcpServer当前管理的连接数
+        kConnectionsOpen,     // gauge   存活的TcpConnection对象数(含客户端)
+        kConnectionsClosed,   // counter 关闭的连接数
+        kBytesRead,           // counter 从socket读到的字节数
+        kBytesWritten,        // counter 写入socket的字节数
+        kBufferBytes,         // gauge   连接输入输出缓冲区占用的内存
+        kHighWaterMarkHits,   // counter 待发送数据越过高水位线的次数
+        kEpollWakeups,        // counter epoll_wait返回次数
+        kEpollEvents,         // counter epoll_wait返回的事件总数
+        kPendingFunctors,     // gauge   各loop排队等待执行的回调数
+        kSteeredConnections,  // counter 按CPU分流模式下accept的连接数
+        kSteeredCpuMatches,   // counter 其中收包CPU与所在loop绑定的CPU相同的连接数
+        kNumMetrics
+    };
+
+    // 每个线程一份，按缓存行对齐，避免和其他线程的数据伪共享
+    struct alignas(64) Shard
+    {
+        std::atomic<int64_t> values[kNumMetrics];
+    };
+
+    static void add(Id id, int64_t delta)
+    {
+        Shard *shard = t_shard;
+        if (__builtin_expect(shard == nullptr, 0))
+        {
+            addSlow(id, delta);
+            return;
+        }
+        std::atomic<int64_t> &value = shard->values[id];
+        value.store(value.load(std::memory_order_relaxed) + delta, std::memory_order_relaxed);
+    }
+
+    // 所有线程之和，下标为Id
+    static std::vector<int64_t> snapshot();
+    // Prometheus文本格式(text/plain; version=0.0.4)
+    static std::string prometheusText();
+
+    static const char *name(Id id);
+    static const char *help(Id id);
+    static bool isGauge(Id id);
+
+private:
+    // 线程第一次记录时注册自己的Shard，线程退出后的记录直接加到全局累计值
+    static void addSlow(Id id, int64_t delta);
+
+    static __thread Shard *t_shard;
+};
@@ -0,0 +1,28 @@
+#include "MetricsServer.h"
+#include "Metrics.h"
+
+MetricsServer::MetricsServer(EventLoop *loop, const InetAddress &listenAddr, const std::string &name)
+    : server_(loop, listenAddr, name)
+{
+    server_.setHttpCallback(std::bind(&MetricsServer::onRequest, this,
+                                      std::placeholders::_1, std::placeholders::_2));
+}
+
+void MetricsServer::onRequest(const HttpRequest &request, HttpResponse *response)
+{
+    if (request.method() != HttpRequest::kGet || !(request.path() == StringPiece("/metrics")))
+    {
+        response->setStatusCode(HttpResponse::k404NotFound);
+        response->setContentType("text/plain");
+        response->setBody("not found\n");
+        return;
+    }
+    std::string body = Metrics::prometheusText();
+    if (collector_)
+    {
+        collector_(&body);
+    }
+    response->setStatusCode(HttpResponse::k200Ok);
+    response->setContentType("text/plain; version=0.0.4");
+    response->setBody(std::move(body));
+}
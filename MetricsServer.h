@@ -0,0 +1,32 @@
+#pragma once
+
+#include "HttpServer.h"
+#include "noncopyable.h"
+
+#include <functional>
+#include <string>
+
+/**************************
+ * 以Prometheus文本格式提供Metrics中的运行指标: GET /metrics
+ * 用库自己的HttpServer实现，一般和业务共用baseLoop，抓取时在该loop线程里汇总各线程的值，
+ * 不影响IO线程上的计数
+ **************************/
+class MetricsServer : noncopyable
+{
+public:
+    // 追加应用自己的指标，需要按Prometheus文本格式写入
+    using Collector = std::function<void(std::string *)>;
+
+    MetricsServer(EventLoop *loop, const InetAddress &listenAddr,
+                  const std::string &name = "MetricsServer");
+
+    void setCollector(const Collector &cb) { collector_ = cb; }
+
+    void start() { server_.start(); }
+
+private:
+    void onRequest(const HttpRequest &request, HttpResponse *response);
+
+    HttpServer server_;
+    Collector collector_;
+};
@@ -0,0 +1,85 @@
+#include "Rpc.h"
+#include "Buffer.h"
+
+#include <string.h>
+#include <endian.h>
+
+const char *rpcStatusName(RpcStatus status)
+{
+    switch (status)
+    {
+    case kRpcOk:
+        return "ok";
+    case kRpcNoMethod:
+        return "no such method";
+    case kRpcError:
+        return "error";
+    case kRpcTimeout:
+        return "timeout";
+    case kRpcDisconnected:
+        return "disconnected";
+    default:
+        return "bad response";
+    }
+}
+
+static const size_t kRpcHeaderLen = 1 + 8 + 1; // type + id + 方法名长度/status
+
+bool parseRpcMessage(const char *data, size_t len, RpcMessage *message)
+{
+    if (len < kRpcHeaderLen)
+    {
+        return false;
+    }
+    uint64_t be64;
+    ::memcpy(&be64, data + 1, sizeof be64);
+    message->id = be64toh(be64);
+    uint8_t last = static_cast<uint8_t>(data[9]);
+    const char *rest = data + kRpcHeaderLen;
+    size_t restLen = len - kRpcHeaderLen;
+
+    if (data[0] == kRpcRequest)
+    {
+        if (restLen < last)
+        {
+            return false;
+        }
+        message->type = kRpcRequest;
+        message->status = kRpcOk;
+        message->method = StringPiece(rest, last);
+        message->body = StringPiece(rest + last, restLen - last);
+        return true;
+    }
+    if (data[0] == kRpcResponse && last <= kRpcError)
+    {
+        message->type = kRpcResponse;
+        message->status = static_cast<RpcStatus>(last);
+        message->method = StringPiece();
+        message->body = StringPiece(rest, restLen);
+        return true;
+    }
+    return false;
+}
+
+static void appendHeader(Buffer *buf, RpcMessageType type, uint64_t id, uint8_t last)
+{
+    char header[kRpcHeaderLen];
+    header[0] = static_cast<char>(type);
+    uint64_t be64 = htobe64(id);
+    ::memcpy(header + 1, &be64, sizeof be64);
+    header[9] = static_cast<char>(last);
+    buf->append(header, sizeof header);
+}
+
+void appendRpcRequest(Buffer *buf, uint64_t id, const StringPiece &method, const StringPiece &body)
+{
+    appendHeader(buf, kRpcRequest, id, static_cast<uint8_t>(method.size()));
+    buf->append(method.data(), method.size());
+    buf->append(body.data(), body.size());
+}
+
+void appendRpcResponse(Buffer *buf, uint64_t id, RpcStatus status, const StringPiece &body)
+{
+    appendHeader(buf, kRpcResponse, id, static_cast<uint8_t>(status));
+    buf->append(body.data(), body.size());
+}
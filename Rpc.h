@@ -0,0 +1,49 @@
+#pragma once
+
+#include "StringPiece.h"
+
+#include <stdint.h>
+
+class Buffer;
+
+/**************************
+ * RPC消息的格式，整个消息作为LengthHeaderCodec的一帧(4字节长度头)发送:
+ * 请求: | type=kRpcRequest(1) | requestId(8) | 方法名长度(1) | 方法名 | 请求体 |
+ * 应答: | type=kRpcResponse(1) | requestId(8) | status(1) | 应答体 |
+ * 整数都是网络字节序，同一个连接上的请求可以乱序应答，由requestId对应
+ **************************/
+
+enum RpcStatus
+{
+    kRpcOk = 0,
+    kRpcNoMethod = 1,     // 服务端没有注册该方法
+    kRpcError = 2,        // 处理函数返回错误，应答体是错误信息
+    kRpcTimeout = 3,      // 以下只在客户端产生
+    kRpcDisconnected = 4, // 调用时未连接或等待应答期间连接断开
+    kRpcBadResponse = 5,
+};
+
+const char *rpcStatusName(RpcStatus status);
+
+enum RpcMessageType
+{
+    kRpcRequest = 1,
+    kRpcResponse = 2,
+};
+
+struct RpcMessage
+{
+    RpcMessageType type;
+    uint64_t id;
+    RpcStatus status;   // 只对应答有效
+    StringPiece method; // 只对请求有效
+    StringPiece body;
+};
+
+const size_t kRpcMaxMethodLen = 255;
+
+// 解析一帧RPC消息，视图指向data，格式不对时返回false
+bool parseRpcMessage(const char *data, size_t len, RpcMessage *message);
+// 编码后的消息追加到buf，再用LengthHeaderCodec::send(conn, buf)发送
+void appendRpcRequest(Buffer *buf, uint64_t id, const StringPiece &method, const StringPiece &body);
+void appendRpcResponse(Buffer *buf, uint64_t id, RpcStatus status, const StringPiece &body);
@@ -0,0 +1,120 @@
+#include "RpcClient.h"
+#include "EventLoop.h"
+#include "TcpConnection.h"
+#include "Logger.h"
+
+RpcClient::RpcClient(EventLoop *loop)
+    : loop_(loop),
+      codec_(std::bind(&RpcClient::onFrame, this, std::placeholders::_1, std::placeholders::_2,
+                       std::placeholders::_3, std::placeholders::_4)),
+      nextId_(1)
+{
+}
+
+RpcClient::~RpcClient()
+{
+    for (auto &call : pending_)
+    {
+        loop_->cancel(call.second.timer);
+    }
+}
+
+void RpcClient::onConnection(const TcpConnectionPtr &conn)
+{
+    if (conn->connected())
+    {
+        conn_ = conn;
+    }
+    else
+    {
+        conn_.reset();
+        failAll(kRpcDisconnected);
+    }
+}
+
+void RpcClient::call(const StringPiece &method, const StringPiece &request,
+                     ResponseCallback cb, double timeout)
+{
+    if (loop_->isInLoopThread())
+    {
+        callInLoop(method, request, cb, timeout);
+    }
+    else
+    {
+        // 调用方的数据在loop执行时可能已经失效，拷贝一份
+        std::string methodCopy = method.asString();
+        std::string requestCopy = request.asString();
+        loop_->queueInLoop([this, methodCopy, requestCopy, cb, timeout]() mutable
+                           { callInLoop(methodCopy, requestCopy, cb, timeout); });
+    }
+}
+
+void RpcClient::callInLoop(const StringPiece &method, const StringPiece &request,
+                           ResponseCallback &cb, double timeout)
+{
+    if (!conn_)
+    {
+        cb(kRpcDisconnected, StringPiece());
+        return;
+    }
+    if (method.size() > kRpcMaxMethodLen)
+    {
+        LOG_ERROR("RpcClient::call method name too long \n");
+        cb(kRpcNoMethod, StringPiece());
+        return;
+    }
+
+    uint64_t id = nextId_++;
+    PendingCall &call = pending_[id];
+    call.callback = std::move(cb);
+    // 超时都相同时新定时器总是排在最后，不需要重新设置timerfd
+    call.timer = loop_->runAfter(timeout, std::bind(&RpcClient::onTimeout, this, id));
+
+    Buffer buf(10 + method.size() + request.size() + LengthHeaderCodec::kChecksumLen);
+    appendRpcRequest(&buf, id, method, request);
+    codec_.send(conn_, &buf);
+}
+
+void RpcClient::onFrame(const TcpConnectionPtr &conn, const char *data, size_t len, TimeStamp)
+{
+    RpcMessage message;
+    if (!parseRpcMessage(data, len, &message) || message.type != kRpcResponse)
+    {
+        LOG_ERROR("RpcClient bad response from %s, closing \n", conn->name().c_str());
+        conn->forceClose();
+        return;
+    }
+    auto it = pending_.find(message.id);
+    if (it == pending_.end())
+    {
+        return; // 已经超时的调用
+    }
+    loop_->cancel(it->second.timer);
+    // 先从表中删除再回调，回调里可能发起新的调用
+    ResponseCallback cb = std::move(it->second.callback);
+    pending_.erase(it);
+    cb(message.status, message.body);
+}
+
+void RpcClient::onTimeout(uint64_t id)
+{
+    auto it = pending_.find(id);
+    if (it == pending_.end())
+    {
+        return;
+    }
+    ResponseCallback cb = std::move(it->second.callback);
+    pending_.erase(it);
+    cb(kRpcTimeout, StringPiece());
+}
+
+void RpcClient::failAll(RpcStatus status)
+{
+    std::unordered_map<uint64_t, PendingCall> pending;
+    pending.swap(pending_);
+    for (auto &call : pending)
+    {
+        loop_->cancel(call.second.timer);
+        call.second.callback(status, StringPiece());
+    }
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include "LengthHeaderCodec.h"
+#include "TimerId.h"
+#include "Rpc.h"
+#include "noncopyable.h"
+
+#include <functional>
+#include <string>
+#include <unordered_map>
+
+class EventLoop;
+
+/**************************
+ * RPC客户端存根，在一条连接上复用任意多个并发调用
+ * 每个调用分配一个64位的requestId登记在未完成调用表中，应答按id找到对应的回调，可以乱序到达；
+ * 超时或连接断开时以kRpcTimeout/kRpcDisconnected回调
+ *
+ * 用法和LengthHeaderCodec一样，把onConnection/onMessage设置为客户端连接的回调
+ **************************/
+class RpcClient : noncopyable
+{
+public:
+    // 在loop线程中回调，response只在回调期间有效
+    using ResponseCallback = std::function<void(RpcStatus status, const StringPiece &response)>;
+
+    explicit RpcClient(EventLoop *loop);
+    // 需要在loop线程中析构，未完成的调用不再回调
+    ~RpcClient();
+
+    void onConnection(const TcpConnectionPtr &conn);
+    void onMessage(const TcpConnectionPtr &conn, Buffer *buf, TimeStamp receiveTime)
+    {
+        codec_.onMessage(conn, buf, receiveTime);
+    }
+
+    // 可以在任意线程中调用，在loop线程中调用时不拷贝method和request，timeout单位秒
+    void call(const StringPiece &method, const StringPiece &request,
+              ResponseCallback cb, double timeout = 5.0);
+
+    bool connected() const { return conn_ != nullptr; }
+    // 未完成的调用数，只在loop线程中访问
+    size_t pendingCalls() const { return pending_.size(); }
+
+private:
+    struct PendingCall
+    {
+        ResponseCallback callback;
+        TimerId timer;
+    };
+
+    void callInLoop(const StringPiece &method, const StringPiece &request,
+                    ResponseCallback &cb, double timeout);
+    void onFrame(const TcpConnectionPtr &conn, const char *data, size_t len, TimeStamp receiveTime);
+    void onTimeout(uint64_t id);
+    void failAll(RpcStatus status);
+
+    EventLoop *loop_;
+    LengthHeaderCodec codec_;
+    TcpConnectionPtr conn_;
+    uint64_t nextId_;
+    std::unordered_map<uint64_t, PendingCall> pending_;
+};
@@ -0,0 +1,101 @@
+#include "RpcServer.h"
+#include "Logger.h"
+
+void RpcResponder::send(RpcStatus status, const StringPiece &body) const
+{
+    Buffer buf;
+    appendRpcResponse(&buf, id_, status, body);
+    codec_->send(conn_, &buf);
+}
+
+// 在offload线程中执行，request是拷贝出来的请求体
+static void runOffloaded(const RpcServer::RpcHandler &handler, const std::string &request,
+                         const RpcResponder &responder)
+{
+    handler(request, responder);
+}
+
+RpcServer::RpcServer(EventLoop *loop, const InetAddress &listenAddr, const std::string &name,
+                     TcpServer::Option option)
+    : server_(loop, listenAddr, name, option),
+      codec_(std::bind(&RpcServer::onFrame, this, std::placeholders::_1, std::placeholders::_2,
+                       std::placeholders::_3, std::placeholders::_4)),
+      offloadPool_(name + "-offload"),
+      offloadThreads_(0)
+{
+    server_.setConnectionCallback(
+        std::bind(&RpcServer::onConnection, this, std::placeholders::_1));
+    server_.setMessageCallback(
+        std::bind(&LengthHeaderCodec::onMessage, &codec_,
+                  std::placeholders::_1, std::placeholders::_2, std::placeholders::_3));
+    // 一次读到的多个请求的应答在本轮结束时合并发送
+    server_.setCorkWrites(true);
+}
+
+RpcServer::~RpcServer()
+{
+    offloadPool_.stop();
+}
+
+void RpcServer::registerMethod(const std::string &method, const RpcHandler &handler, Dispatch dispatch)
+{
+    if (method.size() > kRpcMaxMethodLen)
+    {
+        LOG_ERROR("RpcServer::registerMethod method name %s too long \n", method.c_str());
+        return;
+    }
+    auto it = methods_.find(method);
+    if (it == methods_.end())
+    {
+        methodNames_.push_back(method);
+        it = methods_.insert(std::make_pair(StringPiece(methodNames_.back()), Method())).first;
+    }
+    Method &entry = it->second;
+    entry.handler = handler;
+    entry.dispatch = dispatch;
+}
+
+void RpcServer::start()
+{
+    if (offloadThreads_ > 0)
+    {
+        offloadPool_.start(offloadThreads_);
+    }
+    server_.start();
+}
+
+void RpcServer::onConnection(const TcpConnectionPtr &conn)
+{
+    if (connectionCallback_)
+    {
+        connectionCallback_(conn);
+    }
+}
+
+void RpcServer::onFrame(const TcpConnectionPtr &conn, const char *data, size_t len, TimeStamp)
+{
+    RpcMessage message;
+    if (!parseRpcMessage(data, len, &message) || message.type != kRpcRequest)
+    {
+        LOG_ERROR("RpcServer bad request from %s, closing \n", conn->name().c_str());
+        conn->forceClose();
+        return;
+    }
+
+    RpcResponder responder(&codec_, conn, message.id);
+    auto it = methods_.find(message.method);
+    if (it == methods_.end())
+    {
+        responder.send(kRpcNoMethod, StringPiece());
+        return;
+    }
+    const Method &method = it->second;
+    if (method.dispatch == kOffload && offloadThreads_ > 0)
+    {
+        offloadPool_.run(std::bind(runOffloaded, std::cref(method.handler), message.body.asString(), responder));
+    }
+    else
+    {
+        method.handler(message.body, responder);
+    }
+}
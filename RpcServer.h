@@ -0,0 +1,84 @@
+#pragma once
+
+#include "TcpServer.h"
+#include "LengthHeaderCodec.h"
+#include "ThreadPool.h"
+#include "Rpc.h"
+#include "noncopyable.h"
+
+#include <deque>
+#include <functional>
+#include <string>
+#include <unordered_map>
+
+class RpcServer;
+
+// 交给处理函数用来回复一次调用，可以拷贝、可以在任意线程中使用，只应回复一次
+class RpcResponder
+{
+public:
+    void reply(const StringPiece &response) const { send(kRpcOk, response); }
+    void fail(const StringPiece &message) const { send(kRpcError, message); }
+
+private:
+    friend class RpcServer;
+
+    RpcResponder(const LengthHeaderCodec *codec, const TcpConnectionPtr &conn, uint64_t id)
+        : codec_(codec), conn_(conn), id_(id)
+    {
+    }
+    void send(RpcStatus status, const StringPiece &body) const;
+
+    const LengthHeaderCodec *codec_;
+    TcpConnectionPtr conn_;
+    uint64_t id_;
+};
+
+/**************************
+ * 多路复用的RPC服务端，同一个连接上可以同时有多个未完成的调用，应答按完成的先后顺序发回
+ * 处理函数可以在连接所在的loop线程中执行(kInLoop，适合不阻塞的短小处理)，
+ * 也可以交给offload线程池执行(kOffload，请求体会被拷贝一份)
+ **************************/
+class RpcServer : noncopyable
+{
+public:
+    enum Dispatch
+    {
+        kInLoop,
+        kOffload,
+    };
+
+    // kInLoop时request指向连接的inputBuffer_，只在调用期间有效；回复可以延后，通过responder完成
+    using RpcHandler = std::function<void(const StringPiece &request, const RpcResponder &responder)>;
+
+    RpcServer(EventLoop *loop, const InetAddress &listenAddr, const std::string &name,
+              TcpServer::Option option = TcpServer::kNoReusePort);
+    ~RpcServer();
+
+    // 以下都需要在start之前调用
+    void registerMethod(const std::string &method, const RpcHandler &handler, Dispatch dispatch = kInLoop);
+    void setThreadNum(int numThreads) { server_.setThreadNum(numThreads); }
+    void setOffloadThreadNum(int numThreads) { offloadThreads_ = numThreads; }
+    void setConnectionCallback(const ConnectionCallback &cb) { connectionCallback_ = cb; }
+
+    void start();
+
+private:
+    struct Method
+    {
+        RpcHandler handler;
+        Dispatch dispatch;
+    };
+
+    void onConnection(const TcpConnectionPtr &conn);
+    void onFrame(const TcpConnectionPtr &conn, const char *data, size_t len, TimeStamp receiveTime);
+
+    TcpServer server_;
+    LengthHeaderCodec codec_;
+    // 键指向methodNames_中的字符串，收到请求时直接用请求里的方法名查找，不分配内存
+    std::unordered_map<StringPiece, Method, StringPieceHash> methods_;
+    std::deque<std::string> methodNames_; // 只追加，元素地址不变
+    ThreadPool offloadPool_;
+    int offloadThreads_;
+    ConnectionCallback connectionCallback_;
+};
@@ -1,11 +1,13 @@
 #include "Socket.h"
 #include "Logger.h"
 #include "InetAddress.h"
+#include "SocketOptions.h"
 
 #include <unistd.h>
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <netinet/tcp.h>
+#include <linux/filter.h>
 #include <strings.h>
 
 Socket::~Socket()
@@ -15,15 +17,15 @@ Socket::~Socket()
 
 void Socket::bindAddress(const InetAddress &localAddr)
 {
-    if (0 != ::bind(sockfd_, (sockaddr *)localAddr.getSockAddr(), sizeof(sockaddr_in)))
+    if (0 != ::bind(sockfd_, localAddr.sockAddr(), localAddr.sockAddrLen()))
     {
         LOG_FATAL("binc sockfd:%d failed \n", sockfd_);
     }
 }
 
-void Socket::listen()
+void Socket::listen(int backlog)
 {
-    if (0 != ::listen(sockfd_, 1024))
+    if (0 != ::listen(sockfd_, backlog))
     {
         LOG_FATAL("listen sockfd:%d failed \n", sockfd_);
     }
@@ -31,13 +33,13 @@ void Socket::listen()
 
 int Socket::accept(InetAddress *perrAddr)
 {
-    sockaddr_in addr;
+    sockaddr_storage addr; // 监听socket可能是IPv4也可能是Unix域
     socklen_t len = sizeof addr;
     bzero(&addr, sizeof(addr));
     int connfd = ::accept4(sockfd_, (sockaddr *)&addr, &len,SOCK_NONBLOCK | SOCK_CLOEXEC);
     if (connfd >= 0)
     {
-        perrAddr->setSockAddr(addr);
+        perrAddr->setSockAddr((sockaddr *)&addr, len);
     }
     return connfd;
 }
@@ -72,4 +74,158 @@ void Socket::setKeepAlive(bool on)
 {
     int optval = on ? 1 : 0;
     ::setsockopt(sockfd_, SOL_SOCKET, SO_KEEPALIVE, &optval, sizeof(optval));
-}
\ No newline at end of file
+}
+
+bool Socket::setZeroCopy(bool on)
+{
+    int optval = on ? 1 : 0;
+    return ::setsockopt(sockfd_, SOL_SOCKET, SO_ZEROCOPY, &optval, sizeof(optval)) == 0;
+}
+
+static bool setIntOption(int sockfd, int level, int name, int value)
+{
+    return ::setsockopt(sockfd, level, name, &value, sizeof(value)) == 0;
+}
+
+bool Socket::setSendBufferSize(int bytes)
+{
+    return setIntOption(sockfd_, SOL_SOCKET, SO_SNDBUF, bytes);
+}
+
+bool Socket::setRecvBufferSize(int bytes)
+{
+    return setIntOption(sockfd_, SOL_SOCKET, SO_RCVBUF, bytes);
+}
+
+bool Socket::setQuickAck(bool on)
+{
+    return setIntOption(sockfd_, IPPROTO_TCP, TCP_QUICKACK, on ? 1 : 0);
+}
+
+bool Socket::setNotSentLowat(int bytes)
+{
+    return setIntOption(sockfd_, IPPROTO_TCP, TCP_NOTSENT_LOWAT, bytes);
+}
+
+bool Socket::setLinger(bool on, int seconds)
+{
+    linger optval;
+    optval.l_onoff = on ? 1 : 0;
+    optval.l_linger = seconds;
+    return ::setsockopt(sockfd_, SOL_SOCKET, SO_LINGER, &optval, sizeof(optval)) == 0;
+}
+
+bool Socket::setDeferAccept(int seconds)
+{
+    return setIntOption(sockfd_, IPPROTO_TCP, TCP_DEFER_ACCEPT, seconds);
+}
+
+bool Socket::setFastOpen(int queueLength)
+{
+    return setIntOption(sockfd_, IPPROTO_TCP, TCP_FASTOPEN, queueLength);
+}
+
+void Socket::applyConnectionOptions(const SocketOptions &options, const SocketOptions &current)
+{
+    if (options.tcpNoDelay != current.tcpNoDelay)
+    {
+        setTcpNoDelay(options.tcpNoDelay);
+    }
+    // quickack关闭时不用设置，内核会自己退出quickack模式
+    if (options.quickAck && !current.quickAck && !setQuickAck(true))
+    {
+        LOG_ERROR("sockfd:%d set TCP_QUICKACK failed:%d \n", sockfd_, errno);
+    }
+    if (options.keepAlive != current.keepAlive)
+    {
+        setKeepAlive(options.keepAlive);
+    }
+    if (options.sendBufferBytes > 0 && options.sendBufferBytes != current.sendBufferBytes &&
+        !setSendBufferSize(options.sendBufferBytes))
+    {
+        LOG_ERROR("sockfd:%d set SO_SNDBUF failed:%d \n", sockfd_, errno);
+    }
+    if (options.recvBufferBytes > 0 && options.recvBufferBytes != current.recvBufferBytes &&
+        !setRecvBufferSize(options.recvBufferBytes))
+    {
+        LOG_ERROR("sockfd:%d set SO_RCVBUF failed:%d \n", sockfd_, errno);
+    }
+    if (options.notSentLowat > 0 && options.notSentLowat != current.notSentLowat &&
+        !setNotSentLowat(options.notSentLowat))
+    {
+        LOG_ERROR("sockfd:%d set TCP_NOTSENT_LOWAT failed:%d \n", sockfd_, errno);
+    }
+    if (options.lingerSeconds != current.lingerSeconds &&
+        !setLinger(options.lingerSeconds >= 0, options.lingerSeconds >= 0 ? options.lingerSeconds : 0))
+    {
+        LOG_ERROR("sockfd:%d set SO_LINGER failed:%d \n", sockfd_, errno);
+    }
+}
+
+void Socket::applyListenOptions(const SocketOptions &options)
+{
+    // accept得到的连接继承监听socket的缓冲区大小，SYN中通告的窗口扩大因子也由它决定
+    if (options.sendBufferBytes > 0 && !setSendBufferSize(options.sendBufferBytes))
+    {
+        LOG_ERROR("listen sockfd:%d set SO_SNDBUF failed:%d \n", sockfd_, errno);
+    }
+    if (options.recvBufferBytes > 0 && !setRecvBufferSize(options.recvBufferBytes))
+    {
+        LOG_ERROR("listen sockfd:%d set SO_RCVBUF failed:%d \n", sockfd_, errno);
+    }
+    if (options.deferAcceptSeconds > 0 && !setDeferAccept(options.deferAcceptSeconds))
+    {
+        LOG_ERROR("listen sockfd:%d set TCP_DEFER_ACCEPT failed:%d \n", sockfd_, errno);
+    }
+    // 服务端还需要net.ipv4.tcp_fastopen打开第2位(值为2或3)才会生效
+    if (options.fastOpenQueue > 0 && !setFastOpen(options.fastOpenQueue))
+    {
+        LOG_ERROR("listen sockfd:%d set TCP_FASTOPEN failed:%d \n", sockfd_, errno);
+    }
+}
+
+bool Socket::setIncomingCpu(int cpu)
+{
+    return setIntOption(sockfd_, SOL_SOCKET, SO_INCOMING_CPU, cpu);
+}
+
+int Socket::incomingCpu() const
+{
+    int cpu = -1;
+    socklen_t len = sizeof(cpu);
+    if (::getsockopt(sockfd_, SOL_SOCKET, SO_INCOMING_CPU, &cpu, &len) < 0)
+    {
+        return -1;
+    }
+    return cpu;
+}
+
+/*
+ * 生成的程序:
+ *   A = 当前CPU(处理SYN的软中断所在的CPU)
+ *   依次比较 A == listenerCpus[i]，相等时返回i
+ *   都不相等时返回 A % 监听socket个数
+ * 返回值是reuseport组里socket的下标，超出范围时内核退回到按四元组哈希选择
+ */
+bool Socket::attachCpuSteeringProgram(const std::vector<int> &listenerCpus)
+{
+    if (listenerCpus.empty())
+    {
+        return false;
+    }
+    std::vector<sock_filter> code;
+    code.push_back(BPF_STMT(BPF_LD | BPF_W | BPF_ABS, static_cast<uint32_t>(SKF_AD_OFF + SKF_AD_CPU)));
+    for (size_t i = 0; i < listenerCpus.size(); ++i)
+    {
+        // 相等时执行紧跟着的ret，否则跳过它
+        code.push_back(BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, static_cast<uint32_t>(listenerCpus[i]), 0, 1));
+        code.push_back(BPF_STMT(BPF_RET | BPF_K, static_cast<uint32_t>(i)));
+    }
+    code.push_back(BPF_STMT(BPF_ALU | BPF_MOD | BPF_K, static_cast<uint32_t>(listenerCpus.size())));
+    code.push_back(BPF_STMT(BPF_RET | BPF_A, 0));
+
+    sock_fprog prog;
+    prog.len = static_cast<unsigned short>(code.size());
+    prog.filter = code.data();
+    return ::setsockopt(sockfd_, SOL_SOCKET, SO_ATTACH_REUSEPORT_CBPF, &prog, sizeof(prog)) == 0;
+}
@@ -2,7 +2,10 @@
 
 #include "noncopyable.h"
 
+#include <vector>
+
 class InetAddress;
+struct SocketOptions;
 
 // 封装socket fd
 class Socket : noncopyable
@@ -12,7 +15,7 @@ public:
     ~Socket();
 
     void bindAddress(const InetAddress &localAddr);
-    void listen();
+    void listen(int backlog = 1024);
     int accept(InetAddress *perrAddr);
     void shutdownWrite();
 
@@ -20,6 +23,29 @@ public:
     void setReuseAddr(bool on);
     void setReusePort(bool on);
     void setKeepAlive(bool on);
+    // 开启SO_ZEROCOPY之后send才能使用MSG_ZEROCOPY，内核不支持时返回false
+    bool setZeroCopy(bool on);
+    // 以下setsockopt失败时返回false，见SocketOptions中各项的说明
+    bool setSendBufferSize(int bytes);
+    bool setRecvBufferSize(int bytes);
+    bool setQuickAck(bool on);
+    bool setNotSentLowat(int bytes);
+    bool setLinger(bool on, int seconds);
+    bool setDeferAccept(int seconds);
+    bool setFastOpen(int queueLength);
+    // 监听socket: 同一个reuseport组里内核优先选择incoming cpu与收包CPU相同的socket
+    bool setIncomingCpu(int cpu);
+    // 已连接socket: 最近一次处理该连接收包的CPU，失败返回-1
+    int incomingCpu() const;
+    // 给所在的reuseport组挂上按收包CPU选择监听socket的cBPF程序，
+    // listenerCpus[i]是组里第i个(按listen的顺序)socket所在loop绑定的CPU
+    bool attachCpuSteeringProgram(const std::vector<int> &listenerCpus);
+
+    // 从current的状态切换到options，只对不同的项做系统调用，失败的项打印错误日志；
+    // nodelay、keepalive、linger可以打开也可以关闭，缓冲区大小和notSentLowat为0时保持当前的设置
+    void applyConnectionOptions(const SocketOptions &options, const SocketOptions &current);
+    // 监听socket的选项，需要在listen之前调用
+    void applyListenOptions(const SocketOptions &options);
 
     int fd() const { return sockfd_; }
 
@@ -0,0 +1,37 @@
+#pragma once
+
+/****************
+ * TCP socket的可调参数，TcpServer::setSocketOptions设置给监听socket和之后accept的每个连接，
+ * 单个连接也可以用TcpConnection::setSocketOptions覆盖
+ * 每一项取默认值时不做任何setsockopt，保持系统默认
+ * *************/
+struct SocketOptions
+{
+    SocketOptions()
+        : tcpNoDelay(false),
+          quickAck(false),
+          keepAlive(true),
+          sendBufferBytes(0),
+          recvBufferBytes(0),
+          notSentLowat(0),
+          lingerSeconds(-1),
+          listenBacklog(1024),
+          deferAcceptSeconds(0),
+          fastOpenQueue(0)
+    {
+    }
+
+    // 已连接的socket
+    bool tcpNoDelay;     // TCP_NODELAY，关闭Nagle算法，小的应答不再等前一个包的ACK
+    bool quickAck;       // TCP_QUICKACK，内核会自己退出quickack模式，开启后连接每次读完数据都重新设置
+    bool keepAlive;      // SO_KEEPALIVE，连接默认开启
+    int sendBufferBytes; // SO_SNDBUF，0表示不设置，保留内核的自动调整
+    int recvBufferBytes; // SO_RCVBUF，同上；也设置在监听socket上，握手时的窗口扩大因子按它协商
+    int notSentLowat;    // TCP_NOTSENT_LOWAT，内核中未发送的数据低于该值才报告可写，0表示不设置
+    int lingerSeconds;   // SO_LINGER，-1表示不设置，0表示close时直接发RST，不留TIME_WAIT
+
+    // 只对监听socket
+    int listenBacklog;      // listen的backlog，实际值不超过net.core.somaxconn
+    int deferAcceptSeconds; // TCP_DEFER_ACCEPT，收到第一个数据包才完成accept，0表示不开启
+    int fastOpenQueue;      // TCP_FASTOPEN，等待完成握手的TFO请求队列长度，0表示不开启
+};
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <string>
+#include <string.h>
+#include <strings.h>
+
+// 指向外部内存的只读字符串视图，不持有数据，使用者需要保证所指内存在使用期间有效
+class StringPiece
+{
+public:
+    StringPiece() : ptr_(nullptr), length_(0) {}
+    StringPiece(const char *str) : ptr_(str), length_(::strlen(str)) {}
+    StringPiece(const std::string &str) : ptr_(str.data()), length_(str.size()) {}
+    StringPiece(const char *ptr, size_t len) : ptr_(ptr), length_(len) {}
+
+    const char *data() const { return ptr_; }
+    size_t size() const { return length_; }
+    bool empty() const { return length_ == 0; }
+    const char *begin() const { return ptr_; }
+    const char *end() const { return ptr_ + length_; }
+    char operator[](size_t i) const { return ptr_[i]; }
+
+    std::string asString() const { return std::string(ptr_, length_); }
+
+    bool operator==(const StringPiece &rhs) const
+    {
+        return length_ == rhs.length_ && ::memcmp(ptr_, rhs.ptr_, length_) == 0;
+    }
+    bool operator!=(const StringPiece &rhs) const { return !(*this == rhs); }
+
+    // 忽略大小写比较，用于HTTP头部名称之类的场合
+    bool caseEqual(const StringPiece &rhs) const
+    {
+        return length_ == rhs.length_ && ::strncasecmp(ptr_, rhs.ptr_, length_) == 0;
+    }
+
+private:
+    const char *ptr_;
+    size_t length_;
+};
+
+// 按内容哈希(FNV-1a)，用StringPiece作为无序容器的键时查找不必构造std::string
+struct StringPieceHash
+{
+    size_t operator()(const StringPiece &s) const
+    {
+        size_t h = 14695981039346656037ULL;
+        for (size_t i = 0; i < s.size(); ++i)
+        {
+            h = (h ^ static_cast<unsigned char>(s[i])) * 1099511628211ULL;
+        }
+        return h;
+    }
+};
@@ -0,0 +1,162 @@
+#include "TcpClient.h"
+#include "Connector.h"
+#include "EventLoop.h"
+#include "Logger.h"
+
+#include <functional>
+#include <stdio.h>
+#include <strings.h>
+#include <sys/socket.h>
+
+static EventLoop *CheckLoopNotNull(EventLoop *loop)
+{
+    if (loop == nullptr)
+    {
+        LOG_FATAL("%s:%s:%d loop is null", __FILE__, __FUNCTION__, __LINE__);
+    }
+    return loop;
+}
+
+static void defaultConnectionCallback(const TcpConnectionPtr &conn)
+{
+    LOG_INFO("TcpClient connection %s is %s \n", conn->name().c_str(), conn->connected() ? "UP" : "DOWN");
+}
+
+static void defaultMessageCallback(const TcpConnectionPtr &, Buffer *buf, TimeStamp)
+{
+    buf->retrieveAll();
+}
+
+// TcpClient析构之后连接的关闭回调，不能再引用TcpClient
+static void removeDetachedConnection(EventLoop *loop, const TcpConnectionPtr &conn)
+{
+    loop->queueInLoop(std::bind(&TcpConnection::connectDestroyed, conn));
+}
+
+TcpClient::TcpClient(EventLoop *loop, const InetAddress &serverAddr, const std::string &nameArg)
+    : loop_(CheckLoopNotNull(loop)),
+      connector_(new Connector(loop, serverAddr)),
+      name_(nameArg),
+      connectionCallback_(defaultConnectionCallback),
+      messageCallback_(defaultMessageCallback),
+      highWaterMark_(64 * 1024 * 1024),
+      corkWrites_(false),
+      msgMore_(false),
+      retry_(false),
+      connect_(false),
+      nextConnId_(1)
+{
+    connector_->setNewConnectionCallback(
+        std::bind(&TcpClient::newConnection, this, std::placeholders::_1));
+}
+
+TcpClient::~TcpClient()
+{
+    TcpConnectionPtr conn;
+    bool unique = false;
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        unique = connection_.use_count() == 1;
+        conn = connection_;
+    }
+    if (conn)
+    {
+        // 连接可能还被用户持有，关闭时改为直接销毁，不再回调到已经析构的TcpClient
+        CloseCallback cb = std::bind(removeDetachedConnection, loop_, std::placeholders::_1);
+        loop_->runInLoop(std::bind(&TcpConnection::setCloseCallback, conn, cb));
+        if (unique)
+        {
+            conn->forceClose();
+        }
+    }
+    else
+    {
+        // stop里持有connector_的shared_ptr，进行中的连接尝试清理完之后才释放
+        connector_->stop();
+    }
+}
+
+void TcpClient::connect()
+{
+    LOG_INFO("TcpClient::connect [%s] - connecting to %s \n",
+             name_.c_str(), connector_->serverAddress().toIpPort().c_str());
+    connect_ = true;
+    connector_->start();
+}
+
+void TcpClient::disconnect()
+{
+    connect_ = false;
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (connection_)
+    {
+        connection_->shutdown();
+    }
+}
+
+void TcpClient::stop()
+{
+    connect_ = false;
+    connector_->stop();
+}
+
+void TcpClient::newConnection(int sockfd)
+{
+    sockaddr_storage peer, local;
+    socklen_t peerLen = sizeof peer;
+    socklen_t localLen = sizeof local;
+    ::bzero(&peer, sizeof peer);
+    ::bzero(&local, sizeof local);
+    if (::getpeername(sockfd, (sockaddr *)&peer, &peerLen) < 0)
+    {
+        LOG_ERROR("sockets::getPeerAddr");
+    }
+    if (::getsockname(sockfd, (sockaddr *)&local, &localLen) < 0)
+    {
+        LOG_ERROR("sockets::getLocalAddr");
+    }
+    InetAddress peerAddr, localAddr;
+    peerAddr.setSockAddr((sockaddr *)&peer, peerLen);
+    localAddr.setSockAddr((sockaddr *)&local, localLen);
+
+    char buf[64] = {0};
+    snprintf(buf, sizeof buf, ":%s#%d", peerAddr.toIpPort().c_str(), nextConnId_);
+    ++nextConnId_;
+    std::string connName = name_ + buf;
+
+    TcpConnectionPtr conn(new TcpConnection(loop_, connName, sockfd, localAddr, peerAddr));
+    conn->setConnectionCallback(connectionCallback_);
+    conn->setMessageCallback(messageCallback_);
+    conn->setWriteCompleteCallback(writeCompleteCallback_);
+    if (highWaterMarkCallback_)
+    {
+        conn->setHighWaterMarkCallback(highWaterMarkCallback_, highWaterMark_);
+    }
+    conn->setCorkWrites(corkWrites_, msgMore_);
+    if (tlsContext_)
+    {
+        conn->setTls(tlsContext_);
+    }
+    conn->setCloseCallback(
+        std::bind(&TcpClient::removeConnection, this, std::placeholders::_1));
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        connection_ = conn;
+    }
+    conn->connectEstablished();
+}
+
+void TcpClient::removeConnection(const TcpConnectionPtr &conn)
+{
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        connection_.reset();
+    }
+    loop_->queueInLoop(std::bind(&TcpConnection::connectDestroyed, conn));
+    if (retry_ && connect_)
+    {
+        LOG_INFO("TcpClient::removeConnection [%s] - reconnecting to %s \n",
+                 name_.c_str(), connector_->serverAddress().toIpPort().c_str());
+        connector_->restart();
+    }
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include "noncopyable.h"
+#include "InetAddress.h"
+#include "Callbacks.h"
+#include "TcpConnection.h"
+
+#include <string>
+#include <memory>
+#include <atomic>
+#include <mutex>
+
+class Connector;
+class EventLoop;
+
+/**************************
+ * TCP客户端，一个TcpClient同时最多管理一条连接，连接建立在loop_上
+ * 回调接口与TcpServer相同；开启enableRetry之后连接断开会自动重连，
+ * 连接失败由Connector按指数退避重试
+ **************************/
+class TcpClient : noncopyable
+{
+public:
+    TcpClient(EventLoop *loop, const InetAddress &serverAddr, const std::string &nameArg);
+    ~TcpClient();
+
+    void connect();
+    // 关闭当前连接(等待缓冲区数据发完)，不再重连
+    void disconnect();
+    // 停止还在进行中的连接尝试
+    void stop();
+
+    TcpConnectionPtr connection() const
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        return connection_;
+    }
+
+    EventLoop *getLoop() const { return loop_; }
+    bool retry() const { return retry_; }
+    void enableRetry() { retry_ = true; }
+    const std::string &name() const { return name_; }
+
+    // 以下需要在connect之前设置
+    void setConnectionCallback(const ConnectionCallback &cb) { connectionCallback_ = cb; }
+    void setMessageCallback(const MessageCallback &cb) { messageCallback_ = cb; }
+    void setWriteCompleteCallback(const WriteCompleteCallback &cb) { writeCompleteCallback_ = cb; }
+    void setHighWaterMarkCallback(const HighWaterMarkCallback &cb, size_t highWaterMark)
+    {
+        highWaterMarkCallback_ = cb;
+        highWaterMark_ = highWaterMark;
+    }
+    // 之后建立的连接都先做TLS握手，context的模式要与之匹配(服务器用kServer，客户端用kClient)
+    void setTlsContext(const std::shared_ptr<TlsContext> &context) { tlsContext_ = context; }
+    // 见TcpConnection::setCorkWrites
+    void setCorkWrites(bool on, bool msgMore = false)
+    {
+        corkWrites_ = on;
+        msgMore_ = msgMore;
+    }
+
+private:
+    // 在loop线程中调用
+    void newConnection(int sockfd);
+    void removeConnection(const TcpConnectionPtr &conn);
+
+    EventLoop *loop_;
+    std::shared_ptr<Connector> connector_;
+    const std::string name_;
+    ConnectionCallback connectionCallback_;
+    MessageCallback messageCallback_;
+    WriteCompleteCallback writeCompleteCallback_;
+    HighWaterMarkCallback highWaterMarkCallback_;
+    size_t highWaterMark_;
+    bool corkWrites_;
+    bool msgMore_;
+    std::shared_ptr<TlsContext> tlsContext_;
+    std::atomic_bool retry_;
+    std::atomic_bool connect_;
+    int nextConnId_; // 只在loop线程中访问
+    mutable std::mutex mutex_;
+    TcpConnectionPtr connection_; // 由mutex_保护
+};
@@ -3,15 +3,25 @@
 #include "Socket.h"
 #include "Channel.h"
 #include "EventLoop.h"
+#include "TlsSession.h"
+#include "LatencyStats.h"
+#include "Metrics.h"
+#include "SocketOptions.h"
 
 #include <unistd.h>
 #include <sys/types.h>
 #include <sys/socket.h>
+#include <sys/sendfile.h>
+#include <sys/uio.h>
+#include <netinet/in.h>
 #include <netinet/tcp.h>
+#include <linux/errqueue.h>
+#include <fcntl.h>
 #include <strings.h>
 #include <error.h>
 #include <string>
 #include <functional>
+#include <algorithm>
 
 static EventLoop *CheckLoopNotNull(EventLoop *loop)
 {
@@ -25,7 +35,22 @@ static EventLoop *CheckLoopNotNull(EventLoop *loop)
 TcpConnection::TcpConnection(EventLoop *loop, const std::string &nameArg, int sockfd,
                              const InetAddress &localAddr,
                              const InetAddress &peerAddr)
+    : TcpConnection(loop, 0, nullptr, nameArg, sockfd, localAddr, peerAddr)
+{
+}
+
+TcpConnection::TcpConnection(EventLoop *loop, uint64_t id, const std::shared_ptr<const std::string> &namePrefix,
+                             int sockfd, const InetAddress &localAddr, const InetAddress &peerAddr)
+    : TcpConnection(loop, id, namePrefix, std::string(), sockfd, localAddr, peerAddr)
+{
+}
+
+TcpConnection::TcpConnection(EventLoop *loop, uint64_t id, const std::shared_ptr<const std::string> &namePrefix,
+                             const std::string &nameArg, int sockfd,
+                             const InetAddress &localAddr, const InetAddress &peerAddr)
     : loop_(CheckLoopNotNull(loop)),
+      id_(id),
+      namePrefix_(namePrefix),
       name_(nameArg),
       state_(kConnecting),
       reading_(true),
@@ -33,7 +58,24 @@ TcpConnection::TcpConnection(EventLoop *loop, const std::string &nameArg, int so
       channel_(new Channel(loop, sockfd)),
       localAddr_(localAddr),
       peerAddr_(peerAddr),
-      highWaterMark_(64 * 1024 * 1024) // 64M
+      highWaterMark_(64 * 1024 * 1024), // 64M
+      lowWaterMark_(0),
+      aboveHighWaterMark_(false),
+      backpressureHigh_(0),
+      backpressureLow_(0),
+      readPausedByBackpressure_(false),
+      bufferBytes_(0),
+      regionBytes_(0),
+      zeroCopy_(false),
+      zeroCopyThreshold_(kZeroCopyThreshold),
+      zeroCopySeq_(0),
+      zeroCopyDoneSeq_(0),
+      corkWrites_(false),
+      msgMore_(false),
+      flushQueued_(false),
+      latencyTraced_(false),
+      traceStartNanos_(0),
+      traceFirstWriteNanos_(0)
 
 {
     /***
@@ -46,39 +88,164 @@ TcpConnection::TcpConnection(EventLoop *loop, const std::string &nameArg, int so
     channel_->setCloseCallback(std::bind(&TcpConnection::handleClose, this));
     channel_->setErrorCallback(std::bind(&TcpConnection::handleError, this));
 
-    LOG_INFO("TcpConnection::ctor[%s] at fd=%d \n", name_.c_str(), sockfd);
+    // 每个连接都会经过，不在默认的INFO级别输出，否则每个连接都要格式化一次名字
+    LOG_DEBUG("TcpConnection::ctor[%s] at fd=%d \n", name().c_str(), sockfd);
     socket_->setKeepAlive(true);
+    pipeFds_[0] = pipeFds_[1] = -1;
+    Metrics::add(Metrics::kConnectionsOpen, 1);
+    updateBufferMetrics();
+}
+
+const std::string &TcpConnection::name() const
+{
+    // 大部分连接的名字只在打日志时用到，不必在每个连接建立时都格式化一次
+    std::call_once(nameOnce_, [this]()
+                   {
+                       if (name_.empty() && namePrefix_)
+                       {
+                           name_ = *namePrefix_ + std::to_string(id_);
+                       }
+                   });
+    return name_;
+}
+
+int TcpConnection::incomingCpu() const
+{
+    return socket_->incomingCpu();
 }
 
 TcpConnection::~TcpConnection()
 {
-    LOG_INFO("TcpConnection::dtor[%s] at fd=%d state=%d \n",
-             name_.c_str(), channel_->fd(), (int)state_);
+    LOG_DEBUG("TcpConnection::dtor[%s] at fd=%d state=%d \n",
+             name().c_str(), channel_->fd(), (int)state_);
+    // 未发送完的sendFile区间持有dup出来的文件描述符
+    for (const OutputRegion &region : regions_)
+    {
+        if (region.kind == OutputRegion::kFile)
+        {
+            ::close(region.fd);
+        }
+    }
+    if (pipeFds_[0] >= 0)
+    {
+        ::close(pipeFds_[0]);
+        ::close(pipeFds_[1]);
+    }
+    Metrics::add(Metrics::kConnectionsOpen, -1);
+    Metrics::add(Metrics::kBufferBytes, -static_cast<int64_t>(bufferBytes_));
 }
 
 
 
+static const char *payloadData(const std::string &payload) { return payload.data(); }
+static const char *payloadData(const std::vector<char> &payload) { return payload.data(); }
+static const char *payloadData(const Buffer &payload) { return payload.peek(); }
+static size_t payloadSize(const std::string &payload) { return payload.size(); }
+static size_t payloadSize(const std::vector<char> &payload) { return payload.size(); }
+static size_t payloadSize(const Buffer &payload) { return payload.readAbleBytes(); }
+
+// 小于该长度的数据直接拷贝进缓冲区，比单独接管排队一个区间更省
+static const size_t kAdoptMinBytes = 4096;
+
+// payload的所有权已经交给连接，跨线程时移动进functor，不产生拷贝
+template <typename Payload>
+void TcpConnection::sendOwned(Payload &payload)
+{
+    if (state_ == kConnected)
+    {
+        if (loop_->isInLoopThread())
+        {
+            sendPayloadInLoop(payload);
+        }
+        else
+        {
+            loop_->runInLoop(std::bind(&TcpConnection::sendPayloadInLoop<Payload>,
+                                       shared_from_this(), std::move(payload)));
+        }
+    }
+}
+
+// 大块数据直接接管payload排在输出队列中，而不是拷贝进ouputBuffer_
+template <typename Payload>
+void TcpConnection::sendPayloadInLoop(Payload &payload)
+{
+    size_t len = payloadSize(payload);
+    bool zeroCopy = zeroCopy_ && len >= zeroCopyThreshold_;
+    if (!zeroCopy && len < kAdoptMinBytes)
+    {
+        sendInLoop(payloadData(payload), len);
+        return;
+    }
+    if (state_ == kDisconnected)
+    {
+        LOG_ERROR("disconnected, give up writing");
+        return;
+    }
+    if (latencyTraced_)
+    {
+        traceFirstWrite();
+    }
+    checkHighWaterMark(len);
+
+    std::shared_ptr<Payload> owner = std::make_shared<Payload>(std::move(payload));
+    OutputRegion region;
+    region.kind = OutputRegion::kData;
+    region.fd = -1;
+    region.offset = 0;
+    region.remaining = len;
+    region.data = payloadData(*owner); // 移动之后再取地址
+    region.owner = std::move(owner);
+    region.zeroCopy = zeroCopy;
+    region.lastZeroCopySeq = 0;
+    region.zeroCopied = false;
+    pushRegion(std::move(region));
+    startRegionWrite();
+}
+
 /************
  * 发送数据 应用写得快 而内核发送数据慢，需要把数据写入应用层缓冲区，
  * 而且设置了水位回调
  * **********/
 void TcpConnection::send(const std::string &buf)
+{
+    send(buf.data(), buf.size());
+}
+
+void TcpConnection::send(const void *data, size_t len)
 {
     if (state_ == kConnected)
     {
         // 判断当前线程是否在loop所处的线程中
         if (loop_->isInLoopThread())
         {
-            sendInLoop(buf.c_str(), buf.size());
+            sendInLoop(data, len);
         }
         else
         {
-            loop_->runInLoop(std::bind(
-                &TcpConnection::sendInLoop, this, buf.c_str(), buf.size()));
+            // 调用方的数据在sendInLoop执行时可能已经析构了，只能拷贝一份交给loop
+            std::string payload(static_cast<const char *>(data), len);
+            sendOwned(payload);
         }
     }
 }
 
+void TcpConnection::send(std::string &&buf)
+{
+    sendOwned(buf);
+}
+
+void TcpConnection::send(std::vector<char> &&buf)
+{
+    sendOwned(buf);
+}
+
+void TcpConnection::send(Buffer *buf)
+{
+    Buffer payload;
+    payload.swap(*buf);
+    sendOwned(payload);
+}
+
 void TcpConnection::sendInLoop(const void *data, size_t len)
 {
     ssize_t nwrote = 0;
@@ -90,13 +257,30 @@ void TcpConnection::sendInLoop(const void *data, size_t len)
         LOG_ERROR("disconnected, give up writing");
         return;
     }
+    if (latencyTraced_)
+    {
+        traceFirstWrite();
+    }
+    // 合并写：本轮事件循环中的send只追加到缓冲区，本轮结束时一次writev发出
+    if (corkWrites_)
+    {
+        checkHighWaterMark(len);
+        queueOutput((const char *)data, len);
+        startRegionWrite();
+        return;
+    }
     // 表示Channel_第一次开始写数据，而且缓冲区没有数据
-    if (!channel_->isWriting() && ouputBuffer_.writeAbleBytes() == 0)
+    if (!channel_->isWriting() && ouputBuffer_.readAbleBytes() == 0 && regions_.empty())
     {
-        nwrote = ::write(channel_->fd(), data, len);
+        nwrote = userSpaceTls() ? tls_->write(data, len) : ::write(channel_->fd(), data, len);
         if (nwrote >= 0)
         {
+            Metrics::add(Metrics::kBytesWritten, nwrote);
             remainning = len - nwrote;
+            if (remainning == 0 && latencyTraced_)
+            {
+                traceWriteComplete();
+            }
             if (remainning == 0 && writeCompleteCallback_)
             {
                 // 既然在此处数据全部发送完成，就不用再给Channel设置epollout事件了
@@ -127,26 +311,569 @@ void TcpConnection::sendInLoop(const void *data, size_t len)
     */
     if (!faluError && remainning > 0)
     {
-        // 目前发送缓冲区剩余的待发送数据的长度
-        size_t oldLen = ouputBuffer_.readAbleBytes();
-        if (oldLen + remainning >= highWaterMark_ // TODO 如何理解这两行代码（42集29:44）
-            && oldLen < highWaterMark_            //
-            && highWaterMarkCallback_)
+        checkHighWaterMark(remainning);
+        queueOutput((const char *)data + nwrote, remainning);
+        if (!channel_->isWriting())
+        {
+            // 这里一定要注册channel的写事件，否则poller不会给channel通知epollout事件
+            channel_->enableWriting();
+        }
+    }
+}
+
+void TcpConnection::sendFile(int fd, off_t offset, size_t length)
+{
+    if (state_ == kConnected)
+    {
+        // dup一份fd，sendFileInLoop可能在调用方关闭fd之后才执行
+        int fileFd = ::fcntl(fd, F_DUPFD_CLOEXEC, 0);
+        if (fileFd < 0)
+        {
+            LOG_ERROR("TcpConnection::sendFile dup fd=%d error:%d \n", fd, errno);
+            return;
+        }
+        if (loop_->isInLoopThread())
+        {
+            sendFileInLoop(fileFd, offset, length);
+        }
+        else
+        {
+            loop_->runInLoop(std::bind(
+                &TcpConnection::sendFileInLoop, shared_from_this(), fileFd, offset, length));
+        }
+    }
+}
+
+void TcpConnection::sendFileInLoop(int fd, off_t offset, size_t length)
+{
+    if (state_ == kDisconnected)
+    {
+        LOG_ERROR("disconnected, give up sending file");
+        ::close(fd);
+        return;
+    }
+    checkHighWaterMark(length);
+
+    OutputRegion region;
+    region.kind = OutputRegion::kFile;
+    region.fd = fd;
+    region.offset = offset;
+    region.remaining = length;
+    region.data = nullptr;
+    region.zeroCopy = false;
+    region.zeroCopied = false;
+    pushRegion(std::move(region));
+    startRegionWrite();
+}
+
+ssize_t TcpConnection::spliceFrom(int fd, size_t length)
+{
+    if (state_ != kConnected)
+    {
+        errno = EPIPE;
+        return -1;
+    }
+    if (!loop_->isInLoopThread())
+    {
+        LOG_ERROR("TcpConnection::spliceFrom must be called in loop thread \n");
+        errno = EINVAL;
+        return -1;
+    }
+    if (userSpaceTls())
+    {
+        // 数据必须经过用户态加密，没法留在内核pipe中，读出来按普通数据发送
+        char buf[64 * 1024];
+        ssize_t n = ::read(fd, buf, std::min(length, sizeof buf));
+        if (n > 0)
+        {
+            sendInLoop(buf, n);
+        }
+        return n;
+    }
+    if (pipeFds_[0] < 0 && ::pipe2(pipeFds_, O_NONBLOCK | O_CLOEXEC) < 0)
+    {
+        int saveErrno = errno;
+        LOG_ERROR("TcpConnection::spliceFrom pipe2 error:%d \n", saveErrno);
+        errno = saveErrno;
+        return -1;
+    }
+
+    // 数据只在内核中从源fd移动到pipe，不经过用户态
+    ssize_t n = ::splice(fd, nullptr, pipeFds_[1], nullptr, length,
+                         SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+    if (n > 0)
+    {
+        checkHighWaterMark(n);
+        // pipe中的数据是FIFO的，紧挨着的splice区间可以合并
+        if (!regions_.empty() && regions_.back().kind == OutputRegion::kPipe &&
+            regions_.back().tail.readAbleBytes() == 0)
+        {
+            regions_.back().remaining += n;
+            regionBytes_ += n;
+        }
+        else
+        {
+            OutputRegion region;
+            region.kind = OutputRegion::kPipe;
+            region.fd = -1;
+            region.offset = 0;
+            region.remaining = n;
+            region.data = nullptr;
+            region.zeroCopy = false;
+            region.zeroCopied = false;
+            pushRegion(std::move(region));
+        }
+        startRegionWrite();
+    }
+    return n;
+}
+
+// 没有注册EPOLLOUT说明之前的数据都已发完，直接尝试发送，发不完再交给handleWrite
+void TcpConnection::startRegionWrite()
+{
+    if (channel_->isWriting())
+    {
+        return;
+    }
+    if (corkWrites_)
+    {
+        scheduleFlush();
+        return;
+    }
+    writePending();
+}
+
+void TcpConnection::writePending()
+{
+    int saveErrno = 0;
+    if (!flushOutput(&saveErrno))
+    {
+        LOG_ERROR("TcpConnection::writePending fd=%d error:%d \n", channel_->fd(), saveErrno);
+        return;
+    }
+    if (pendingOutputBytes() > 0)
+    {
+        channel_->enableWriting();
+        return;
+    }
+    if (latencyTraced_)
+    {
+        traceWriteComplete();
+    }
+    if (writeCompleteCallback_)
+    {
+        loop_->queueInLoop(std::bind(writeCompleteCallback_, shared_from_this()));
+    }
+    if (state_ == kDisconnecting)
+    {
+        shutdownInLoop();
+    }
+}
+
+// 合并写：把本连接登记到loop，本轮事件循环结束时统一发送
+void TcpConnection::scheduleFlush()
+{
+    if (flushQueued_)
+    {
+        return;
+    }
+    flushQueued_ = true;
+    loop_->runAtIterationEnd(std::bind(&TcpConnection::flushCorked, shared_from_this()));
+}
+
+void TcpConnection::flushCorked()
+{
+    flushQueued_ = false;
+    if (state_ != kDisconnected && !channel_->isWriting())
+    {
+        writePending();
+    }
+}
+
+void TcpConnection::setTcpNoDelay(bool on)
+{
+    socket_->setTcpNoDelay(on);
+    socketOptions_.tcpNoDelay = on;
+}
+
+void TcpConnection::setSocketOptions(const SocketOptions &options)
+{
+    socket_->applyConnectionOptions(options, socketOptions_);
+    int sendBufferBytes = socketOptions_.sendBufferBytes;
+    int recvBufferBytes = socketOptions_.recvBufferBytes;
+    int notSentLowat = socketOptions_.notSentLowat;
+    socketOptions_ = options;
+    // 为0的项没有改动，记录的仍然是之前的设置
+    if (options.sendBufferBytes == 0)
+    {
+        socketOptions_.sendBufferBytes = sendBufferBytes;
+    }
+    if (options.recvBufferBytes == 0)
+    {
+        socketOptions_.recvBufferBytes = recvBufferBytes;
+    }
+    if (options.notSentLowat == 0)
+    {
+        socketOptions_.notSentLowat = notSentLowat;
+    }
+}
+
+void TcpConnection::setCorkWrites(bool on, bool msgMore)
+{
+    corkWrites_ = on;
+    msgMore_ = on && msgMore;
+}
+
+// kData区间如果不走MSG_ZEROCOPY，可以和ouputBuffer_以及前后区间的tail一起用一次writev发送
+bool TcpConnection::isGatherable(const OutputRegion &region)
+{
+    return region.kind == OutputRegion::kData && !region.zeroCopy;
+}
+
+bool TcpConnection::flushOutput(int *saveErrno)
+{
+    while (pendingOutputBytes() > 0)
+    {
+        size_t expected = 0;
+        ssize_t n = 0;
+        if (ouputBuffer_.readAbleBytes() > 0 || isGatherable(regions_.front()))
+        {
+            n = writeGathered(&expected);
+        }
+        else
+        {
+            OutputRegion &region = regions_.front();
+            expected = region.remaining;
+            n = sendRegion(region);
+            if (n == 0) // 文件比sendFile给定的长度短
+            {
+                LOG_ERROR("TcpConnection::flushOutput file ended with %lu bytes unsent \n", region.remaining);
+                regionBytes_ -= region.remaining;
+                region.remaining = 0;
+                finishFrontRegion();
+                continue;
+            }
+        }
+        if (n < 0)
+        {
+            *saveErrno = errno;
+            return *saveErrno == EWOULDBLOCK;
+        }
+        Metrics::add(Metrics::kBytesWritten, n);
+        consumeOutput(n);
+        checkLowWaterMark();
+        if (static_cast<size_t>(n) < expected) // 内核发送缓冲区已满
+        {
+            return true;
+        }
+    }
+    return true;
+}
+
+// ouputBuffer_和紧随其后的可合并区间(以及它们的tail)用一次writev发出去
+ssize_t TcpConnection::writeGathered(size_t *expected)
+{
+    static const int kMaxIovecs = 64;
+    iovec vec[kMaxIovecs];
+    int count = 0;
+    size_t total = 0;
+    if (ouputBuffer_.readAbleBytes() > 0)
+    {
+        vec[count].iov_base = const_cast<char *>(ouputBuffer_.peek());
+        vec[count].iov_len = ouputBuffer_.readAbleBytes();
+        total += vec[count++].iov_len;
+    }
+    std::deque<OutputRegion>::iterator it = regions_.begin();
+    for (; it != regions_.end() && isGatherable(*it) && count + 2 <= kMaxIovecs; ++it)
+    {
+        vec[count].iov_base = const_cast<char *>(it->data + it->offset);
+        vec[count].iov_len = it->remaining;
+        total += vec[count++].iov_len;
+        if (it->tail.readAbleBytes() > 0)
+        {
+            vec[count].iov_base = const_cast<char *>(it->tail.peek());
+            vec[count].iov_len = it->tail.readAbleBytes();
+            total += vec[count++].iov_len;
+        }
+    }
+    *expected = total;
+
+    if (userSpaceTls())
+    {
+        return tls_->writev(vec, count);
+    }
+    if (msgMore_ && it != regions_.end())
+    {
+        // 后面紧跟着sendfile/splice区间，告诉内核还有数据，避免发出一个不满的报文段
+        msghdr msg;
+        ::bzero(&msg, sizeof msg);
+        msg.msg_iov = vec;
+        msg.msg_iovlen = count;
+        return ::sendmsg(channel_->fd(), &msg, MSG_MORE);
+    }
+    return ::writev(channel_->fd(), vec, count);
+}
+
+// 按发送顺序扣掉已经写入内核的n个字节
+void TcpConnection::consumeOutput(size_t n)
+{
+    while (n > 0)
+    {
+        size_t len = std::min(n, ouputBuffer_.readAbleBytes());
+        ouputBuffer_.retrieve(len); // len个字节的数据已经处理过了
+        n -= len;
+        if (n == 0)
+        {
+            break;
+        }
+        OutputRegion &region = regions_.front();
+        len = std::min(n, region.remaining);
+        region.offset += len;
+        region.remaining -= len;
+        regionBytes_ -= len;
+        n -= len;
+        if (region.remaining == 0)
+        {
+            finishFrontRegion();
+        }
+    }
+    if (ouputBuffer_.readAbleBytes() == 0 && !regions_.empty() && regions_.front().remaining == 0)
+    {
+        finishFrontRegion();
+    }
+}
+
+// 区间发送完毕，它后面追加的数据成为新的ouputBuffer_
+void TcpConnection::finishFrontRegion()
+{
+    OutputRegion &region = regions_.front();
+    if (region.kind == OutputRegion::kFile)
+    {
+        ::close(region.fd);
+    }
+    else if (region.zeroCopied && static_cast<int32_t>(region.lastZeroCopySeq - zeroCopyDoneSeq_) >= 0)
+    {
+        // 内核还引用着这些页面，等完成通知到达后再释放；已经通知过的随区间一起释放
+        zeroCopyPinned_.push_back(std::make_pair(region.lastZeroCopySeq, std::move(region.owner)));
+    }
+    regionBytes_ -= region.tail.readAbleBytes();
+    ouputBuffer_.swap(region.tail);
+    regions_.pop_front();
+}
+
+// 发送队首的sendfile/splice/MSG_ZEROCOPY区间，只负责写，由consumeOutput扣减
+ssize_t TcpConnection::sendRegion(OutputRegion &region)
+{
+    const int sockfd = channel_->fd();
+    if (region.kind == OutputRegion::kFile)
+    {
+        if (userSpaceTls())
+        {
+            // SSL_write返回WANT_WRITE之后必须用相同的数据重试，下一次从同一偏移读出的内容是一样的
+            static thread_local char buf[64 * 1024];
+            ssize_t n = ::pread(region.fd, buf, std::min(region.remaining, sizeof buf), region.offset);
+            return n > 0 ? tls_->write(buf, n) : n;
+        }
+        off_t offset = region.offset;
+        return ::sendfile(sockfd, region.fd, &offset, region.remaining);
+    }
+    if (region.kind == OutputRegion::kPipe)
+    {
+        return ::splice(pipeFds_[0], nullptr, sockfd, nullptr, region.remaining,
+                        SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+    }
+
+    const char *data = region.data + region.offset;
+    ssize_t n = ::send(sockfd, data, region.remaining, MSG_ZEROCOPY);
+    if (n >= 0)
+    {
+        // 每次成功的MSG_ZEROCOPY发送都会占用一个序号，完成通知按序号区间上报
+        region.lastZeroCopySeq = zeroCopySeq_++;
+        region.zeroCopied = true;
+    }
+    else if (errno == ENOBUFS) // 超过了optmem限制，这次退回到拷贝发送
+    {
+        n = ::write(sockfd, data, region.remaining);
+    }
+    return n;
+}
+
+// 读取错误队列中的零拷贝完成通知，释放内核不再引用的数据
+void TcpConnection::handleZeroCopyCompletions()
+{
+    char control[128];
+    while (true)
+    {
+        msghdr msg;
+        ::bzero(&msg, sizeof msg);
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof control;
+        if (::recvmsg(channel_->fd(), &msg, MSG_ERRQUEUE) < 0) // EAGAIN说明错误队列已经读完
+        {
+            break;
+        }
+        for (cmsghdr *cm = CMSG_FIRSTHDR(&msg); cm != nullptr; cm = CMSG_NXTHDR(&msg, cm))
+        {
+            if (!(cm->cmsg_level == SOL_IP && cm->cmsg_type == IP_RECVERR) &&
+                !(cm->cmsg_level == SOL_IPV6 && cm->cmsg_type == IPV6_RECVERR))
+            {
+                continue;
+            }
+            const sock_extended_err *serr = reinterpret_cast<const sock_extended_err *>(CMSG_DATA(cm));
+            if (serr->ee_errno != 0 || serr->ee_origin != SO_EE_ORIGIN_ZEROCOPY)
+            {
+                continue;
+            }
+            // 通知的是序号区间[ee_info, ee_data]，TCP上的完成通知是按序到达的
+            uint32_t hi = serr->ee_data;
+            zeroCopyDoneSeq_ = hi + 1;
+            while (!zeroCopyPinned_.empty() &&
+                   static_cast<int32_t>(zeroCopyPinned_.front().first - hi) <= 0)
+            {
+                zeroCopyPinned_.pop_front();
+            }
+        }
+    }
+}
+
+void TcpConnection::setZeroCopy(bool on, size_t threshold)
+{
+    zeroCopyThreshold_ = threshold;
+    if (on && tls_)
+    {
+        // 用户态TLS要先加密，kTLS的发送路径也不支持MSG_ZEROCOPY
+        LOG_ERROR("TcpConnection::setZeroCopy [%s] not available on TLS connections \n", name().c_str());
+        on = false;
+    }
+    else if (on && !socket_->setZeroCopy(true))
+    {
+        LOG_ERROR("TcpConnection::setZeroCopy [%s] SO_ZEROCOPY not supported:%d \n", name().c_str(), errno);
+        on = false;
+    }
+    zeroCopy_ = on;
+}
+
+void TcpConnection::queueOutput(const char *data, size_t len)
+{
+    if (regions_.empty())
+    {
+        ouputBuffer_.append(data, len);
+    }
+    else
+    {
+        // 有零拷贝区间在排队，数据必须排在最后一个区间之后
+        regions_.back().tail.append(data, len);
+        regionBytes_ += len;
+    }
+    updateBufferMetrics();
+}
+
+// 在追加len字节之前调用，只在待发送数据向上越过水位线的那一次触发，避免每次send都触发
+void TcpConnection::checkHighWaterMark(size_t len)
+{
+    size_t oldLen = pendingOutputBytes();
+    size_t newLen = oldLen + len;
+    if (oldLen < highWaterMark_ && newLen >= highWaterMark_)
+    {
+        aboveHighWaterMark_ = true;
+        Metrics::add(Metrics::kHighWaterMarkHits, 1);
+        if (highWaterMarkCallback_)
         {
-            // 调用水位线回调函数
             loop_->queueInLoop(std::bind(highWaterMarkCallback_,
                                          shared_from_this(),
-                                         oldLen + remainning));
+                                         newLen));
         }
-        ouputBuffer_.append((char *)data + nwrote, remainning);
-        if (!channel_->isWriting())
+    }
+    if (backpressureHigh_ > 0 && !readPausedByBackpressure_ && newLen >= backpressureHigh_)
+    {
+        TcpConnectionPtr source = backpressureSource_.lock();
+        if (source)
         {
-            // 这里一定要注册channel的写事件，否则poller不会给channel通知epollout事件
-            channel_->enableWriting();
+            readPausedByBackpressure_ = true;
+            source->stopRead();
         }
     }
 }
 
+// 数据写入内核之后调用，越过高水位线之后第一次回落到低水位线时回调并恢复source的读
+// 缓冲区只在追加数据时扩容，容量有变化时把差值计入kBufferBytes
+void TcpConnection::updateBufferMetrics()
+{
+    size_t bytes = inputBuffer_.internalCapacity() + ouputBuffer_.internalCapacity();
+    if (bytes != bufferBytes_)
+    {
+        Metrics::add(Metrics::kBufferBytes, static_cast<int64_t>(bytes) - static_cast<int64_t>(bufferBytes_));
+        bufferBytes_ = bytes;
+    }
+}
+
+void TcpConnection::checkLowWaterMark()
+{
+    size_t len = pendingOutputBytes();
+    if (aboveHighWaterMark_ && len <= lowWaterMark_)
+    {
+        aboveHighWaterMark_ = false;
+        if (lowWaterMarkCallback_)
+        {
+            loop_->queueInLoop(std::bind(lowWaterMarkCallback_,
+                                         shared_from_this(),
+                                         len));
+        }
+    }
+    if (readPausedByBackpressure_ && len <= backpressureLow_)
+    {
+        readPausedByBackpressure_ = false;
+        TcpConnectionPtr source = backpressureSource_.lock();
+        if (source)
+        {
+            source->startRead();
+        }
+    }
+}
+
+void TcpConnection::setBackpressureSource(const TcpConnectionPtr &source,
+                                          size_t highWaterMark, size_t lowWaterMark)
+{
+    backpressureSource_ = source;
+    backpressureHigh_ = highWaterMark;
+    backpressureLow_ = lowWaterMark;
+}
+
+void TcpConnection::startRead()
+{
+    loop_->runInLoop(std::bind(&TcpConnection::startReadInLoop, shared_from_this()));
+}
+
+void TcpConnection::stopRead()
+{
+    loop_->runInLoop(std::bind(&TcpConnection::stopReadInLoop, shared_from_this()));
+}
+
+void TcpConnection::startReadInLoop()
+{
+    // 连接已经断开时channel已从poller中移除，不能再注册
+    if (!reading_ && (state_ == kConnected || state_ == kDisconnecting))
+    {
+        channel_->enableReading();
+        reading_ = true;
+    }
+}
+
+void TcpConnection::stopReadInLoop()
+{
+    if (reading_ && (state_ == kConnected || state_ == kDisconnecting))
+    {
+        channel_->disableReading();
+        reading_ = false;
+    }
+}
+
+void TcpConnection::pushRegion(OutputRegion &&region)
+{
+    regionBytes_ += region.remaining;
+    regions_.push_back(std::move(region));
+}
+
 // 关闭连接，供用户程序员使用
 void TcpConnection::shutdown()
 {
@@ -160,22 +887,66 @@ void TcpConnection::shutdown()
 
 void TcpConnection::shutdownInLoop()
 {
-    if (!channel_->isWriting()) // 说明ouputBuffer中的数据已经全部发送完成
+    // 开启合并写时数据可能还在缓冲区中等待本轮结束再发送，此时没有注册EPOLLOUT
+    if (!channel_->isWriting() && pendingOutputBytes() == 0) // 说明ouputBuffer中的数据已经全部发送完成
     {
         /*
         关闭写端，Poller就会给channel通知关闭事件，
         从而回调TcpConnection::handleClose
         */
+        if (tls_)
+        {
+            tls_->shutdown();
+        }
         socket_->shutdownWrite();
     }
 }
 
+void TcpConnection::forceClose()
+{
+    if (state_ == kConnected || state_ == kDisconnecting)
+    {
+        setState(kDisconnecting);
+        // 放到本轮事件处理之后执行，调用方(如messageCallback)返回前连接不会被销毁
+        loop_->queueInLoop(std::bind(&TcpConnection::forceCloseInLoop, shared_from_this()));
+    }
+}
+
+void TcpConnection::forceCloseInLoop()
+{
+    if (state_ == kConnected || state_ == kDisconnecting)
+    {
+        handleClose();
+    }
+}
+
+void TcpConnection::setTls(const std::shared_ptr<TlsContext> &context)
+{
+    tls_.reset(new TlsSession(context, channel_->fd()));
+}
+
+bool TcpConnection::kernelTlsSend() const
+{
+    return tls_ && tls_->kernelSend();
+}
+
+bool TcpConnection::userSpaceTls() const
+{
+    return tls_ && !tls_->kernelSend();
+}
+
 // 连接建立
 void TcpConnection::connectEstablished()
 {
-    setState(kConnected);
     channel_->tie(shared_from_this());
     channel_->enableReading(); // 向Poller注册channel的epollin事件
+    if (tls_)
+    {
+        // 保持kConnecting状态直到握手完成，期间用户的send会被忽略
+        handleHandshake();
+        return;
+    }
+    setState(kConnected);
 
     // 新连接建立，执行回调
     connectionCallback_(shared_from_this());
@@ -192,15 +963,84 @@ void TcpConnection::connectDestroyed()
     }
     channel_->remove(); // 把channel从poller中删除掉
 }
+// 推进TLS握手，按OpenSSL的要求等待可读或可写事件
+void TcpConnection::handleHandshake()
+{
+    switch (tls_->handshake())
+    {
+    case TlsSession::kDone:
+        if (channel_->isWriting())
+        {
+            channel_->disableWriting();
+        }
+        LOG_INFO("TcpConnection::handleHandshake [%s] %s ktls tx=%d rx=%d \n", name().c_str(),
+                 tls_->cipher().c_str(), tls_->kernelSend(), tls_->kernelRecv());
+        setState(kConnected);
+        connectionCallback_(shared_from_this());
+        // 和握手最后一个记录一起到达的应用数据已经被OpenSSL读进内部缓冲区，不会再有可读事件
+        if (state_ == kConnected && reading_)
+        {
+            handleRead(loop_->pollReturnTime());
+        }
+        break;
+    case TlsSession::kWantRead:
+        if (channel_->isWriting())
+        {
+            channel_->disableWriting();
+        }
+        break;
+    case TlsSession::kWantWrite:
+        if (!channel_->isWriting())
+        {
+            channel_->enableWriting();
+        }
+        break;
+    case TlsSession::kFailed:
+        handleClose();
+        break;
+    }
+}
+
 void TcpConnection::handleRead(TimeStamp receiveTime)
 {
+    if (tls_ && !tls_->established())
+    {
+        handleHandshake();
+        return;
+    }
+    int64_t readStart = 0;
+    if (latencyTraced_)
+    {
+        readStart = LatencyStats::nowNanos();
+        if (traceStartNanos_ == 0)
+        {
+            // 上一个请求的响应还没写完时保留它的起点，流水线上的请求按最早未完成的一个计
+            int64_t pollReturn = loop_->pollReturnNanos();
+            traceStartNanos_ = pollReturn > 0 && pollReturn <= readStart ? pollReturn : readStart;
+        }
+    }
     int saveErrno = 0;
-    ssize_t n = inputBuffer_.readFd(channel_->fd(), &saveErrno);
+    ssize_t n = tls_ ? tls_->read(&inputBuffer_, &saveErrno)
+                     : inputBuffer_.readFd(channel_->fd(), &saveErrno);
+    if (n < 0 && saveErrno == EAGAIN) // 还没有收到一个完整的TLS记录
+    {
+        return;
+    }
     if (n > 0) // 有数据
     {
+        Metrics::add(Metrics::kBytesRead, n);
+        updateBufferMetrics();
+        if (socketOptions_.quickAck)
+        {
+            socket_->setQuickAck(true);
+        }
         // 已建立连接的用户，有可读事件发生了，调用用户层传入的回调操作OnMessage(\
         在TcpConnection::setMessageCallback()函数中进行设置的)
         messageCallback_(shared_from_this(), &inputBuffer_, receiveTime);
+        if (latencyTraced_)
+        {
+            traceHandled(readStart);
+        }
     }
     else if (n == 0) // 客户端断开连接
     {
@@ -214,18 +1054,72 @@ void TcpConnection::handleRead(TimeStamp receiveTime)
     }
 }
 
+void TcpConnection::setLatencyTracing(bool on)
+{
+    latencyTraced_ = on;
+    traceStartNanos_ = 0;
+    traceFirstWriteNanos_ = 0;
+    if (on)
+    {
+        loop_->setLatencyTracing(true);
+    }
+}
+
+// messageCallback返回，记录排队和处理时间
+void TcpConnection::traceHandled(int64_t readStart)
+{
+    LatencyStats &stats = loop_->latencyStats();
+    int64_t pollReturn = loop_->pollReturnNanos();
+    // 刚开启统计的这一轮还没有epoll返回时间
+    if (pollReturn > 0 && pollReturn <= readStart)
+    {
+        stats.record(LatencyStats::kQueue, readStart - pollReturn);
+    }
+    stats.record(LatencyStats::kHandler, LatencyStats::nowNanos() - readStart);
+}
+
+// 只记录有请求在等待响应时的第一次写，服务器主动推送的数据不计入
+void TcpConnection::traceFirstWrite()
+{
+    if (traceStartNanos_ != 0 && traceFirstWriteNanos_ == 0)
+    {
+        traceFirstWriteNanos_ = LatencyStats::nowNanos();
+    }
+}
+
+void TcpConnection::traceWriteComplete()
+{
+    if (traceFirstWriteNanos_ == 0)
+    {
+        return;
+    }
+    int64_t now = LatencyStats::nowNanos();
+    LatencyStats &stats = loop_->latencyStats();
+    stats.record(LatencyStats::kFlush, now - traceFirstWriteNanos_);
+    stats.record(LatencyStats::kTotal, now - traceStartNanos_);
+    traceStartNanos_ = 0;
+    traceFirstWriteNanos_ = 0;
+}
+
 void TcpConnection::handleWrite()
 {
+    if (tls_ && !tls_->established())
+    {
+        handleHandshake();
+        return;
+    }
     if (channel_->isWriting())
     {
         int saveErrno = 0;
-        ssize_t n = ouputBuffer_.writeFd(channel_->fd(), &saveErrno);
-        if (n > 0)
+        if (flushOutput(&saveErrno))
         {
-            ouputBuffer_.retrieve(n);              // n个字节的数据已经处理过了
-            if (ouputBuffer_.readAbleBytes() == 0) // 发送完成
+            if (pendingOutputBytes() == 0) // 发送完成
             {
                 channel_->disableWriting();
+                if (latencyTraced_)
+                {
+                    traceWriteComplete();
+                }
                 if (writeCompleteCallback_)
                 {
                     // 唤醒loop对应的thread线程，执行回调
@@ -240,6 +1134,7 @@ void TcpConnection::handleWrite()
         }
         else
         {
+            errno = saveErrno;
             LOG_ERROR("TcpConnection::handleWrite");
         }
     }
@@ -253,15 +1148,25 @@ void TcpConnection::handleWrite()
 void TcpConnection::handleClose()
 {
     LOG_INFO("fd=%d state=%d \n", channel_->fd(), (int)state_);
+    Metrics::add(Metrics::kConnectionsClosed, 1);
     setState(kDisconnected);
     channel_->disableAll();
     TcpConnectionPtr connPtr(shared_from_this());
-    connectionCallback_(connPtr); // 执行连接关闭的回调
+    if (!tls_ || tls_->established()) // 握手没有完成的连接对用户是不可见的
+    {
+        connectionCallback_(connPtr); // 执行连接关闭的回调
+    }
     closeCallback_(connPtr);      // 关闭连接的回调 执行的是TcpServer::removeConnection回调方法
 }
 
 void TcpConnection::handleError()
 {
+    // 关闭零拷贝之后错误队列里也可能还有之前发送的完成通知，不读掉的话EPOLLERR会一直上报
+    bool zeroCopyUsed = zeroCopy_ || zeroCopySeq_ != 0;
+    if (zeroCopyUsed)
+    {
+        handleZeroCopyCompletions();
+    }
     int optval;
     socklen_t optlen = sizeof(optval);
     int err = 0;
@@ -274,6 +1179,10 @@ void TcpConnection::handleError()
     {
         err = optval;
     }
+    if (zeroCopyUsed && err == 0) // EPOLLERR只是错误队列中有零拷贝完成通知
+    {
+        return;
+    }
     LOG_ERROR("TcpConnection::handleError name:%s- SOL_ERROR:%d \n",
-              name_.c_str(), err);
+              name().c_str(), err);
 }
\ No newline at end of file
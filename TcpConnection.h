@@ -5,14 +5,22 @@
 #include "Callbacks.h"
 #include "Buffer.h"
 #include "TimeStamp.h"
+#include "SocketOptions.h"
 
 #include <memory>
 #include <string>
 #include <atomic>
+#include <deque>
+#include <vector>
+#include <mutex>
+#include <stdint.h>
+#include <sys/types.h>
 
 class Channel;
 class EventLoop;
 class Socket;
+class TlsContext;
+class TlsSession;
 
 /**************************
  * TcpServer ==> Acceptor ==> 新用户连接，通过accept函数拿到connfd
@@ -27,23 +35,83 @@ class TcpConnection : noncopyable, public std::enable_shared_from_this<TcpConnec
 public:
     TcpConnection(EventLoop *loop, const std::string &name, int sockfd,
                   const InetAddress &localAddr, const InetAddress &peerAddr);
+    // TcpServer使用: 名字是namePrefix加上id，第一次调用name()时才格式化
+    TcpConnection(EventLoop *loop, uint64_t id, const std::shared_ptr<const std::string> &namePrefix,
+                  int sockfd, const InetAddress &localAddr, const InetAddress &peerAddr);
     ~TcpConnection();
 
-    // 发送数据
+    // 发送数据，在其他线程中调用时会拷贝一份buf交给loop
     void send(const std::string &buf);
+    void send(const void *data, size_t len);
+    // 接管buf的所有权发送，跨线程时只移动不拷贝，开启零拷贝时大块数据会通过MSG_ZEROCOPY直接发送
+    void send(std::string &&buf);
+    void send(std::vector<char> &&buf);
+    // 发送buf中的全部可读数据，buf的内容被交换给连接，调用之后buf为空
+    void send(Buffer *buf);
+    // 零拷贝发送文件fd的[offset, offset+length)区间，排在已缓冲数据之后由sendfile发送，
+    // 内部会dup一份fd，调用方可以立即关闭自己的fd
+    void sendFile(int fd, off_t offset, size_t length);
+    // 通过splice把pipe或socket上当前可读的最多length字节搬到连接的内核pipe中再发往对端，
+    // 只能在loop线程中调用，返回搬运的字节数；返回-1且errno为EAGAIN说明源上暂无数据或pipe已满
+    ssize_t spliceFrom(int fd, size_t length);
     // 关闭连接
     void shutdown();
+    // 不等待缓冲区数据发完，直接断开连接，用于对端数据已不可信的场景(如协议解析出错)
+    void forceClose();
     // 连接建立
     void connectEstablished();
     // 连接销毁
     void connectDestroyed();
 
+    // 大于等于该长度的数据才走MSG_ZEROCOPY，更小的数据页面固定和完成通知的开销超过拷贝本身
+    static const size_t kZeroCopyThreshold = 32 * 1024;
+    // 开启/关闭零拷贝发送，只对所有权交给连接的数据生效(send的右值和Buffer*重载)，需要在loop线程中调用
+    void setZeroCopy(bool on, size_t threshold = kZeroCopyThreshold);
+    bool zeroCopy() const { return zeroCopy_; }
+
+    // 暂停/恢复读取对端数据(取消/注册EPOLLIN)，可以在任意线程中调用
+    void startRead();
+    void stopRead();
+    bool isReading() const { return reading_; }
+
+    // 读端流量控制：本连接待发送数据越过highWaterMark时暂停source的读，回落到lowWaterMark及以下时恢复。
+    // source可以是本连接自身(回显类服务遇到慢客户端)，也可以是代理中的另一端连接，这里只持有它的weak_ptr
+    // 水位线与setHighWaterMarkCallback/setLowWaterMarkCallback的各自独立，互不影响
+    void setBackpressureSource(const TcpConnectionPtr &source, size_t highWaterMark, size_t lowWaterMark);
+
+    // 在connectEstablished之前调用，连接建立后先做TLS握手，握手完成才回调connectionCallback，
+    // 之后收发的都是明文，加解密在内部完成。开启TLS后不能再使用零拷贝发送
+    void setTls(const std::shared_ptr<TlsContext> &context);
+    bool secure() const { return tls_ != nullptr; }
+    // 发送方向的加密是否已经交给内核(kTLS)
+    bool kernelTlsSend() const;
+
+    // 对本连接做延迟采样，各阶段耗时记录到所在loop的LatencyStats(见LatencyStats.h)，
+    // 同时开启loop的延迟统计。需要在loop线程中调用，或者在connectEstablished之前调用
+    void setLatencyTracing(bool on);
+
+    // 关闭Nagle算法，小块数据立即发送
+    void setTcpNoDelay(bool on);
+    // 用options覆盖这个连接当前的选项(初始为TcpServer::setSocketOptions的设置)，需要在loop线程中调用
+    // nodelay、quickack、keepalive、linger按options打开或关闭；缓冲区大小和notSentLowat为0时保持当前的设置
+    void setSocketOptions(const SocketOptions &options);
+
+    // 合并写：开启后本轮事件循环中的多次send只追加到缓冲区，由loop在本轮结束时用一次writev发送，
+    // msgMore为true时，后面还有sendfile/splice区间的writev会带上MSG_MORE。需要在loop线程中调用
+    void setCorkWrites(bool on, bool msgMore = false);
+
     EventLoop *getLoop() const { return loop_; }
-    const std::string name() { return name_; }
+    const std::string &name() const;
+    // TcpServer分配的连接编号，在同一个TcpServer内唯一；用名字构造的连接为0
+    uint64_t id() const { return id_; }
     const InetAddress &localAddress() { return localAddr_; }
     const InetAddress &perrAddress() { return peerAddr_; }
+    // 最近一次处理该连接收包的CPU(SO_INCOMING_CPU)，取不到时返回-1
+    int incomingCpu() const;
 
     bool connected() const { return state_ == kConnected; }
+    // 还未写入内核的数据量，包括ouputBuffer_和排队中的sendFile/spliceFrom区间
+    size_t pendingOutputBytes() const { return ouputBuffer_.readAbleBytes() + regionBytes_; }
 
     void setConnectionCallback(const ConnectionCallback &cb)
     {
@@ -54,17 +122,36 @@ public:
     {
         messageCallback_ = cb;
     }
-    void setWriteCompleteCallback(const WriteCompleteCallback &cb, size_t highWaterMark)
+    void setWriteCompleteCallback(const WriteCompleteCallback &cb)
     {
         writeCompleteCallback_ = cb;
+    }
+    // 待发送数据从highWaterMark以下增长到highWaterMark及以上时回调，每次向上越过都回调一次
+    void setHighWaterMarkCallback(const HighWaterMarkCallback &cb, size_t highWaterMark)
+    {
+        highWaterMarkCallback_ = cb;
         highWaterMark_ = highWaterMark;
     }
+    // 越过高水位线之后，待发送数据回落到lowWaterMark及以下时回调一次
+    void setLowWaterMarkCallback(const LowWaterMarkCallback &cb, size_t lowWaterMark)
+    {
+        lowWaterMarkCallback_ = cb;
+        lowWaterMark_ = lowWaterMark;
+    }
     void setCloseCallback(const CloseCallback &cb)
     {
         closeCallback_ = cb;
     }
 
+    // 连接上附带的用户数据，比如协议解析器的状态，只在连接所在的loop线程中访问
+    void setContext(const std::shared_ptr<void> &context) { context_ = context; }
+    const std::shared_ptr<void> &getContext() const { return context_; }
+
 private:
+    TcpConnection(EventLoop *loop, uint64_t id, const std::shared_ptr<const std::string> &namePrefix,
+                  const std::string &name, int sockfd,
+                  const InetAddress &localAddr, const InetAddress &peerAddr);
+
     enum StateE
     {
         kDisconnected,
@@ -79,13 +166,69 @@ private:
     void handleWrite();
     void handleClose();
     void handleError();
+    void handleHandshake();
+    void traceHandled(int64_t readStart);
+    void traceFirstWrite();
+    void traceWriteComplete();
+    // 需要在用户态加密发送，此时发送路径上的write/writev/sendfile都改为经过SSL_write
+    bool userSpaceTls() const;
 
     void sendInLoop(const void *data, size_t len);
+    void sendFileInLoop(int fd, off_t offset, size_t length);
+    template <typename Payload>
+    void sendOwned(Payload &payload);
+    template <typename Payload>
+    void sendPayloadInLoop(Payload &payload);
+
+    // 排在ouputBuffer_之后等待零拷贝发送的数据区间
+    struct OutputRegion
+    {
+        enum Kind
+        {
+            kFile, // sendfile发送fd上的文件区间
+            kPipe, // splice发送pipeFds_中的数据
+            kData, // 发送连接接管的用户数据data
+        };
+        Kind kind;
+        int fd;                      // sendfile的源文件(dup所得)
+        off_t offset;                // 文件偏移，kData时为data中的偏移
+        size_t remaining;            // 该区间剩余未发送的字节数
+        std::shared_ptr<void> owner; // 持有data所在的string/vector/Buffer，零拷贝完成之前不能释放
+        const char *data;
+        bool zeroCopy;               // kData区间是否使用MSG_ZEROCOPY发送
+        uint32_t lastZeroCopySeq;    // 发送该区间用到的最后一个零拷贝序号
+        bool zeroCopied;             // 是否有数据以MSG_ZEROCOPY方式发送过
+        Buffer tail;                 // 区间之后通过send追加的数据，区间发完后换入ouputBuffer_
+    };
+
+    // 尽可能多地发送ouputBuffer_和regions_中的数据，遇到EAGAIN返回true，出错返回false
+    bool flushOutput(int *saveErrno);
+    void startRegionWrite();
+    void writePending();
+    void scheduleFlush();
+    void flushCorked();
+    ssize_t writeGathered(size_t *expected);
+    void consumeOutput(size_t n);
+    void finishFrontRegion();
+    static bool isGatherable(const OutputRegion &region);
+    void queueOutput(const char *data, size_t len);
+    void checkHighWaterMark(size_t len);
+    void updateBufferMetrics();
+    void checkLowWaterMark();
+    void pushRegion(OutputRegion &&region);
+    ssize_t sendRegion(OutputRegion &region);
+    void handleZeroCopyCompletions();
 
     void shutdownInLoop();
+    void forceCloseInLoop();
+    void startReadInLoop();
+    void stopReadInLoop();
 
     EventLoop *loop_; // 此处不死baseLoop，因为TcpConnection都是在Subloop上管理的
-    const std::string name_;
+    const uint64_t id_;
+    const std::shared_ptr<const std::string> namePrefix_;
+    mutable std::string name_;
+    mutable std::once_flag nameOnce_;
     std::atomic_int state_;
     bool reading_;
 
@@ -101,9 +244,46 @@ private:
     CloseCallback closeCallback_; //由TcpServer对其进行赋值
     HighWaterMarkCallback highWaterMarkCallback_;
     size_t highWaterMark_; // 高水位线（多少算水位），避免接收方接受速率太慢发送速率太快
+    LowWaterMarkCallback lowWaterMarkCallback_;
+    size_t lowWaterMark_;
+    bool aboveHighWaterMark_; // 越过高水位线之后还没有回落到低水位线，用于lowWaterMarkCallback_
+
+    // 读端流量控制，见setBackpressureSource
+    std::weak_ptr<TcpConnection> backpressureSource_;
+    size_t backpressureHigh_; // 0表示不启用
+    size_t backpressureLow_;
+    bool readPausedByBackpressure_;
 
     // 应用生产数据的速度可能会快于网络层和数据链路层的发送速度，\
     因此加入了缓冲区
     Buffer inputBuffer_; // 接收数据的缓冲区
     Buffer ouputBuffer_; // 发送数据的缓冲区
+    size_t bufferBytes_; // 已计入Metrics::kBufferBytes的两个缓冲区容量之和
+
+    std::deque<OutputRegion> regions_; // sendFile/spliceFrom排队的零拷贝区间
+    size_t regionBytes_;               // regions_中待发送的字节数(含各区间的tail)
+    int pipeFds_[2];                   // spliceFrom使用的内核pipe，第一次使用时创建
+
+    bool zeroCopy_;
+    size_t zeroCopyThreshold_;
+    uint32_t zeroCopySeq_; // 下一次MSG_ZEROCOPY发送的序号，与内核完成通知中的序号一一对应
+    uint32_t zeroCopyDoneSeq_; // 小于它的序号都已经收到完成通知
+    // 已发送但内核尚未通知完成的数据，按序号递增排列
+    std::deque<std::pair<uint32_t, std::shared_ptr<void>>> zeroCopyPinned_;
+
+    // 当前生效的选项，setSocketOptions只对变化的项做系统调用；
+    // 其中quickAck开启时每次读完数据都要重新设置，内核会自己退出quickack模式
+    SocketOptions socketOptions_;
+    bool corkWrites_;
+    bool msgMore_;
+    bool flushQueued_; // 是否已经登记了本轮结束时的flushCorked
+
+    std::shared_ptr<void> context_;
+
+    std::unique_ptr<TlsSession> tls_;
+
+    // 延迟采样，未采样的连接在各打点处只多一次分支判断
+    bool latencyTraced_;
+    int64_t traceStartNanos_;      // 当前请求对应的epoll返回时间，0表示没有等待响应的请求
+    int64_t traceFirstWriteNanos_; // 当前请求的响应第一次写出的时间，0表示还没有写
 };
\ No newline at end of file
@@ -0,0 +1,155 @@
+#include "TcpConnectionPool.h"
+#include "TcpClient.h"
+#include "TcpConnection.h"
+#include "EventLoop.h"
+#include "Logger.h"
+
+#include <algorithm>
+#include <stdio.h>
+
+TcpConnectionPool::TcpConnectionPool(EventLoop *loop, const InetAddress &serverAddr, const std::string &name,
+                                     size_t minIdle, size_t maxConnections)
+    : loop_(loop),
+      serverAddr_(serverAddr),
+      name_(name),
+      minIdle_(minIdle),
+      maxConnections_(std::max(minIdle, maxConnections)),
+      nextWaiterId_(1)
+{
+}
+
+// 池析构之后连接关闭时的回调，连接上原来的回调绑定着已经析构的池
+static void detachedConnectionCallback(const TcpConnectionPtr &) {}
+
+TcpConnectionPool::~TcpConnectionPool()
+{
+    for (Waiter &waiter : waiters_)
+    {
+        loop_->cancel(waiter.timer);
+    }
+    // 空闲的连接由TcpClient析构时关闭，已经交给调用者的连接之后也会关闭，
+    // 关闭都在loop中异步完成，先把它们的连接回调换掉，不再回调到这个池；
+    // 和TcpClient析构时排队的forceClose在同一个loop里按顺序执行
+    for (const std::unique_ptr<TcpClient> &client : clients_)
+    {
+        TcpConnectionPtr conn = client->connection();
+        if (conn)
+        {
+            loop_->runInLoop(std::bind(&TcpConnection::setConnectionCallback, conn,
+                                       ConnectionCallback(detachedConnectionCallback)));
+        }
+    }
+    // 先放掉空闲连接的引用，TcpClient析构时才会关闭它们
+    idle_.clear();
+    clients_.clear();
+}
+
+void TcpConnectionPool::start()
+{
+    while (clients_.size() < minIdle_)
+    {
+        addClient();
+    }
+}
+
+void TcpConnectionPool::addClient()
+{
+    char buf[32];
+    snprintf(buf, sizeof buf, "-%zu", clients_.size());
+    std::unique_ptr<TcpClient> client(new TcpClient(loop_, serverAddr_, name_ + buf));
+    client->setConnectionCallback(
+        std::bind(&TcpConnectionPool::onConnection, this, std::placeholders::_1));
+    if (messageCallback_)
+    {
+        client->setMessageCallback(messageCallback_);
+    }
+    client->enableRetry();
+    client->connect();
+    clients_.push_back(std::move(client));
+}
+
+void TcpConnectionPool::onConnection(const TcpConnectionPtr &conn)
+{
+    if (conn->connected())
+    {
+        conn->setTcpNoDelay(true);
+        handOut(conn);
+    }
+    else
+    {
+        auto it = std::find(idle_.begin(), idle_.end(), conn);
+        if (it != idle_.end())
+        {
+            idle_.erase(it);
+        }
+    }
+}
+
+void TcpConnectionPool::handOut(const TcpConnectionPtr &conn)
+{
+    if (waiters_.empty())
+    {
+        idle_.push_back(conn);
+        return;
+    }
+    Waiter waiter = std::move(waiters_.front());
+    waiters_.pop_front();
+    loop_->cancel(waiter.timer);
+    waiter.callback(conn);
+}
+
+TcpConnectionPtr TcpConnectionPool::tryAcquire()
+{
+    TcpConnectionPtr conn;
+    if (!idle_.empty())
+    {
+        conn = std::move(idle_.back());
+        idle_.pop_back();
+    }
+    return conn;
+}
+
+void TcpConnectionPool::acquire(AcquireCallback cb, double timeout)
+{
+    TcpConnectionPtr conn = tryAcquire();
+    if (conn)
+    {
+        cb(conn);
+        return;
+    }
+    if (clients_.size() < maxConnections_)
+    {
+        // 新连接建立后交给排在最前面的等待者
+        addClient();
+    }
+    Waiter waiter;
+    waiter.id = nextWaiterId_++;
+    waiter.callback = std::move(cb);
+    if (timeout > 0)
+    {
+        waiter.timer = loop_->runAfter(timeout, std::bind(&TcpConnectionPool::onAcquireTimeout, this, waiter.id));
+    }
+    waiters_.push_back(std::move(waiter));
+}
+
+void TcpConnectionPool::release(const TcpConnectionPtr &conn)
+{
+    if (conn && conn->connected())
+    {
+        handOut(conn);
+    }
+}
+
+void TcpConnectionPool::onAcquireTimeout(uint64_t id)
+{
+    for (auto it = waiters_.begin(); it != waiters_.end(); ++it)
+    {
+        if (it->id == id)
+        {
+            AcquireCallback cb = std::move(it->callback);
+            waiters_.erase(it);
+            cb(TcpConnectionPtr());
+            return;
+        }
+    }
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include "noncopyable.h"
+#include "InetAddress.h"
+#include "Callbacks.h"
+#include "TimerId.h"
+
+#include <functional>
+#include <string>
+#include <vector>
+#include <deque>
+#include <memory>
+
+class EventLoop;
+class TcpClient;
+
+/**************************
+ * 一个loop上通往同一个上游的连接池，只能在该loop线程中使用，每个IO loop各建一个
+ * (比如在TcpServer的ThreadInitCallback里创建)，这样取连接既不用等connect也不涉及跨线程转交
+ * start时预先建立minIdle条连接，acquire取走一条空闲连接独占使用，用完release归还；
+ * 没有空闲连接时在maxConnections以内新建，否则排队等待归还
+ * 连接断开后由TcpClient自动重连，重连成功后重新回到池中
+ **************************/
+class TcpConnectionPool : noncopyable
+{
+public:
+    // 拿到连接时回调，超时时conn为空
+    using AcquireCallback = std::function<void(const TcpConnectionPtr &conn)>;
+
+    TcpConnectionPool(EventLoop *loop, const InetAddress &serverAddr, const std::string &name,
+                      size_t minIdle, size_t maxConnections);
+    ~TcpConnectionPool();
+
+    // 池中所有连接共用的消息回调，需要在start之前设置
+    void setMessageCallback(const MessageCallback &cb) { messageCallback_ = cb; }
+    void start();
+
+    // 有空闲连接时返回最近归还的一条，否则返回空
+    TcpConnectionPtr tryAcquire();
+    // timeout为0表示一直等待，单位秒
+    void acquire(AcquireCallback cb, double timeout = 0.0);
+    // 归还acquire得到的连接，已经断开的连接直接丢弃
+    void release(const TcpConnectionPtr &conn);
+
+    size_t idleConnections() const { return idle_.size(); }
+    size_t totalConnections() const { return clients_.size(); }
+    size_t waiters() const { return waiters_.size(); }
+
+private:
+    struct Waiter
+    {
+        uint64_t id;
+        AcquireCallback callback;
+        TimerId timer;
+    };
+
+    void addClient();
+    void onConnection(const TcpConnectionPtr &conn);
+    void handOut(const TcpConnectionPtr &conn);
+    void onAcquireTimeout(uint64_t id);
+
+    EventLoop *loop_;
+    const InetAddress serverAddr_;
+    const std::string name_;
+    const size_t minIdle_;
+    const size_t maxConnections_;
+    MessageCallback messageCallback_;
+    std::vector<std::unique_ptr<TcpClient>> clients_;
+    std::vector<TcpConnectionPtr> idle_; // 后归还的在末尾，优先取用
+    std::deque<Waiter> waiters_;
+    uint64_t nextWaiterId_;
+};
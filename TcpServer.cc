@@ -1,9 +1,13 @@
 #include "TcpServer.h"
 #include "Logger.h"
 #include "TcpConnection.h"
+#include "Metrics.h"
 
 #include <functional>
+#include <future>
 #include <strings.h>
+#include <pthread.h>
+#include <sched.h>
 
 EventLoop *ChecNotNull(EventLoop *loop)
 {
@@ -14,38 +18,82 @@ EventLoop *ChecNotNull(EventLoop *loop)
     return loop;
 }
 
+// 在loop线程中执行cb并等它完成，当前就是loop线程时直接执行
+static void runInLoopAndWait(EventLoop *loop, const std::function<void()> &cb)
+{
+    std::promise<void> done;
+    loop->runInLoop([&]()
+                    {
+                        cb();
+                        done.set_value();
+                    });
+    done.get_future().wait();
+}
+
 TcpServer::TcpServer(EventLoop *loop, const InetAddress &listenAddr,
                      const std::string nameArgs, Option option)
     : loop_(ChecNotNull(loop)),
+      listenAddr_(listenAddr),
       ipPort_(listenAddr.toIpPort()),
       name_(nameArgs),
+      connNamePrefix_(std::make_shared<const std::string>(name_ + "-" + ipPort_ + "#")),
       acceptor_(new Acceptor(loop, listenAddr, option == kReusePort)),
       threadPool_(new EventLoopThreadPool(loop, name_)), // 事件循环线程池
       connectionCallback_(),
       messageCallback_(),
+      highWaterMark_(64 * 1024 * 1024),
+      backpressureHighWaterMark_(0),
+      backpressureLowWaterMark_(0),
+      started_(0),
+      corkWrites_(false),
+      msgMore_(false),
+      latencySampleEvery_(0),
+      maxConnections_(0),
+      acceptBatchSize_(Acceptor::kDefaultBatchSize),
+      acceptRetryDelay_(0.1),
+      cpuSteering_(false),
       nextConnId_(1),
-      started_(0)
+      numConnections_(0),
+      alive_(std::make_shared<bool>(true))
 {
     // 当由新用户连接时，会执行TcpServer::newConnection回调
     acceptor_->setNewConnectionCallback(std::bind(&TcpServer::newConnection, this,
                                                   std::placeholders::_1, std::placeholders::_2));
+    acceptor_->setBatchEndCallback(std::bind(&TcpServer::establishPending, this));
 }
 
 TcpServer::~TcpServer()
 {
-    for (auto &it : connections_)
+    // 各个loop里的Acceptor和连接的回调都持有this，先在各自的loop里关掉CPU分流模式的监听socket，
+    // 全部关完之后再销毁连接，每一步都等它完成，返回之后subloop不会再回调到这个TcpServer
+    for (auto &it : shards_)
+    {
+        ConnectionShardPtr shard = it.second;
+        runInLoopAndWait(it.first, [shard]()
+                         { shard->acceptor.reset(); });
+    }
+    for (auto &it : shards_)
+    {
+        runInLoopAndWait(it.first, std::bind(&TcpServer::destroyConnections, it.second));
+    }
+}
+
+void TcpServer::destroyConnections(const ConnectionShardPtr &shard)
+{
+    Metrics::add(Metrics::kServerConnections, -static_cast<int64_t>(shard->connections.size()));
+    for (auto &it : shard->connections)
     {
         /*下面这两行代码的含义：
-        TcpServer中connections_的强智能指针不再指向TcpConnection,
+        TcpServer中connections的强智能指针不再指向TcpConnection,
         换成一个局部对象指向TcpConnection，出了其生命范围之后则会自动释放资源
         **/
         TcpConnectionPtr conn(it.second); // 这个局部的shared_ptr智能指针对象，出右括号，可以自动释放new出来的TcpConnection对象资源了
         it.second.reset();
 
         //销毁连接
-        conn->getLoop()->runInLoop(
-            std::bind(&TcpConnection::connectDestroyed, conn));
+        conn->connectDestroyed();
     }
+    shard->connections.clear();
 }
 
 // 设置底层subloop的个数
@@ -60,7 +108,149 @@ void TcpServer::start()
     if (started_++ == 0) // 防止一个TcpServer对象被start多次
     {
         threadPool_->start(threadInitCallback_); // 启动底层的loop线程池
+        for (EventLoop *ioLoop : threadPool_->getAllLoops())
+        {
+            shards_[ioLoop] = std::make_shared<ConnectionShard>(ioLoop);
+        }
+        if (cpuSteering_)
+        {
+            startCpuSteering();
+        }
+        else
+        {
+            loop_->runInLoop(std::bind(&Acceptor::listen, acceptor_.get()));
+        }
+    }
+}
+
+// 当前线程允许运行的CPU，按编号从小到大
+static std::vector<int> allowedCpus()
+{
+    std::vector<int> cpus;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (::sched_getaffinity(0, sizeof set, &set) == 0)
+    {
+        for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+        {
+            if (CPU_ISSET(cpu, &set))
+            {
+                cpus.push_back(cpu);
+            }
+        }
+    }
+    return cpus;
+}
+
+static void pinCurrentThread(int cpu)
+{
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    int err = ::pthread_setaffinity_np(::pthread_self(), sizeof set, &set);
+    if (err != 0)
+    {
+        LOG_ERROR("pin loop thread to cpu %d failed:%d \n", cpu, err);
+    }
+}
+
+// 在loop线程中执行cb并等它完成
+void TcpServer::startCpuSteering()
+{
+    std::vector<int> cpus = allowedCpus();
+    std::vector<EventLoop *> loops = threadPool_->getAllLoops();
+    if (cpus.empty())
+    {
+        LOG_ERROR("TcpServer [%s] sched_getaffinity failed, cpu steering disabled \n", name_.c_str());
         loop_->runInLoop(std::bind(&Acceptor::listen, acceptor_.get()));
+        return;
+    }
+    if (loops.size() > cpus.size())
+    {
+        LOG_ERROR("TcpServer [%s] %zu loops but only %zu cpus, extra loops get no connections \n",
+                  name_.c_str(), loops.size(), cpus.size());
+    }
+
+    // acceptor_已经bind但不listen，不在reuseport组里；组里socket的下标就是listen的顺序，
+    // 所以各个loop按顺序依次listen，每个都等上一个完成
+    std::vector<int> listenerCpus;
+    for (size_t i = 0; i < loops.size(); ++i)
+    {
+        ConnectionShard *shard = shards_[loops[i]].get();
+        shard->cpu = cpus[i % cpus.size()];
+        shard->acceptor.reset(new Acceptor(shard->loop, listenAddr_, true));
+        shard->acceptor->setNewConnectionCallback(std::bind(&TcpServer::newSteeredConnection, this, shard,
+                                                            std::placeholders::_1, std::placeholders::_2));
+        shard->acceptor->setSocketOptions(socketOptions_);
+        shard->acceptor->setBatchSize(acceptBatchSize_);
+        shard->acceptor->setRetryDelay(acceptRetryDelay_);
+        shard->acceptor->setIncomingCpu(shard->cpu);
+        runInLoopAndWait(shard->loop, [shard]()
+                         {
+                             pinCurrentThread(shard->cpu);
+                             shard->acceptor->listen();
+                         });
+        listenerCpus.push_back(shard->cpu);
+    }
+    // 程序挂在组上，通过任意一个socket设置都可以
+    Acceptor *first = shards_[loops[0]]->acceptor.get();
+    if (!first->attachCpuSteeringProgram(listenerCpus))
+    {
+        LOG_ERROR("TcpServer [%s] attach reuseport cbpf failed:%d, fall back to SO_INCOMING_CPU only \n",
+                  name_.c_str(), errno);
+    }
+}
+
+TcpServer::CpuSteeringStats TcpServer::cpuSteeringStats() const
+{
+    CpuSteeringStats stats = {0, 0};
+    for (const auto &it : shards_)
+    {
+        stats.connections += it.second->steeredConnections.load(std::memory_order_relaxed);
+        stats.cpuMatched += it.second->steeredCpuMatches.load(std::memory_order_relaxed);
+    }
+    return stats;
+}
+
+std::string TcpServer::latencyReport() const
+{
+    std::vector<EventLoop *> loops = threadPool_->getAllLoops();
+    LatencyHistogram::Snapshot merged[LatencyStats::kNumStages];
+    std::string result;
+    char title[64];
+    for (size_t i = 0; i < loops.size(); ++i)
+    {
+        LatencyHistogram::Snapshot snapshots[LatencyStats::kNumStages];
+        for (int stage = 0; stage < LatencyStats::kNumStages; ++stage)
+        {
+            snapshots[stage] = loops[i]->latencyStats().snapshot(static_cast<LatencyStats::Stage>(stage));
+            merged[stage].merge(snapshots[stage]);
+        }
+        snprintf(title, sizeof title, "[%s loop %zu]\n", name_.c_str(), i);
+        result += title;
+        result += LatencyStats::format(snapshots);
+    }
+    snprintf(title, sizeof title, "[%s all loops]\n", name_.c_str());
+    result += title;
+    result += LatencyStats::format(merged);
+    return result;
+}
+
+LatencyHistogram::Snapshot TcpServer::latencySnapshot(LatencyStats::Stage stage) const
+{
+    LatencyHistogram::Snapshot merged;
+    for (EventLoop *loop : threadPool_->getAllLoops())
+    {
+        merged.merge(loop->latencyStats().snapshot(stage));
+    }
+    return merged;
+}
+
+void TcpServer::resetLatencyStats()
+{
+    for (EventLoop *loop : threadPool_->getAllLoops())
+    {
+        loop->latencyStats().reset();
     }
 }
 
@@ -69,17 +259,38 @@ void TcpServer::newConnection(int sockfd, const InetAddress &peerAddr)
 {
     // 轮询算法：选择一个subloop来管理channel
     EventLoop *ioLoop = threadPool_->getNextLoop();
+    TcpConnectionPtr conn = createConnection(shards_[ioLoop].get(), sockfd, peerAddr);
 
-    char buf[64] = {0};
-    snprintf(buf, sizeof buf, "-%s#%d", ipPort_.c_str(), nextConnId_);
-    ++nextConnId_;
-    std::string connName = name_ + buf;
+    // 这一批accept结束时再统一交给各自的subloop，见establishPending
+    pendingEstablish_[ioLoop].push_back(conn);
+}
 
-    LOG_INFO("TcpServer::newConnection [%s] - new connection [%s] from %s \n",
-             name_.c_str(), connName.c_str(), peerAddr.toIpPort().c_str());
+// 连接由收到SYN的CPU上的loop accept，直接在这个loop里建立，不经过baseLoop
+void TcpServer::newSteeredConnection(ConnectionShard *shard, int sockfd, const InetAddress &peerAddr)
+{
+    TcpConnectionPtr conn = createConnection(shard, sockfd, peerAddr);
+    bool matched = conn->incomingCpu() == shard->cpu;
+    shard->steeredConnections.store(shard->steeredConnections.load(std::memory_order_relaxed) + 1,
+                                    std::memory_order_relaxed);
+    Metrics::add(Metrics::kSteeredConnections, 1);
+    if (matched)
+    {
+        shard->steeredCpuMatches.store(shard->steeredCpuMatches.load(std::memory_order_relaxed) + 1,
+                                       std::memory_order_relaxed);
+        Metrics::add(Metrics::kSteeredCpuMatches, 1);
+    }
+
+    shard->connections[conn->id()] = conn;
+    Metrics::add(Metrics::kServerConnections, 1);
+    conn->connectEstablished();
+}
+
+TcpConnectionPtr TcpServer::createConnection(ConnectionShard *shard, int sockfd, const InetAddress &peerAddr)
+{
+    uint64_t connId = nextConnId_.fetch_add(1, std::memory_order_relaxed);
 
     // 通过sockfd获取其绑定的本机IP地址和端口信息
-    sockaddr_in local;
+    sockaddr_storage local;
     ::bzero(&local, sizeof local);
     socklen_t addrlen = sizeof local;
     if (::getsockname(sockfd, (sockaddr *)&local, &addrlen) < 0)
@@ -87,43 +298,132 @@ void TcpServer::newConnection(int sockfd, const InetAddress &peerAddr)
         LOG_ERROR("sockets::getLocalAddr");
     }
 
-    InetAddress localAddr(local);
+    InetAddress localAddr;
+    localAddr.setSockAddr((sockaddr *)&local, addrlen);
 
-    // 根据连接成功的sockfd，创建TcpConnection连接对象
+    // 根据连接成功的sockfd，创建TcpConnection连接对象，名字等到用到时再格式化
     TcpConnectionPtr conn(new TcpConnection(
-        ioLoop,
-        connName,
+        shard->loop,
+        connId,
+        connNamePrefix_,
         sockfd, // Socket Channel
         localAddr,
         peerAddr));
-    connections_[connName] = conn;
+    // 只打印编号，连接名(名字前缀+编号)用到时才格式化
+    LOG_INFO("TcpServer::newConnection [%s] - new connection #%llu from %s \n",
+             name_.c_str(), static_cast<unsigned long long>(connId), peerAddr.toIpPort().c_str());
+    if (++numConnections_ >= maxConnections_ && maxConnections_ > 0)
+    {
+        requestThrottleUpdate();
+    }
 
     // 下面的回调都是用户设置给TcpServer => TcpConnection => Channel => Poller => notify Channel回调
     conn->setConnectionCallback(connectionCallback_);
     conn->setMessageCallback(messageCallback_);
-    conn->setWriteCompleteCallback(writeCompleteCallback_, 1024);
+    conn->setWriteCompleteCallback(writeCompleteCallback_);
+    if (highWaterMarkCallback_)
+    {
+        conn->setHighWaterMarkCallback(highWaterMarkCallback_, highWaterMark_);
+    }
+    if (backpressureHighWaterMark_ > 0)
+    {
+        // 慢客户端来不及接收时暂停读它的请求，输出缓冲区的内存因此有上限
+        conn->setBackpressureSource(conn, backpressureHighWaterMark_, backpressureLowWaterMark_);
+    }
+    conn->setCorkWrites(corkWrites_, msgMore_);
+    conn->setSocketOptions(socketOptions_);
+    if (tlsContext_)
+    {
+        conn->setTls(tlsContext_);
+    }
+    if (latencySampleEvery_ > 0 && (connId - 1) % latencySampleEvery_ == 0)
+    {
+        conn->setLatencyTracing(true);
+    }
 
     // 设置了如何关闭连接的回调 用户直接调用conn->shutdown()
     conn->setCloseCallback(
-        std::bind(&TcpServer::removeConnection, this, std::placeholders::_1));
+        std::bind(&TcpServer::removeConnection, this, shard, std::placeholders::_1));
+    return conn;
+}
 
-    // 直接调用
-    ioLoop->runInLoop(std::bind(&TcpConnection::connectEstablished, conn));
+// Acceptor一次可读事件中accept到的连接，每个subloop只排队一个回调、唤醒一次
+void TcpServer::establishPending()
+{
+    for (auto &it : pendingEstablish_)
+    {
+        if (!it.second.empty())
+        {
+            it.first->runInLoop(std::bind(&TcpServer::establishInLoop, this,
+                                          shards_[it.first].get(), std::move(it.second)));
+            it.second.clear();
+        }
+    }
 }
 
-void TcpServer::removeConnection(const TcpConnectionPtr &conn)
+void TcpServer::establishInLoop(ConnectionShard *shard, const std::vector<TcpConnectionPtr> &conns)
 {
-    loop_->runInLoop(
-        std::bind(&TcpServer::removeConnectionInLoop, this, conn));
+    for (const TcpConnectionPtr &conn : conns)
+    {
+        shard->connections[conn->id()] = conn;
+        conn->connectEstablished();
+    }
+    Metrics::add(Metrics::kServerConnections, static_cast<int64_t>(conns.size()));
 }
 
-void TcpServer::removeConnectionInLoop(const TcpConnectionPtr &conn)
+// 连接表就在当前的subloop里，关闭连接不再经过baseLoop
+void TcpServer::removeConnection(ConnectionShard *shard, const TcpConnectionPtr &conn)
 {
-    LOG_INFO("TcpServer::removeConnectionInLoop [%s] -connection %s \n",
-             name_.c_str(), conn->name().c_str());
+    LOG_INFO("TcpServer::removeConnection [%s] -connection #%llu \n",
+             name_.c_str(), static_cast<unsigned long long>(conn->id()));
 
-    connections_.erase(conn->name());
-    EventLoop *ioLoop = conn->getLoop();
-    ioLoop->queueInLoop(
+    if (shard->connections.erase(conn->id()) > 0)
+    {
+        Metrics::add(Metrics::kServerConnections, -1);
+    }
+    // 只有连接数从上限回落时才需要通知监听所在的loop
+    // 描述符用完的暂停不在这里恢复: 连接的描述符要等最后一个TcpConnectionPtr释放才关闭，
+    // 提前恢复的Acceptor会再次遇到EMFILE，用预留描述符拒绝掉一个等待中的客户端；交给Acceptor的定时器重试
+    if (numConnections_-- == maxConnections_ && maxConnections_ > 0)
+    {
+        requestThrottleUpdate();
+    }
+    // 当前还在channel的事件处理中，channel要等这一轮结束之后再移除
+    conn->getLoop()->queueInLoop(
         std::bind(&TcpConnection::connectDestroyed, conn));
 }
+
+void TcpServer::requestThrottleUpdate()
+{
+    if (!cpuSteering_)
+    {
+        // 析构时最后一批连接关闭发出的通知可能还排在baseLoop里，TcpServer已经析构就跳过
+        std::weak_ptr<bool> alive(alive_);
+        loop_->runInLoop([this, alive]()
+                         {
+                             if (alive.lock())
+                             {
+                                 updateThrottle(acceptor_.get());
+                             }
+                         });
+        return;
+    }
+    for (auto &it : shards_)
+    {
+        // acceptor只在自己的loop里读写，析构的第一步就释放它，之后到达的通知不会再访问this
+        ConnectionShardPtr shard = it.second;
+        it.first->runInLoop([this, shard]()
+                            {
+                                if (shard->acceptor)
+                                {
+                                    updateThrottle(shard->acceptor.get());
+                                }
+                            });
+    }
+}
+
+// 在acceptor所在的loop中，按当前的连接数决定是否暂停accept
+void TcpServer::updateThrottle(Acceptor *acceptor)
+{
+    acceptor->setThrottled(numConnections_.load() >= maxConnections_);
+}
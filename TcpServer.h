@@ -12,12 +12,15 @@
 #include "Callbacks.h"
 #include "TcpConnection.h"
 #include "TimeStamp.h"
+#include "LatencyStats.h"
+#include "SocketOptions.h"
 
 #include <functional>
 #include <string>
 #include <memory>
 #include <atomic>
 #include <unordered_map>
+#include <vector>
 
 // 对外服务器编程使用的类
 class TcpServer : noncopyable
@@ -39,6 +42,77 @@ public:
     void setConnectionCallback(const ConnectionCallback &cb) { connectionCallback_ = cb; }
     void setMessageCallback(const MessageCallback &cb) { messageCallback_ = cb; }
     void setWriteCompleteCallback(const WriteCompleteCallback &cb) { writeCompleteCallback_ = cb; }
+    void setHighWaterMarkCallback(const HighWaterMarkCallback &cb, size_t highWaterMark)
+    {
+        highWaterMarkCallback_ = cb;
+        highWaterMark_ = highWaterMark;
+    }
+    // 每个连接待发送数据越过highWaterMark时暂停读该连接，回落到lowWaterMark及以下时恢复，highWaterMark为0表示不限制
+    void setReadBackpressure(size_t highWaterMark, size_t lowWaterMark)
+    {
+        backpressureHighWaterMark_ = highWaterMark;
+        backpressureLowWaterMark_ = lowWaterMark;
+    }
+    // 之后建立的连接都先做TLS握手，context的模式要与之匹配(服务器用kServer，客户端用kClient)
+    void setTlsContext(const std::shared_ptr<TlsContext> &context) { tlsContext_ = context; }
+    // 对之后建立的所有连接开启合并写，见TcpConnection::setCorkWrites
+    void setCorkWrites(bool on, bool msgMore = false)
+    {
+        corkWrites_ = on;
+        msgMore_ = msgMore;
+    }
+
+    // 每sampleEvery个新连接中采样一个做延迟统计，0表示关闭(默认)，1表示所有连接，见LatencyStats.h
+    void setLatencySampling(int sampleEvery) { latencySampleEvery_ = sampleEvery; }
+    // 各个loop以及合并之后的各阶段延迟，start之后可以在任意线程中调用
+    std::string latencyReport() const;
+    // 所有loop合并之后某个阶段的延迟直方图
+    LatencyHistogram::Snapshot latencySnapshot(LatencyStats::Stage stage) const;
+    // 清零各个loop的延迟统计，用于分段测量
+    void resetLatencyStats();
+
+    // 连接数到达maxConnections时暂停accept，新连接留在内核的accept队列中，有连接关闭后恢复；0表示不限制(默认)
+    // 需要在start之前设置
+    void setMaxConnections(size_t maxConnections) { maxConnections_ = maxConnections; }
+    // 文件描述符用完时暂停accept的时间，见Acceptor
+    void setAcceptRetryDelay(double seconds)
+    {
+        acceptRetryDelay_ = seconds;
+        acceptor_->setRetryDelay(seconds);
+    }
+    // 监听socket和之后accept的每个连接都按options设置，需要在start之前调用
+    void setSocketOptions(const SocketOptions &options)
+    {
+        socketOptions_ = options;
+        acceptor_->setSocketOptions(options);
+    }
+    // 一次可读事件中最多accept的连接数，默认Acceptor::kDefaultBatchSize
+    void setAcceptBatchSize(int batchSize)
+    {
+        acceptBatchSize_ = batchSize;
+        acceptor_->setBatchSize(batchSize);
+    }
+
+    /*
+     * 按CPU分流连接，需要在start之前设置:
+     *   第i个subloop的线程绑定到可用CPU中的第i个，并在自己的loop里用SO_REUSEPORT监听同一个地址，
+     *   监听socket设置SO_INCOMING_CPU，整个reuseport组挂上按收包CPU选择socket的cBPF程序，
+     *   连接由处理它的SYN的那个CPU上的loop直接accept和服务，收包软中断和应用处理共用同一份缓存
+     * subloop个数不应超过可用的CPU数，多出来的loop收不到连接；没有subloop时只有baseLoop一个监听
+     * 要配合网卡RSS/RPS把不同连接的软中断分散到各个CPU上；连接数上限在这个模式下是近似的
+     */
+    void setCpuSteering(bool on) { cpuSteering_ = on; }
+    struct CpuSteeringStats
+    {
+        uint64_t connections; // 分流模式下accept的连接数
+        uint64_t cpuMatched;  // 其中收包CPU(SO_INCOMING_CPU)与所在loop绑定的CPU相同的连接数
+        double matchRatio() const { return connections > 0 ? static_cast<double>(cpuMatched) / connections : 0; }
+    };
+    // 可以在任意线程中调用
+    CpuSteeringStats cpuSteeringStats() const;
+
+    // 当前的连接数，可以在任意线程中调用
+    size_t numConnections() const { return numConnections_.load(std::memory_order_relaxed); }
 
     // 设置底层subloop的个数
     void setThreadNum(int numThreads);
@@ -47,26 +121,73 @@ public:
     void start();
 
 private:
+    using ConnectionMap = std::unordered_map<uint64_t, TcpConnectionPtr>;
+    // 每个subloop一份连接表，只在该loop线程中访问，连接的建立和关闭都不需要经过baseLoop
+    struct ConnectionShard
+    {
+        explicit ConnectionShard(EventLoop *ioLoop)
+            : loop(ioLoop), cpu(-1), steeredConnections(0), steeredCpuMatches(0) {}
+        EventLoop *loop;
+        ConnectionMap connections;
+        // 以下只在CPU分流模式下使用
+        std::unique_ptr<Acceptor> acceptor; // 该loop自己的监听socket
+        int cpu;                            // loop线程绑定的CPU
+        std::atomic<uint64_t> steeredConnections; // 只由该loop写入
+        std::atomic<uint64_t> steeredCpuMatches;
+    };
+    using ConnectionShardPtr = std::shared_ptr<ConnectionShard>;
+
     //根据轮询算法选择一个subLoop，唤醒subLoopb并把connfd封装成channel发送给subloop
     void newConnection(int sockfd, const InetAddress &peerAddr);
-    void removeConnection(const TcpConnectionPtr &conn);
-    void removeConnectionInLoop(const TcpConnectionPtr &conn);
+    // CPU分流模式下由各loop自己的Acceptor回调，连接直接留在这个loop
+    void newSteeredConnection(ConnectionShard *shard, int sockfd, const InetAddress &peerAddr);
+    TcpConnectionPtr createConnection(ConnectionShard *shard, int sockfd, const InetAddress &peerAddr);
+    void establishPending();
+    void establishInLoop(ConnectionShard *shard, const std::vector<TcpConnectionPtr> &conns);
+    // 在连接所在的subloop中调用
+    void removeConnection(ConnectionShard *shard, const TcpConnectionPtr &conn);
+    // 在每个Acceptor自己的loop中按当前的连接数决定是否暂停accept
+    void requestThrottleUpdate();
+    void updateThrottle(Acceptor *acceptor);
+    void startCpuSteering();
+    static void destroyConnections(const ConnectionShardPtr &shard);
 
-    using ConnectionMap = std::unordered_map<std::string, TcpConnectionPtr>;
     EventLoop *loop_; // baseLoop 用户自定义的loop
+    const InetAddress listenAddr_;
     const std::string ipPort_;
     const std::string name_;
+    const std::shared_ptr<const std::string> connNamePrefix_; // 连接名字的前缀"name-ip:port#"，后面是连接编号
     std::unique_ptr<Acceptor> acceptor_;              // 运行在mainLoop，主要任务就是监听连接事件
     std::shared_ptr<EventLoopThreadPool> threadPool_; // one loop per thread
 
     ConnectionCallback connectionCallback_;       // 有新连接时的回调
     MessageCallback messageCallback_;             // 有读写消息时的回调
     WriteCompleteCallback writeCompleteCallback_; // 消息发送完成以后的回调
+    HighWaterMarkCallback highWaterMarkCallback_;
+    size_t highWaterMark_;
+    size_t backpressureHighWaterMark_;
+    size_t backpressureLowWaterMark_;
 
     ThreadInitCallback threadInitCallback_; // loop线程初始化的回调
 
     std::atomic_int started_;
 
-    int nextConnId_;
-    ConnectionMap connections_; // 保存所有的连接
+    bool corkWrites_;
+    bool msgMore_;
+    std::shared_ptr<TlsContext> tlsContext_;
+    int latencySampleEvery_;
+    size_t maxConnections_;
+    SocketOptions socketOptions_;
+    int acceptBatchSize_;
+    double acceptRetryDelay_;
+    bool cpuSteering_;
+
+    std::atomic<uint64_t> nextConnId_; // CPU分流模式下由各个loop分配
+    std::atomic<size_t> numConnections_;
+    // 排队到baseLoop的回调只持有它的weak_ptr，用来判断TcpServer是否已经析构
+    std::shared_ptr<bool> alive_;
+    // start时按subloop建好，之后只读；每个shard里的连接表只在对应的subloop中访问
+    std::unordered_map<EventLoop *, ConnectionShardPtr> shards_;
+    // 本批accept到、还没有交给subloop的连接，按subloop分组
+    std::unordered_map<EventLoop *, std::vector<TcpConnectionPtr>> pendingEstablish_;
 };
\ No newline at end of file
@@ -0,0 +1,106 @@
+#include "ThreadPool.h"
+
+
+ThreadPool::ThreadPool(const std::string &nameArg)
+    : name_(nameArg),
+      maxQueueSize_(0),
+      running_(false)
+{
+}
+
+ThreadPool::~ThreadPool()
+{
+    if (running_)
+    {
+        stop();
+    }
+}
+
+void ThreadPool::start(int numThreads)
+{
+    running_ = true;
+    threads_.reserve(numThreads);
+    for (int i = 0; i < numThreads; ++i)
+    {
+        threads_.emplace_back(new Thread(std::bind(&ThreadPool::runInThread, this),
+                                         name_ + std::to_string(i)));
+        threads_[i]->start();
+    }
+}
+
+void ThreadPool::stop()
+{
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        running_ = false;
+        notEmpty_.notify_all();
+        notFull_.notify_all();
+    }
+    for (auto &thread : threads_)
+    {
+        thread->join();
+    }
+    threads_.clear();
+}
+
+size_t ThreadPool::queueSize() const
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    return queue_.size();
+}
+
+void ThreadPool::run(Task task)
+{
+    if (threads_.empty())
+    {
+        task();
+        return;
+    }
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (isFull() && running_)
+    {
+        notFull_.wait(lock);
+    }
+    if (!running_)
+    {
+        return;
+    }
+    queue_.push_back(std::move(task));
+    notEmpty_.notify_one();
+}
+
+bool ThreadPool::isFull() const
+{
+    return maxQueueSize_ > 0 && queue_.size() >= maxQueueSize_;
+}
+
+// 停止之后仍然把队列中剩下的任务取完
+bool ThreadPool::take(Task *task)
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (queue_.empty() && running_)
+    {
+        notEmpty_.wait(lock);
+    }
+    if (queue_.empty())
+    {
+        return false;
+    }
+    *task = std::move(queue_.front());
+    queue_.pop_front();
+    if (maxQueueSize_ > 0)
+    {
+        notFull_.notify_one();
+    }
+    return true;
+}
+
+void ThreadPool::runInThread()
+{
+    Task task;
+    while (take(&task))
+    {
+        task();
+        task = nullptr;
+    }
+}
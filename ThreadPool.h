@@ -0,0 +1,48 @@
+#pragma once
+
+#include "noncopyable.h"
+#include "Thread.h"
+
+#include <functional>
+#include <string>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+
+// 执行普通任务的线程池，用于把耗时的计算从IO线程(EventLoop)中移出去
+class ThreadPool : noncopyable
+{
+public:
+    using Task = std::function<void()>;
+
+    explicit ThreadPool(const std::string &nameArg = std::string("ThreadPool"));
+    ~ThreadPool();
+
+    // 队列中的任务数达到maxQueueSize时run会阻塞，0表示不限制，需要在start之前设置
+    void setMaxQueueSize(size_t maxSize) { maxQueueSize_ = maxSize; }
+    void start(int numThreads);
+    // 等队列中已有的任务执行完之后退出所有线程
+    void stop();
+
+    // numThreads为0时直接在调用线程中执行
+    void run(Task task);
+
+    const std::string &name() const { return name_; }
+    size_t queueSize() const;
+
+private:
+    bool isFull() const;
+    void runInThread();
+    bool take(Task *task);
+
+    mutable std::mutex mutex_;
+    std::condition_variable notEmpty_;
+    std::condition_variable notFull_;
+    std::string name_;
+    std::vector<std::unique_ptr<Thread>> threads_;
+    std::deque<Task> queue_;
+    size_t maxQueueSize_;
+    bool running_;
+};
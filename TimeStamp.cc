@@ -1,5 +1,7 @@
-
 #include <time.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
 
 #include "TimeStamp.h"
 
@@ -13,22 +15,71 @@ TimeStamp::TimeStamp(int64_t microSecondsSinceEpoch) : microSecondsSinceEpoch_(m
 
 TimeStamp TimeStamp::now()
 {
-    time_t ti = time(nullptr);
-    return TimeStamp(ti);
+    timespec ts;
+    ::clock_gettime(CLOCK_REALTIME, &ts);
+    return TimeStamp(static_cast<int64_t>(ts.tv_sec) * kMicroSecondsPerSecond + ts.tv_nsec / 1000);
 }
 
 std::string TimeStamp::toString() const
 {
-    char buf[128] = {0};
-    tm *tm_time = localtime(&microSecondsSinceEpoch_);
-    snprintf(buf, 128, "%4d/%02d/%02d %02d:%02d:%02d",
-             tm_time->tm_year + 1900,
-             tm_time->tm_mon + 1,
-             tm_time->tm_mday,
-             tm_time->tm_hour,
-             tm_time->tm_min,
-             tm_time->tm_sec);
-    return buf;
+    char buf[kFormattedLen + 1];
+    formatTo(buf);
+    return std::string(buf, kFormattedLen - 7); // 去掉".微秒"
+}
+
+std::string TimeStamp::toFormattedString(bool showMicroseconds) const
+{
+    if (!showMicroseconds)
+    {
+        return toString();
+    }
+    char buf[kFormattedLen + 1];
+    return std::string(buf, formatTo(buf));
+}
+
+// 写固定宽度的十进制数，value超出width位时只保留低位
+static void formatDigits(char *buf, int value, int width)
+{
+    for (int i = width - 1; i >= 0; --i)
+    {
+        buf[i] = static_cast<char>('0' + value % 10);
+        value /= 10;
+    }
+}
+
+size_t TimeStamp::formatTo(char *buf) const
+{
+    // localtime_r每次都要检查时区，同一秒内的日志直接复用上次格式化好的"年/月/日 时:分:秒"
+    static __thread time_t t_lastSecond = -1;
+    static __thread char t_time[19];
+
+    time_t seconds = secondsSinceEpoch();
+    if (seconds != t_lastSecond)
+    {
+        tm tmTime;
+        ::localtime_r(&seconds, &tmTime);
+        // 年份限制在0~9999，保证固定19个字符
+        int year = std::min(std::max(tmTime.tm_year + 1900, 0), 9999);
+        formatDigits(t_time, year, 4);
+        t_time[4] = '/';
+        formatDigits(t_time + 5, tmTime.tm_mon + 1, 2);
+        t_time[7] = '/';
+        formatDigits(t_time + 8, tmTime.tm_mday, 2);
+        t_time[10] = ' ';
+        formatDigits(t_time + 11, tmTime.tm_hour, 2);
+        t_time[13] = ':';
+        formatDigits(t_time + 14, tmTime.tm_min, 2);
+        t_time[16] = ':';
+        formatDigits(t_time + 17, tmTime.tm_sec, 2);
+        t_lastSecond = seconds;
+    }
+    ::memcpy(buf, t_time, sizeof t_time);
+    int micro = static_cast<int>(microSecondsSinceEpoch_ % kMicroSecondsPerSecond);
+    // 固定6位的微秒，手写比snprintf快
+    buf[19] = '.';
+    formatDigits(buf + 20, micro, 6);
+    buf[kFormattedLen] = '\0';
+    return kFormattedLen;
 }
 
 // #include <iostream>
@@ -36,4 +87,4 @@ std::string TimeStamp::toString() const
 // {
 //     std::cout << TimeStamp::now().toString() << std::endl;
 //     return 0;
-// }
\ No newline at end of file
+// }
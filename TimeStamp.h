@@ -1,16 +1,50 @@
 #pragma once
 
 #include <iostream>
+#include <string>
+#include <stdint.h>
+#include <time.h>
 
-// 时间类
+// 时间类，精度为微秒，取自CLOCK_REALTIME(通过vDSO读取，不进入内核)
 class TimeStamp
 {
 public:
     TimeStamp();
     explicit TimeStamp(int64_t microSecondsSinceEpoch); // 防止隐式转换
     static TimeStamp now();
+    // "年/月/日 时:分:秒"，本地时间
     std::string toString() const;
+    // 带微秒的"年/月/日 时:分:秒.微秒"
+    std::string toFormattedString(bool showMicroseconds = true) const;
+
+    // 与toFormattedString相同的格式写进buf(至少kFormattedLen+1字节)，返回长度；
+    // 秒以上的部分每个线程缓存一份，同一秒内只拷贝不重新格式化，用于每行日志的时间前缀
+    size_t formatTo(char *buf) const;
+    static const size_t kFormattedLen = 26;
+
+    bool valid() const { return microSecondsSinceEpoch_ > 0; }
+    int64_t microSecondsSinceEpoch() const { return microSecondsSinceEpoch_; }
+    time_t secondsSinceEpoch() const { return static_cast<time_t>(microSecondsSinceEpoch_ / kMicroSecondsPerSecond); }
+
+    static const int kMicroSecondsPerSecond = 1000 * 1000;
 
 private:
     int64_t microSecondsSinceEpoch_;
-};
\ No newline at end of file
+};
+
+inline bool operator<(TimeStamp lhs, TimeStamp rhs)
+{
+    return lhs.microSecondsSinceEpoch() < rhs.microSecondsSinceEpoch();
+}
+
+inline bool operator==(TimeStamp lhs, TimeStamp rhs)
+{
+    return lhs.microSecondsSinceEpoch() == rhs.microSecondsSinceEpoch();
+}
+
+// 两个时间点的差，单位秒
+inline double timeDifference(TimeStamp high, TimeStamp low)
+{
+    int64_t diff = high.microSecondsSinceEpoch() - low.microSecondsSinceEpoch();
+    return static_cast<double>(diff) / TimeStamp::kMicroSecondsPerSecond;
+}
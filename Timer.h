@@ -0,0 +1,46 @@
+#pragma once
+
+#include "noncopyable.h"
+
+#include <functional>
+#include <atomic>
+#include <utility>
+#include <stdint.h>
+
+// 定时器，到期时间是CLOCK_MONOTONIC上的微秒数，不受系统时间调整的影响
+class Timer : noncopyable
+{
+public:
+    using TimerCallback = std::function<void()>;
+
+    Timer(TimerCallback cb, int64_t when, double interval)
+        : callback_(std::move(cb)),
+          expiration_(when),
+          interval_(interval),
+          repeat_(interval > 0.0),
+          sequence_(++numCreated_)
+    {
+    }
+
+    void run() const { callback_(); }
+
+    int64_t expiration() const { return expiration_; }
+    bool repeat() const { return repeat_; }
+    int64_t sequence() const { return sequence_; }
+
+    // 重复定时器在now的基础上推迟一个周期
+    void restart(int64_t now) { expiration_ = now + static_cast<int64_t>(interval_ * kMicroSecondsPerSecond); }
+
+    static const int64_t kMicroSecondsPerSecond = 1000 * 1000;
+    // 当前的CLOCK_MONOTONIC时间，单位微秒
+    static int64_t now();
+
+private:
+    const TimerCallback callback_;
+    int64_t expiration_;
+    const double interval_; // 重复周期，单位秒，0表示只执行一次
+    const bool repeat_;
+    const int64_t sequence_; // 全局递增，与Timer*一起唯一标识一个定时器
+
+    static std::atomic<int64_t> numCreated_;
+};
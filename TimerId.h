@@ -0,0 +1,21 @@
+#pragma once
+
+#include <stdint.h>
+
+class Timer;
+
+// 用于取消定时器的句柄，sequence用来区分地址被复用的不同Timer对象
+class TimerId
+{
+public:
+    TimerId() : timer_(nullptr), sequence_(0) {}
+    TimerId(Timer *timer, int64_t seq) : timer_(timer), sequence_(seq) {}
+
+    bool valid() const { return timer_ != nullptr; }
+
+private:
+    friend class TimerQueue;
+
+    Timer *timer_;
+    int64_t sequence_;
+};
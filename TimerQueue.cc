@@ -0,0 +1,179 @@
+#include "TimerQueue.h"
+#include "EventLoop.h"
+#include "Logger.h"
+
+#include <sys/timerfd.h>
+#include <unistd.h>
+#include <string.h>
+#include <time.h>
+#include <algorithm>
+#include <iterator>
+
+std::atomic<int64_t> Timer::numCreated_(0);
+const int64_t Timer::kMicroSecondsPerSecond;
+
+int64_t Timer::now()
+{
+    timespec ts;
+    ::clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * kMicroSecondsPerSecond + ts.tv_nsec / 1000;
+}
+
+static int createTimerfd()
+{
+    int timerfd = ::timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (timerfd < 0)
+    {
+        LOG_FATAL("%s:%s:%d timerfd_create error:%d \n", __FILE__, __FUNCTION__, __LINE__, errno);
+    }
+    return timerfd;
+}
+
+// 把timerfd设置为在when到期，when已经过去时至少等待100微秒
+static void resetTimerfd(int timerfd, int64_t when)
+{
+    int64_t delay = when - Timer::now();
+    if (delay < 100)
+    {
+        delay = 100;
+    }
+    itimerspec newValue;
+    ::memset(&newValue, 0, sizeof newValue);
+    newValue.it_value.tv_sec = static_cast<time_t>(delay / Timer::kMicroSecondsPerSecond);
+    newValue.it_value.tv_nsec = static_cast<long>((delay % Timer::kMicroSecondsPerSecond) * 1000);
+    if (::timerfd_settime(timerfd, 0, &newValue, nullptr) < 0)
+    {
+        LOG_ERROR("timerfd_settime error:%d \n", errno);
+    }
+}
+
+TimerQueue::TimerQueue(EventLoop *loop)
+    : loop_(loop),
+      timerfd_(createTimerfd()),
+      timerfdChannel_(loop, timerfd_),
+      callingExpiredTimers_(false)
+{
+    timerfdChannel_.setReadCallback(std::bind(&TimerQueue::handleRead, this));
+    timerfdChannel_.enableReading();
+}
+
+TimerQueue::~TimerQueue()
+{
+    timerfdChannel_.disableAll();
+    timerfdChannel_.remove();
+    ::close(timerfd_);
+    for (const Entry &timer : timers_)
+    {
+        delete timer.second;
+    }
+}
+
+TimerId TimerQueue::addTimer(Timer::TimerCallback cb, int64_t when, double interval)
+{
+    Timer *timer = new Timer(std::move(cb), when, interval);
+    loop_->runInLoop(std::bind(&TimerQueue::addTimerInLoop, this, timer));
+    return TimerId(timer, timer->sequence());
+}
+
+void TimerQueue::cancel(TimerId timerId)
+{
+    loop_->runInLoop(std::bind(&TimerQueue::cancelInLoop, this, timerId));
+}
+
+void TimerQueue::addTimerInLoop(Timer *timer)
+{
+    if (insert(timer))
+    {
+        resetTimerfd(timerfd_, timer->expiration());
+    }
+}
+
+void TimerQueue::cancelInLoop(TimerId timerId)
+{
+    ActiveTimer timer(timerId.timer_, timerId.sequence_);
+    ActiveTimerSet::iterator it = activeTimers_.find(timer);
+    if (it != activeTimers_.end())
+    {
+        timers_.erase(Entry(it->first->expiration(), it->first));
+        delete it->first;
+        activeTimers_.erase(it);
+    }
+    else if (callingExpiredTimers_)
+    {
+        // 正在执行的定时器在自己的回调里取消自己
+        cancelingTimers_.insert(timer);
+    }
+}
+
+void TimerQueue::handleRead()
+{
+    int64_t now = Timer::now();
+    uint64_t howmany;
+    ssize_t n = ::read(timerfd_, &howmany, sizeof howmany);
+    if (n != sizeof howmany)
+    {
+        LOG_ERROR("TimerQueue::handleRead() reads %ld bytes instead of 8 \n", n);
+    }
+
+    std::vector<Entry> expired = getExpired(now);
+    callingExpiredTimers_ = true;
+    cancelingTimers_.clear();
+    for (const Entry &entry : expired)
+    {
+        entry.second->run();
+    }
+    callingExpiredTimers_ = false;
+
+    reset(expired, now);
+}
+
+std::vector<TimerQueue::Entry> TimerQueue::getExpired(int64_t now)
+{
+    std::vector<Entry> expired;
+    Entry sentry(now, reinterpret_cast<Timer *>(UINTPTR_MAX));
+    TimerList::iterator end = timers_.lower_bound(sentry);
+    std::copy(timers_.begin(), end, std::back_inserter(expired));
+    timers_.erase(timers_.begin(), end);
+
+    for (const Entry &entry : expired)
+    {
+        activeTimers_.erase(ActiveTimer(entry.second, entry.second->sequence()));
+    }
+    return expired;
+}
+
+void TimerQueue::reset(const std::vector<Entry> &expired, int64_t now)
+{
+    for (const Entry &entry : expired)
+    {
+        ActiveTimer timer(entry.second, entry.second->sequence());
+        if (entry.second->repeat() && cancelingTimers_.find(timer) == cancelingTimers_.end())
+        {
+            entry.second->restart(now);
+            insert(entry.second);
+        }
+        else
+        {
+            delete entry.second;
+        }
+    }
+
+    if (!timers_.empty())
+    {
+        resetTimerfd(timerfd_, timers_.begin()->second->expiration());
+    }
+}
+
+bool TimerQueue::insert(Timer *timer)
+{
+    bool earliestChanged = false;
+    int64_t when = timer->expiration();
+    TimerList::iterator it = timers_.begin();
+    if (it == timers_.end() || when < it->first)
+    {
+        earliestChanged = true;
+    }
+    timers_.insert(Entry(when, timer));
+    activeTimers_.insert(ActiveTimer(timer, timer->sequence()));
+    return earliestChanged;
+}
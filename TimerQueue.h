@@ -0,0 +1,51 @@
+#pragma once
+
+#include "noncopyable.h"
+#include "Channel.h"
+#include "Timer.h"
+#include "TimerId.h"
+
+#include <set>
+#include <vector>
+#include <utility>
+
+class EventLoop;
+
+/**************************
+ * 每个EventLoop一个定时器队列，所有定时器共用一个timerfd，
+ * timerfd总是设置为最早到期的定时器的时间，到期后由loop线程执行回调
+ **************************/
+class TimerQueue : noncopyable
+{
+public:
+    explicit TimerQueue(EventLoop *loop);
+    ~TimerQueue();
+
+    // 添加和取消定时器都可以在任意线程中调用
+    TimerId addTimer(Timer::TimerCallback cb, int64_t when, double interval);
+    void cancel(TimerId timerId);
+
+private:
+    using Entry = std::pair<int64_t, Timer *>;        // 按到期时间排序
+    using TimerList = std::set<Entry>;
+    using ActiveTimer = std::pair<Timer *, int64_t>;  // 按Timer*查找，用于取消
+    using ActiveTimerSet = std::set<ActiveTimer>;
+
+    void addTimerInLoop(Timer *timer);
+    void cancelInLoop(TimerId timerId);
+    void handleRead();
+
+    std::vector<Entry> getExpired(int64_t now);
+    void reset(const std::vector<Entry> &expired, int64_t now);
+    // 返回timer是否成为了最早到期的定时器
+    bool insert(Timer *timer);
+
+    EventLoop *loop_;
+    const int timerfd_;
+    Channel timerfdChannel_;
+    TimerList timers_;
+
+    ActiveTimerSet activeTimers_;
+    bool callingExpiredTimers_;
+    ActiveTimerSet cancelingTimers_; // 回调执行期间被取消的重复定时器，不再重新加入队列
+};
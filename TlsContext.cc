@@ -0,0 +1,92 @@
+#include "TlsContext.h"
+#include "Logger.h"
+
+#include <openssl/ssl.h>
+#include <openssl/err.h>
+
+TlsContext::TlsContext(Mode mode)
+    : mode_(mode),
+      ctx_(::SSL_CTX_new(mode == kServer ? TLS_server_method() : TLS_client_method())),
+      kernelTls_(false)
+{
+    if (ctx_ == nullptr)
+    {
+        LOG_FATAL("%s:%s:%d SSL_CTX_new failed: %s \n", __FILE__, __FUNCTION__, __LINE__, lastError().c_str());
+    }
+    ::SSL_CTX_set_min_proto_version(ctx_, TLS1_2_VERSION);
+    // 非阻塞写返回WANT_WRITE之后，重试时数据可能已经追加到缓冲区后面，地址也可能变了
+    ::SSL_CTX_set_mode(ctx_, SSL_MODE_ENABLE_PARTIAL_WRITE | SSL_MODE_ACCEPT_MOVING_WRITE_BUFFER);
+    ::SSL_CTX_set_mode(ctx_, SSL_MODE_RELEASE_BUFFERS); // 空闲连接不保留读写缓冲区
+    if (mode_ == kClient)
+    {
+        setVerifyPeer(true);
+    }
+}
+
+TlsContext::~TlsContext()
+{
+    ::SSL_CTX_free(ctx_);
+}
+
+bool TlsContext::useCertificateFile(const std::string &certFile, const std::string &keyFile)
+{
+    if (::SSL_CTX_use_certificate_chain_file(ctx_, certFile.c_str()) != 1 ||
+        ::SSL_CTX_use_PrivateKey_file(ctx_, keyFile.c_str(), SSL_FILETYPE_PEM) != 1 ||
+        ::SSL_CTX_check_private_key(ctx_) != 1)
+    {
+        LOG_ERROR("TlsContext::useCertificateFile %s %s failed: %s \n",
+                  certFile.c_str(), keyFile.c_str(), lastError().c_str());
+        return false;
+    }
+    return true;
+}
+
+bool TlsContext::setVerifyPeer(bool on, const std::string &caFile)
+{
+    if (!on)
+    {
+        ::SSL_CTX_set_verify(ctx_, SSL_VERIFY_NONE, nullptr);
+        return true;
+    }
+    int ok = caFile.empty() ? ::SSL_CTX_set_default_verify_paths(ctx_)
+                            : ::SSL_CTX_load_verify_locations(ctx_, caFile.c_str(), nullptr);
+    if (ok != 1)
+    {
+        LOG_ERROR("TlsContext::setVerifyPeer load %s failed: %s \n", caFile.c_str(), lastError().c_str());
+        return false;
+    }
+    ::SSL_CTX_set_verify(ctx_, SSL_VERIFY_PEER, nullptr);
+    return true;
+}
+
+void TlsContext::setKernelTls(bool on)
+{
+#ifdef SSL_OP_ENABLE_KTLS
+    if (on)
+    {
+        ::SSL_CTX_set_options(ctx_, SSL_OP_ENABLE_KTLS);
+    }
+    else
+    {
+        ::SSL_CTX_clear_options(ctx_, SSL_OP_ENABLE_KTLS);
+    }
+    kernelTls_ = on;
+#else
+    if (on)
+    {
+        LOG_ERROR("TlsContext::setKernelTls OpenSSL built without kTLS \n");
+    }
+#endif
+}
+
+std::string TlsContext::lastError()
+{
+    unsigned long err = ::ERR_get_error();
+    char buf[256] = {0};
+    if (err != 0)
+    {
+        ::ERR_error_string_n(err, buf, sizeof buf);
+    }
+    ::ERR_clear_error();
+    return buf;
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include "noncopyable.h"
+
+#include <string>
+
+typedef struct ssl_ctx_st SSL_CTX;
+
+/****************
+ * OpenSSL的SSL_CTX封装，一个TcpServer/TcpClient共用一个，之后建立的连接都使用它做TLS握手
+ * 开启kernelTls时带上SSL_OP_ENABLE_KTLS，握手完成后OpenSSL把密钥装进内核(TLS_TX/TLS_RX)，
+ * 之后发送不再经过用户态加密，TcpConnection的write/sendfile路径可以原样使用；
+ * 内核没有tls模块或者协商出的套件内核不支持时自动退回用户态加密
+ * *************/
+class TlsContext : noncopyable
+{
+public:
+    enum Mode
+    {
+        kServer,
+        kClient,
+    };
+
+    explicit TlsContext(Mode mode);
+    ~TlsContext();
+
+    // PEM格式的证书链和私钥，服务器必须设置
+    bool useCertificateFile(const std::string &certFile, const std::string &keyFile);
+    // 客户端默认用系统的CA校验服务器证书，caFile为空时使用系统默认路径；on为false时不校验(只用于测试)
+    bool setVerifyPeer(bool on, const std::string &caFile = std::string());
+    void setKernelTls(bool on);
+    bool kernelTls() const { return kernelTls_; }
+
+    Mode mode() const { return mode_; }
+    SSL_CTX *get() const { return ctx_; }
+
+    // OpenSSL错误队列中最近的一条错误，同时清空错误队列
+    static std::string lastError();
+
+private:
+    const Mode mode_;
+    SSL_CTX *ctx_;
+    bool kernelTls_;
+};
@@ -0,0 +1,161 @@
+#include "TlsSession.h"
+#include "TlsContext.h"
+#include "Buffer.h"
+#include "Logger.h"
+
+#include <errno.h>
+#include <openssl/ssl.h>
+#include <openssl/err.h>
+#include <algorithm>
+#include <stdint.h>
+
+// 一个TLS记录最多16K明文，每次至少留出这么多空间，避免SSL_read把一个记录拆成多次拷贝
+static const size_t kRecordSize = 16 * 1024;
+
+TlsSession::TlsSession(const std::shared_ptr<TlsContext> &context, int sockfd)
+    : context_(context),
+      ssl_(::SSL_new(context->get())),
+      established_(false),
+      kernelSend_(false),
+      kernelRecv_(false)
+{
+    if (ssl_ == nullptr)
+    {
+        LOG_FATAL("%s:%s:%d SSL_new failed: %s \n", __FILE__, __FUNCTION__, __LINE__,
+                  TlsContext::lastError().c_str());
+    }
+    // socket BIO直接读写fd，kTLS只能在socket BIO上开启
+    ::SSL_set_fd(ssl_, sockfd);
+    if (context->mode() == TlsContext::kServer)
+    {
+        ::SSL_set_accept_state(ssl_);
+    }
+    else
+    {
+        ::SSL_set_connect_state(ssl_);
+    }
+}
+
+TlsSession::~TlsSession()
+{
+    ::SSL_free(ssl_);
+}
+
+TlsSession::HandshakeResult TlsSession::handshake()
+{
+    int ret = ::SSL_do_handshake(ssl_);
+    if (ret == 1)
+    {
+        established_ = true;
+        kernelSend_ = BIO_get_ktls_send(::SSL_get_wbio(ssl_));
+        kernelRecv_ = BIO_get_ktls_recv(::SSL_get_rbio(ssl_));
+        return kDone;
+    }
+    switch (::SSL_get_error(ssl_, ret))
+    {
+    case SSL_ERROR_WANT_READ:
+        return kWantRead;
+    case SSL_ERROR_WANT_WRITE:
+        return kWantWrite;
+    default:
+        LOG_ERROR("TlsSession::handshake fd=%d failed: %s errno=%d \n",
+                  ::SSL_get_fd(ssl_), TlsContext::lastError().c_str(), errno);
+        return kFailed;
+    }
+}
+
+// 把SSL_read/SSL_write的结果转换成系统调用的约定
+ssize_t TlsSession::checkResult(int ret)
+{
+    if (ret > 0)
+    {
+        return ret;
+    }
+    switch (::SSL_get_error(ssl_, ret))
+    {
+    case SSL_ERROR_WANT_READ:
+    case SSL_ERROR_WANT_WRITE:
+        errno = EAGAIN;
+        return -1;
+    case SSL_ERROR_ZERO_RETURN: // 收到close_notify
+        return 0;
+    case SSL_ERROR_SYSCALL:
+        ::ERR_clear_error();
+        if (errno == 0) // 对端没有发close_notify直接关闭了连接
+        {
+            return 0;
+        }
+        return -1;
+    default:
+        LOG_ERROR("TlsSession fd=%d error: %s \n", ::SSL_get_fd(ssl_), TlsContext::lastError().c_str());
+        errno = EPROTO;
+        return -1;
+    }
+}
+
+ssize_t TlsSession::read(Buffer *buf, int *saveErrno)
+{
+    // SSL内部可能已经缓存了解密好的数据，epoll不会再通知，所以要一直读到WANT_READ
+    ssize_t total = 0;
+    while (true)
+    {
+        buf->ensureWriteAbleBytes(kRecordSize);
+        errno = 0;
+        ssize_t n = checkResult(::SSL_read(ssl_, buf->beginWrite(), static_cast<int>(buf->writeAbleBytes())));
+        if (n <= 0)
+        {
+            if (total > 0)
+            {
+                return total; // 关闭或者出错留到下一次可读事件再报告
+            }
+            *saveErrno = errno;
+            return n;
+        }
+        buf->hasWritten(n);
+        total += n;
+    }
+}
+
+ssize_t TlsSession::write(const void *data, size_t len)
+{
+    if (len == 0)
+    {
+        return 0;
+    }
+    errno = 0;
+    return checkResult(::SSL_write(ssl_, data, static_cast<int>(std::min(len, static_cast<size_t>(INT32_MAX)))));
+}
+
+ssize_t TlsSession::writev(const iovec *vec, int count)
+{
+    ssize_t total = 0;
+    for (int i = 0; i < count; ++i)
+    {
+        ssize_t n = write(vec[i].iov_base, vec[i].iov_len);
+        if (n < 0)
+        {
+            return total > 0 ? total : n;
+        }
+        total += n;
+        if (static_cast<size_t>(n) < vec[i].iov_len)
+        {
+            break;
+        }
+    }
+    return total;
+}
+
+void TlsSession::shutdown()
+{
+    if (established_)
+    {
+        ::SSL_shutdown(ssl_);
+        ::ERR_clear_error();
+    }
+}
+
+std::string TlsSession::cipher() const
+{
+    const char *name = ::SSL_get_cipher_name(ssl_);
+    return name ? name : "";
+}
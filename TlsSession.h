@@ -0,0 +1,57 @@
+#pragma once
+
+#include "noncopyable.h"
+
+#include <memory>
+#include <string>
+#include <sys/types.h>
+#include <sys/uio.h>
+
+typedef struct ssl_st SSL;
+class TlsContext;
+class Buffer;
+
+/****************
+ * 一个连接上的TLS状态，直接在非阻塞的socket fd上工作，由TcpConnection在Channel的读写回调中驱动:
+ * 握手阶段handshake返回需要等待的事件；握手完成后read/write在用户态加解密，
+ * kernelSend()为true时内核已经接管了发送方向的加密，TcpConnection直接write/sendfile即可
+ * read/write的返回值和errno与系统调用一致，数据不够一个完整记录或者发送缓冲区满时返回-1且errno为EAGAIN
+ * *************/
+class TlsSession : noncopyable
+{
+public:
+    enum HandshakeResult
+    {
+        kDone,
+        kWantRead,
+        kWantWrite,
+        kFailed,
+    };
+
+    TlsSession(const std::shared_ptr<TlsContext> &context, int sockfd);
+    ~TlsSession();
+
+    HandshakeResult handshake();
+    bool established() const { return established_; }
+    bool kernelSend() const { return kernelSend_; }
+    bool kernelRecv() const { return kernelRecv_; }
+
+    // 读出当前能解密的全部数据追加到buf，返回0表示对端关闭
+    ssize_t read(Buffer *buf, int *saveErrno);
+    ssize_t write(const void *data, size_t len);
+    // 依次写入各块，遇到写不完的块就返回已写入的总字节数
+    ssize_t writev(const iovec *vec, int count);
+    // 发送close_notify，不等待对端的回应
+    void shutdown();
+
+    std::string cipher() const;
+
+private:
+    ssize_t checkResult(int ret);
+
+    std::shared_ptr<TlsContext> context_; // SSL对象引用着SSL_CTX，要比它先释放
+    SSL *ssl_;
+    bool established_;
+    bool kernelSend_;
+    bool kernelRecv_;
+};
@@ -0,0 +1,62 @@
+#include "UdpServer.h"
+#include "EventLoop.h"
+#include "Logger.h"
+
+#include <future>
+
+UdpServer::UdpServer(EventLoop *loop, const InetAddress &bindAddr, const std::string &nameArg,
+                     const UdpSocket::Options &options)
+    : loop_(loop),
+      bindAddr_(bindAddr),
+      name_(nameArg),
+      options_(options),
+      threadPool_(new EventLoopThreadPool(loop, nameArg)),
+      started_(0)
+{
+}
+
+UdpServer::~UdpServer()
+{
+    // socket的Channel只能在所属的loop线程中注销，等它完成之后再析构线程池
+    for (std::unique_ptr<UdpSocket> &socket : sockets_)
+    {
+        EventLoop *ioLoop = socket->getLoop();
+        if (ioLoop->isInLoopThread())
+        {
+            socket.reset();
+            continue;
+        }
+        std::promise<void> done;
+        UdpSocket *raw = socket.release();
+        ioLoop->runInLoop([raw, &done]()
+                          {
+                              delete raw;
+                              done.set_value();
+                          });
+        done.get_future().wait();
+    }
+}
+
+void UdpServer::start()
+{
+    if (started_++ != 0)
+    {
+        return;
+    }
+    threadPool_->start(threadInitCallback_);
+
+    std::vector<EventLoop *> loops = threadPool_->getAllLoops();
+    UdpSocket::Options options = options_;
+    options.reusePort = options_.reusePort || loops.size() > 1;
+    for (EventLoop *ioLoop : loops)
+    {
+        // 在这里创建并绑定，保证start返回时所有socket都已经在监听端口上
+        std::unique_ptr<UdpSocket> socket(new UdpSocket(ioLoop, bindAddr_, options));
+        socket->setBatchCallback(batchCallback_);
+        ioLoop->runInLoop(std::bind(&UdpSocket::start, socket.get()));
+        sockets_.push_back(std::move(socket));
+    }
+    LOG_INFO("UdpServer [%s] started on %s with %zu sockets, gro=%d gso=%d \n",
+             name_.c_str(), bindAddr_.toIpPort().c_str(), sockets_.size(),
+             sockets_[0]->gro(), sockets_[0]->gso());
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include "noncopyable.h"
+#include "InetAddress.h"
+#include "UdpSocket.h"
+#include "EventLoopThreadPool.h"
+
+#include <string>
+#include <memory>
+#include <vector>
+#include <atomic>
+
+class EventLoop;
+
+/****************
+ * 多线程UDP服务器
+ * 每个loop线程上一个UdpSocket，开启SO_REUSEPORT绑定同一个地址，由内核把不同的流分发到不同的socket，
+ * 各loop之间没有任何共享状态；只有一个loop时不需要reusePort
+ * 批量回调在对应socket所属的loop线程中执行，回复直接用回调参数里的socket->sendTo
+ * *************/
+class UdpServer : noncopyable
+{
+public:
+    using ThreadInitCallback = std::function<void(EventLoop *)>;
+
+    UdpServer(EventLoop *loop, const InetAddress &bindAddr, const std::string &nameArg,
+              const UdpSocket::Options &options = UdpSocket::Options());
+    ~UdpServer();
+
+    void setThreadInitCallback(const ThreadInitCallback &cb) { threadInitCallback_ = cb; }
+    void setBatchCallback(const UdpSocket::BatchCallback &cb) { batchCallback_ = cb; }
+    // 设置底层subloop的个数，为0时只在baseLoop上收发
+    void setThreadNum(int numThreads) { threadPool_->setThreadNum(numThreads); }
+
+    void start();
+
+    const std::string &name() const { return name_; }
+    // start之后才有，用于读取统计
+    const std::vector<std::unique_ptr<UdpSocket>> &sockets() const { return sockets_; }
+
+private:
+    EventLoop *loop_;
+    const InetAddress bindAddr_;
+    const std::string name_;
+    UdpSocket::Options options_;
+    std::unique_ptr<EventLoopThreadPool> threadPool_;
+    UdpSocket::BatchCallback batchCallback_;
+    ThreadInitCallback threadInitCallback_;
+    std::atomic_int started_;
+    std::vector<std::unique_ptr<UdpSocket>> sockets_;
+};
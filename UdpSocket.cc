@@ -0,0 +1,320 @@
+#include "UdpSocket.h"
+#include "EventLoop.h"
+#include "Logger.h"
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <netinet/udp.h>
+#include <algorithm>
+
+#ifndef SOL_UDP
+#define SOL_UDP 17
+#endif
+#ifndef UDP_SEGMENT
+#define UDP_SEGMENT 103
+#endif
+#ifndef UDP_GRO
+#define UDP_GRO 104
+#endif
+
+static const size_t kGroSlotSize = 65536;        // GRO合并之后的数据报最大64K
+static const size_t kControlLen = CMSG_SPACE(sizeof(int));
+static const int kMaxBatchesPerRead = 16;         // 一次可读事件最多收这么多批，避免饿死同一个loop上的其他fd
+static const size_t kMaxGsoSegments = 64;         // 内核UDP_MAX_SEGMENTS
+static const size_t kMaxGsoBytes = 65507;         // IPv4上UDP负载的上限
+static const size_t kMaxSendBatch = 1024;         // sendmmsg的vlen上限UIO_MAXIOV
+
+static int createUdpSocket()
+{
+    int sockfd = ::socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, IPPROTO_UDP);
+    if (sockfd < 0)
+    {
+        LOG_FATAL("%s:%s:%d udp socket create err:%d \n", __FILE__, __FUNCTION__, __LINE__, errno);
+    }
+    return sockfd;
+}
+
+UdpSocket::UdpSocket(EventLoop *loop, const InetAddress &bindAddr, const Options &options)
+    : loop_(loop),
+      socket_(createUdpSocket()),
+      channel_(loop, socket_.fd()),
+      batchSize_(std::max<size_t>(1, options.batchSize)),
+      slotSize_(options.gro ? kGroSlotSize : options.maxDatagramSize),
+      gro_(false),
+      gso_(false),
+      flushQueued_(false),
+      alive_(std::make_shared<bool>(true)),
+      receivedPackets_(0),
+      receivedBatches_(0),
+      sentPackets_(0),
+      sendDrops_(0),
+      truncated_(0)
+{
+    socket_.setReuseAddr(true);
+    if (options.reusePort)
+    {
+        socket_.setReusePort(true);
+    }
+    socket_.bindAddress(bindAddr);
+
+    int on = 1;
+    if (options.gro)
+    {
+        gro_ = ::setsockopt(socket_.fd(), SOL_UDP, UDP_GRO, &on, sizeof on) == 0;
+        if (!gro_)
+        {
+            LOG_ERROR("UdpSocket UDP_GRO not supported, errno=%d \n", errno);
+        }
+    }
+    if (options.gso)
+    {
+        // 段长为0的socket级设置不改变任何行为，只用来探测内核是否支持
+        int zero = 0;
+        gso_ = ::setsockopt(socket_.fd(), SOL_UDP, UDP_SEGMENT, &zero, sizeof zero) == 0;
+        if (!gso_)
+        {
+            LOG_ERROR("UdpSocket UDP_SEGMENT not supported, errno=%d \n", errno);
+        }
+    }
+
+    recvArena_.resize(batchSize_ * slotSize_);
+    recvMsgs_.resize(batchSize_);
+    recvIovecs_.resize(batchSize_);
+    recvAddrs_.resize(batchSize_);
+    recvControl_.resize(batchSize_ * kControlLen);
+    datagrams_.reserve(batchSize_);
+    for (size_t i = 0; i < batchSize_; ++i)
+    {
+        recvIovecs_[i].iov_base = &recvArena_[i * slotSize_];
+        recvIovecs_[i].iov_len = slotSize_;
+        msghdr &hdr = recvMsgs_[i].msg_hdr;
+        ::memset(&hdr, 0, sizeof hdr);
+        hdr.msg_iov = &recvIovecs_[i];
+        hdr.msg_iovlen = 1;
+        hdr.msg_name = &recvAddrs_[i];
+    }
+
+    channel_.setReadCallback(std::bind(&UdpSocket::handleRead, this, std::placeholders::_1));
+}
+
+UdpSocket::~UdpSocket()
+{
+    // 本轮已经sendTo的数据在注销之前发出去
+    if (flushQueued_)
+    {
+        flushSends();
+    }
+    if (!channel_.isNoneEvent())
+    {
+        channel_.disableAll();
+    }
+    channel_.remove();
+}
+
+void UdpSocket::start()
+{
+    channel_.enableReading();
+}
+
+void UdpSocket::handleRead(TimeStamp receiveTime)
+{
+    for (int round = 0; round < kMaxBatchesPerRead; ++round)
+    {
+        // 内核会改写这两个长度，每次都要重置
+        for (size_t i = 0; i < batchSize_; ++i)
+        {
+            msghdr &hdr = recvMsgs_[i].msg_hdr;
+            hdr.msg_namelen = sizeof(sockaddr_in);
+            if (gro_)
+            {
+                hdr.msg_control = &recvControl_[i * kControlLen];
+                hdr.msg_controllen = kControlLen;
+            }
+        }
+        int n = ::recvmmsg(socket_.fd(), recvMsgs_.data(), static_cast<unsigned int>(batchSize_), 0, nullptr);
+        if (n <= 0)
+        {
+            if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+            {
+                LOG_ERROR("UdpSocket::handleRead recvmmsg errno=%d \n", errno);
+            }
+            break;
+        }
+
+        datagrams_.clear();
+        for (int i = 0; i < n; ++i)
+        {
+            const msghdr &hdr = recvMsgs_[i].msg_hdr;
+            if (hdr.msg_flags & MSG_TRUNC)
+            {
+                truncated_.fetch_add(1, std::memory_order_relaxed);
+                continue;
+            }
+            const char *data = &recvArena_[i * slotSize_];
+            size_t len = recvMsgs_[i].msg_len;
+            InetAddress peer(recvAddrs_[i]);
+
+            size_t segment = len;
+            if (gro_)
+            {
+                for (cmsghdr *cmsg = CMSG_FIRSTHDR(&hdr); cmsg != nullptr;
+                     cmsg = CMSG_NXTHDR(const_cast<msghdr *>(&hdr), cmsg))
+                {
+                    if (cmsg->cmsg_level == SOL_UDP && cmsg->cmsg_type == UDP_GRO)
+                    {
+                        int gsoSize;
+                        ::memcpy(&gsoSize, CMSG_DATA(cmsg), sizeof gsoSize);
+                        if (gsoSize > 0)
+                        {
+                            segment = gsoSize;
+                        }
+                    }
+                }
+            }
+            // 合并过的数据报按段长拆开，最后一段可能较短
+            for (size_t off = 0; off < len; off += segment)
+            {
+                Datagram datagram = {data + off, std::min(segment, len - off), peer};
+                datagrams_.push_back(datagram);
+            }
+            if (len == 0)
+            {
+                Datagram datagram = {data, 0, peer};
+                datagrams_.push_back(datagram);
+            }
+        }
+
+        receivedBatches_.fetch_add(1, std::memory_order_relaxed);
+        receivedPackets_.fetch_add(datagrams_.size(), std::memory_order_relaxed);
+        if (batchCallback_ && !datagrams_.empty())
+        {
+            batchCallback_(this, datagrams_.data(), datagrams_.size(), receiveTime);
+        }
+        if (static_cast<size_t>(n) < batchSize_)
+        {
+            break; // 已经收空了
+        }
+    }
+}
+
+void UdpSocket::sendTo(const InetAddress &peer, const char *data, size_t len)
+{
+    Outgoing out;
+    out.offset = sendArena_.size();
+    out.len = len;
+    out.peer = *peer.getSockAddr();
+    sendArena_.insert(sendArena_.end(), data, data + len);
+    outgoing_.push_back(out);
+    if (!flushQueued_)
+    {
+        flushQueued_ = true;
+        std::weak_ptr<bool> alive(alive_);
+        loop_->runAtIterationEnd([this, alive]()
+                                 {
+                                     if (alive.lock())
+                                     {
+                                         flushSends();
+                                     }
+                                 });
+    }
+}
+
+static bool samePeer(const sockaddr_in &a, const sockaddr_in &b)
+{
+    return a.sin_port == b.sin_port && a.sin_addr.s_addr == b.sin_addr.s_addr;
+}
+
+void UdpSocket::flushSends()
+{
+    flushQueued_ = false;
+    const size_t count = outgoing_.size();
+    sendMsgs_.resize(std::min(count, kMaxSendBatch));
+    sendIovecs_.resize(sendMsgs_.size());
+    sendControl_.resize(sendMsgs_.size() * kControlLen);
+    sendFirstOfMsg_.reserve(sendMsgs_.size() + 1);
+
+    size_t next = 0; // 下一个待打包的数据报
+    while (next < count)
+    {
+        // 打包一批消息，每条消息是一个数据报或者一组GSO分段
+        size_t msgs = 0;
+        sendFirstOfMsg_.clear();
+        while (next < count && msgs < sendMsgs_.size())
+        {
+            const Outgoing &first = outgoing_[next];
+            size_t end = next + 1;
+            size_t bytes = first.len;
+            if (gso_ && first.len > 0)
+            {
+                // 连续、等长(最后一个可以更短)、发往同一对端的数据报在发送区中是相邻的，合成一个分段消息
+                while (end < count && end - next < kMaxGsoSegments &&
+                       samePeer(outgoing_[end].peer, first.peer) &&
+                       outgoing_[end].len <= first.len && outgoing_[end].len > 0 &&
+                       bytes + outgoing_[end].len <= kMaxGsoBytes &&
+                       outgoing_[end - 1].len == first.len)
+                {
+                    bytes += outgoing_[end].len;
+                    ++end;
+                }
+            }
+
+            mmsghdr &m = sendMsgs_[msgs];
+            ::memset(&m, 0, sizeof m);
+            sendIovecs_[msgs].iov_base = &sendArena_[first.offset];
+            sendIovecs_[msgs].iov_len = bytes;
+            m.msg_hdr.msg_iov = &sendIovecs_[msgs];
+            m.msg_hdr.msg_iovlen = 1;
+            m.msg_hdr.msg_name = const_cast<sockaddr_in *>(&first.peer);
+            m.msg_hdr.msg_namelen = sizeof(sockaddr_in);
+            if (end - next > 1)
+            {
+                char *control = &sendControl_[msgs * kControlLen];
+                ::memset(control, 0, kControlLen);
+                m.msg_hdr.msg_control = control;
+                m.msg_hdr.msg_controllen = CMSG_SPACE(sizeof(uint16_t));
+                cmsghdr *cmsg = CMSG_FIRSTHDR(&m.msg_hdr);
+                cmsg->cmsg_level = SOL_UDP;
+                cmsg->cmsg_type = UDP_SEGMENT;
+                cmsg->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+                uint16_t segment = static_cast<uint16_t>(first.len);
+                ::memcpy(CMSG_DATA(cmsg), &segment, sizeof segment);
+            }
+            sendFirstOfMsg_.push_back(next);
+            ++msgs;
+            next = end;
+        }
+        sendFirstOfMsg_.push_back(next);
+
+        size_t sentMsgs = 0;
+        while (sentMsgs < msgs)
+        {
+            int n = ::sendmmsg(socket_.fd(), &sendMsgs_[sentMsgs], static_cast<unsigned int>(msgs - sentMsgs), 0);
+            if (n > 0)
+            {
+                sentPackets_.fetch_add(sendFirstOfMsg_[sentMsgs + n] - sendFirstOfMsg_[sentMsgs], std::memory_order_relaxed);
+                sentMsgs += n;
+                continue;
+            }
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+            {
+                // 发送缓冲区满，UDP不做排队，剩下的全部丢弃
+                sendDrops_.fetch_add(count - sendFirstOfMsg_[sentMsgs], std::memory_order_relaxed);
+                next = count;
+                break;
+            }
+            // 单条消息出错(比如对端端口不可达)，丢弃这一条继续发后面的
+            LOG_ERROR("UdpSocket::flushSends sendmmsg errno=%d \n", errno);
+            sendDrops_.fetch_add(sendFirstOfMsg_[sentMsgs + 1] - sendFirstOfMsg_[sentMsgs], std::memory_order_relaxed);
+            ++sentMsgs;
+        }
+    }
+
+    sendArena_.clear();
+    outgoing_.clear();
+}
@@ -0,0 +1,119 @@
+#pragma once
+
+#include "noncopyable.h"
+#include "InetAddress.h"
+#include "Socket.h"
+#include "Channel.h"
+#include "TimeStamp.h"
+
+#include <functional>
+#include <memory>
+#include <vector>
+#include <atomic>
+#include <stdint.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+class EventLoop;
+
+// 收到的一个数据报，data指向UdpSocket预先分配的接收区，只在批量回调期间有效
+struct Datagram
+{
+    const char *data;
+    size_t len;
+    InetAddress peer;
+};
+
+/**************************
+ * 运行在一个EventLoop上的UDP socket
+ * 读: 可读时用recvmmsg一次收一批数据报到预先分配的接收区，整批以Datagram数组回调；
+ *     开启GRO时内核会把同一个流的多个数据报合并成一个，这里再按段长拆回单个的Datagram
+ * 写: sendTo只把数据拷到发送区，本轮事件循环结束时用sendmmsg一次发出；
+ *     开启GSO时发往同一个对端的连续等长数据报合成一个UDP_SEGMENT消息
+ * 只能在所属的loop线程中使用
+ **************************/
+class UdpSocket : noncopyable
+{
+public:
+    struct Options
+    {
+        Options()
+            : batchSize(64), maxDatagramSize(2048), reusePort(false), gro(false), gso(false)
+        {
+        }
+        size_t batchSize;       // 一次recvmmsg最多收的数据报个数
+        size_t maxDatagramSize; // 每个接收槽的大小，超过的数据报会被截断丢弃；开启GRO时固定为64K
+        bool reusePort;         // 多个loop各自绑定同一个地址，由内核按四元组哈希分发
+        bool gro;               // UDP_GRO，内核不支持时自动关闭
+        bool gso;               // UDP_SEGMENT，内核不支持时自动关闭
+    };
+
+    using BatchCallback = std::function<void(UdpSocket *socket, const Datagram *datagrams,
+                                             size_t count, TimeStamp receiveTime)>;
+
+    UdpSocket(EventLoop *loop, const InetAddress &bindAddr, const Options &options = Options());
+    ~UdpSocket();
+
+    void setBatchCallback(const BatchCallback &cb) { batchCallback_ = cb; }
+    // 开始接收，只能在loop线程中调用
+    void start();
+
+    // 数据被拷贝，本轮事件循环结束时统一发送；发送缓冲区满时丢弃并计入sendDrops
+    void sendTo(const InetAddress &peer, const char *data, size_t len);
+
+    EventLoop *getLoop() const { return loop_; }
+    int fd() const { return socket_.fd(); }
+    bool gro() const { return gro_; }
+    bool gso() const { return gso_; }
+
+    // 统计，可以在其他线程中读取
+    uint64_t receivedPackets() const { return receivedPackets_.load(std::memory_order_relaxed); }
+    uint64_t receivedBatches() const { return receivedBatches_.load(std::memory_order_relaxed); }
+    uint64_t sentPackets() const { return sentPackets_.load(std::memory_order_relaxed); }
+    uint64_t sendDrops() const { return sendDrops_.load(std::memory_order_relaxed); }
+    uint64_t truncated() const { return truncated_.load(std::memory_order_relaxed); }
+
+private:
+    struct Outgoing
+    {
+        size_t offset; // 在sendArena_中的偏移
+        size_t len;
+        sockaddr_in peer;
+    };
+
+    void handleRead(TimeStamp receiveTime);
+    void flushSends();
+
+    EventLoop *loop_;
+    Socket socket_;
+    Channel channel_;
+    const size_t batchSize_;
+    const size_t slotSize_;
+    bool gro_;
+    bool gso_;
+    BatchCallback batchCallback_;
+
+    // 接收区和recvmmsg用到的结构都预先分配，之后每批复用
+    std::vector<char> recvArena_;
+    std::vector<mmsghdr> recvMsgs_;
+    std::vector<iovec> recvIovecs_;
+    std::vector<sockaddr_in> recvAddrs_;
+    std::vector<char> recvControl_;
+    std::vector<Datagram> datagrams_;
+
+    std::vector<char> sendArena_;
+    std::vector<Outgoing> outgoing_;
+    std::vector<mmsghdr> sendMsgs_;
+    std::vector<iovec> sendIovecs_;
+    std::vector<char> sendControl_;
+    std::vector<size_t> sendFirstOfMsg_; // 每条消息包含的第一个数据报，用于统计发送结果
+    bool flushQueued_;
+    // 排队的flushSends只持有它的weak_ptr，socket在同一轮中析构之后不会再访问已释放的对象
+    std::shared_ptr<bool> alive_;
+
+    std::atomic<uint64_t> receivedPackets_;
+    std::atomic<uint64_t> receivedBatches_;
+    std::atomic<uint64_t> sentPackets_;
+    std::atomic<uint64_t> sendDrops_;
+    std::atomic<uint64_t> truncated_;
+};
@@ -0,0 +1,186 @@
+#pragma once
+
+#include <mymuduo/Logger.h>
+#include <mymuduo/LatencyStats.h>
+
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+#include <stdio.h>
+#include <stdint.h>
+#include <unistd.h>
+
+/****************
+ * benchmark目录下各压测程序共用的工具: 阻塞读写、延迟百分位数和JSON输出
+ * 每个测试用例在stdout上输出一行JSON对象，方便在同一台机器上对比不同提交的结果:
+ *   ./pingpong_latency > before.json
+ *   ./pingpong_latency > after.json
+ * *************/
+
+// 库的日志级别调到ERROR，并改为输出到stderr，stdout上只留JSON结果
+inline void benchQuietLogging()
+{
+    Logger::setLogLevel(ERROR);
+    Logger::instance().setOutput([](const char *line, size_t len)
+                                 { ::fwrite(line, 1, len, stderr); });
+    Logger::instance().setFlush([]() {});
+}
+
+inline int64_t benchNowNanos()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+inline bool readFull(int fd, char *buf, size_t len)
+{
+    while (len > 0)
+    {
+        ssize_t n = ::read(fd, buf, len);
+        if (n <= 0)
+        {
+            return false;
+        }
+        buf += n;
+        len -= n;
+    }
+    return true;
+}
+
+inline bool writeFull(int fd, const char *buf, size_t len)
+{
+    while (len > 0)
+    {
+        ssize_t n = ::write(fd, buf, len);
+        if (n <= 0)
+        {
+            return false;
+        }
+        buf += n;
+        len -= n;
+    }
+    return true;
+}
+
+// 一组延迟样本的统计结果，单位微秒
+struct LatencySummary
+{
+    long count;
+    double mean;
+    double p50;
+    double p90;
+    double p99;
+    double p999;
+    double max;
+};
+
+// samples单位纳秒，会被原地排序
+inline LatencySummary summarizeLatency(std::vector<int64_t> &samples)
+{
+    LatencySummary s = {0, 0, 0, 0, 0, 0, 0};
+    if (samples.empty())
+    {
+        return s;
+    }
+    std::sort(samples.begin(), samples.end());
+    double sum = 0;
+    for (int64_t ns : samples)
+    {
+        sum += ns;
+    }
+    auto percentile = [&samples](double q)
+    {
+        size_t index = std::min(samples.size() - 1, static_cast<size_t>(q * samples.size()));
+        return samples[index] / 1e3;
+    };
+    s.count = static_cast<long>(samples.size());
+    s.mean = sum / samples.size() / 1e3;
+    s.p50 = percentile(0.50);
+    s.p90 = percentile(0.90);
+    s.p99 = percentile(0.99);
+    s.p999 = percentile(0.999);
+    s.max = samples.back() / 1e3;
+    return s;
+}
+
+// 库内的延迟直方图(纳秒)转成同样的统计结果，百分位数是所在桶的上界
+inline LatencySummary summarizeLatency(const LatencyHistogram::Snapshot &s)
+{
+    LatencySummary summary;
+    summary.count = static_cast<long>(s.count);
+    summary.mean = s.mean() / 1e3;
+    summary.p50 = s.percentile(0.50) / 1e3;
+    summary.p90 = s.percentile(0.90) / 1e3;
+    summary.p99 = s.percentile(0.99) / 1e3;
+    summary.p999 = s.percentile(0.999) / 1e3;
+    summary.max = s.max / 1e3;
+    return summary;
+}
+
+// 拼一行扁平的JSON对象，键和字符串值都由压测程序自己给出，不做转义
+class JsonLine
+{
+public:
+    explicit JsonLine(const char *benchmark) { add("benchmark", benchmark); }
+
+    JsonLine &add(const char *key, const char *value)
+    {
+        appendKey(key);
+        body_ += '"';
+        body_ += value;
+        body_ += '"';
+        return *this;
+    }
+    JsonLine &add(const char *key, int value) { return add(key, static_cast<long>(value)); }
+    JsonLine &add(const char *key, size_t value) { return add(key, static_cast<long>(value)); }
+    JsonLine &add(const char *key, long value)
+    {
+        char buf[32];
+        snprintf(buf, sizeof buf, "%ld", value);
+        appendKey(key);
+        body_ += buf;
+        return *this;
+    }
+    JsonLine &add(const char *key, double value)
+    {
+        char buf[32];
+        snprintf(buf, sizeof buf, "%.3f", value);
+        appendKey(key);
+        body_ += buf;
+        return *this;
+    }
+    // 延迟统计作为一个嵌套对象输出
+    JsonLine &add(const char *key, const LatencySummary &s)
+    {
+        char buf[256];
+        snprintf(buf, sizeof buf,
+                 "{\"count\":%ld,\"mean\":%.3f,\"p50\":%.3f,\"p90\":%.3f,\"p99\":%.3f,\"p999\":%.3f,\"max\":%.3f}",
+                 s.count, s.mean, s.p50, s.p90, s.p99, s.p999, s.max);
+        appendKey(key);
+        body_ += buf;
+        return *this;
+    }
+
+    // 一个用例一行，立即刷出，被中途打断时已完成的用例结果不会丢
+    void print() const
+    {
+        printf("{%s}\n", body_.c_str());
+        fflush(stdout);
+    }
+
+private:
+    void appendKey(const char *key)
+    {
+        if (!body_.empty())
+        {
+            body_ += ',';
+        }
+        body_ += '"';
+        body_ += key;
+        body_ += "\":";
+    }
+
+    std::string body_;
+};
@@ -0,0 +1,111 @@
+#include <mymuduo/TcpServer.h>
+#include <mymuduo/Logger.h>
+
+#include "BenchUtil.h"
+
+#include <string>
+#include <functional>
+#include <thread>
+#include <vector>
+#include <atomic>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+
+/****************
+ * 大量连接同时关闭时服务器的处理速率:
+ * 客户端先建立batch个连接并等服务器全部建立(不计时)，然后一次性用RST关闭，
+ * 从第一个close开始计时，到服务器的连接数(TcpServer::numConnections)回到0为止，
+ * 这段时间包括各subloop执行handleClose、从连接表中删除和排队connectDestroyed
+ * 服务器的subloop个数从1翻倍到最大值
+ * 用法: ./close_churn [每组测量秒数，默认3] [一批连接数，默认512] [最大subloop个数，默认4] [端口，默认9994]
+ * *************/
+
+static void onConnection(const TcpConnectionPtr &) {}
+
+static void runCase(TcpServer &server, uint16_t port, int batch, int serverThreads, double seconds)
+{
+    sockaddr_in addr = *InetAddress(port).getSockAddr();
+    linger lingerOpt = {1, 0};
+    std::vector<int> fds(batch);
+    long closed = 0;
+    int64_t closeNanos = 0;
+    int64_t deadline = benchNowNanos() + static_cast<int64_t>(seconds * 1e9);
+    while (benchNowNanos() < deadline)
+    {
+        for (int i = 0; i < batch; ++i)
+        {
+            fds[i] = ::socket(AF_INET, SOCK_STREAM, 0);
+            if (::connect(fds[i], (sockaddr *)&addr, sizeof addr) < 0)
+            {
+                perror("connect");
+                exit(1);
+            }
+            ::setsockopt(fds[i], SOL_SOCKET, SO_LINGER, &lingerOpt, sizeof lingerOpt);
+        }
+        while (server.numConnections() < static_cast<size_t>(batch))
+        {
+            std::this_thread::yield();
+        }
+
+        int64_t start = benchNowNanos();
+        for (int i = 0; i < batch; ++i)
+        {
+            ::close(fds[i]);
+        }
+        while (server.numConnections() > 0)
+        {
+            std::this_thread::yield();
+        }
+        closeNanos += benchNowNanos() - start;
+        closed += batch;
+    }
+    double sec = closeNanos / 1e9;
+
+    JsonLine("close_churn")
+        .add("server_threads", serverThreads)
+        .add("batch", batch)
+        .add("seconds", sec)
+        .add("connections_completed", closed)
+        .add("closes_per_sec", closed / sec)
+        .print();
+}
+
+int main(int argc, char *argv[])
+{
+    double seconds = argc > 1 ? atof(argv[1]) : 3;
+    int batch = argc > 2 ? atoi(argv[2]) : 512;
+    int maxThreads = argc > 3 ? atoi(argv[3]) : 4;
+    uint16_t port = static_cast<uint16_t>(argc > 4 ? atoi(argv[4]) : 9994);
+    benchQuietLogging();
+    // 每个连接都以RST结束，服务器的handleError会为每个连接打一行ERROR日志，这里只保留FATAL
+    Logger::setLogLevel(FATAL);
+
+    std::vector<int> threadCounts;
+    for (int n = 1; n < maxThreads; n *= 2)
+    {
+        threadCounts.push_back(n);
+    }
+    threadCounts.push_back(maxThreads);
+
+    // 每组用一个新的TcpServer，subloop个数只能在start之前设置
+    for (int threads : threadCounts)
+    {
+        EventLoop loop;
+        TcpServer server(&loop, InetAddress(port), "CloseChurnServer");
+        server.setThreadNum(threads);
+        server.setConnectionCallback(onConnection);
+        server.start();
+
+        std::thread driver([&]()
+                           {
+                               runCase(server, port, batch, threads, seconds);
+                               loop.quit();
+                           });
+        loop.loop();
+        driver.join();
+    }
+    return 0;
+}
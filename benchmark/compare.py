@@ -0,0 +1,109 @@
+#!/usr/bin/env python3
+# 对比两次压测的结果文件，输出每一项的变化百分比
+# 支持两种格式:
+#   micro_core --benchmark_out_format=json 输出的Google Benchmark JSON，按benchmark名字配对，比较cpu_time/real_time
+#   pingpong_latency等端到端压测每行一个JSON对象的输出，按整数类型的参数字段配对，比较浮点类型的结果字段
+# 用法: python3 compare.py before.json after.json [--threshold 5]
+#   只标出变化超过threshold百分比的项，数值越小越好的指标(时间、延迟)变大记为变差
+
+import argparse
+import json
+import sys
+
+# 端到端结果里数值越大越好的字段，其余的浮点字段(耗时、延迟)越小越好
+HIGHER_IS_BETTER = ('_per_sec', 'bytes_per_second', 'items_per_second')
+# 端到端结果里属于测量结果的整数字段，不参与配对
+COUNT_FIELDS = ('round_trips', 'bytes', 'connections_completed', 'server_accepted', 'server_closed')
+
+
+def load(path):
+    with open(path) as f:
+        text = f.read()
+    try:
+        doc = json.loads(text)
+        if isinstance(doc, dict) and 'benchmarks' in doc:
+            return load_google_benchmark(doc)
+    except ValueError:
+        pass
+    return load_json_lines(text)
+
+
+def load_google_benchmark(doc):
+    results = {}
+    for b in doc['benchmarks']:
+        # 开启重复运行时只取汇总出来的平均值
+        if b.get('run_type') == 'aggregate' and b.get('aggregate_name') != 'mean':
+            continue
+        metrics = {}
+        for key in ('cpu_time', 'real_time', 'bytes_per_second', 'items_per_second'):
+            if key in b:
+                metrics[key] = float(b[key])
+        results[b.get('run_name', b['name'])] = metrics
+    return results
+
+
+def flatten(prefix, value, out):
+    if isinstance(value, dict):
+        for k, v in value.items():
+            flatten(prefix + '.' + k, v, out)
+    elif isinstance(value, float):
+        out[prefix] = value
+
+
+def load_json_lines(text):
+    results = {}
+    for line in text.splitlines():
+        line = line.strip()
+        if not line.startswith('{'):
+            continue
+        row = json.loads(line)
+        # 除COUNT_FIELDS之外的字符串和整数字段是用例参数，浮点和嵌套对象是测量结果
+        key_parts = [str(row.get('benchmark', ''))]
+        metrics = {}
+        for k, v in row.items():
+            if k in ('benchmark', 'seconds'):
+                continue
+            if isinstance(v, (str, int)) and k not in COUNT_FIELDS:
+                key_parts.append('%s=%s' % (k, v))
+            else:
+                flatten(k, v, metrics)
+        results[' '.join(key_parts)] = metrics
+    return results
+
+
+def main():
+    parser = argparse.ArgumentParser(description='compare two benchmark result files')
+    parser.add_argument('before')
+    parser.add_argument('after')
+    parser.add_argument('--threshold', type=float, default=5.0,
+                        help='percent change to flag as better/worse (default 5)')
+    args = parser.parse_args()
+
+    before = load(args.before)
+    after = load(args.after)
+    worse = 0
+    print('%-60s %-22s %14s %14s %9s' % ('case', 'metric', 'before', 'after', 'change'))
+    for name in before:
+        if name not in after:
+            print('%-60s only in %s' % (name, args.before))
+            continue
+        for metric, old in sorted(before[name].items()):
+            new = after[name].get(metric)
+            if new is None or old == 0:
+                continue
+            change = (new - old) / old * 100
+            higher_better = metric.endswith(HIGHER_IS_BETTER)
+            mark = ''
+            if abs(change) >= args.threshold:
+                better = (change > 0) == higher_better
+                mark = 'better' if better else 'WORSE'
+                worse += 0 if better else 1
+            print('%-60s %-22s %14.3f %14.3f %+8.1f%% %s' % (name, metric, old, new, change, mark))
+    for name in after:
+        if name not in before:
+            print('%-60s only in %s' % (name, args.after))
+    return 1 if worse else 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,146 @@
+#include <mymuduo/TcpServer.h>
+#include <mymuduo/Metrics.h>
+#include <mymuduo/Logger.h>
+
+#include "BenchUtil.h"
+
+#include <string>
+#include <functional>
+#include <thread>
+#include <chrono>
+#include <vector>
+#include <atomic>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+
+/****************
+ * 连接风暴下的accept速率:
+ * 客户端一次连续发起burst个connect，连接完成三次握手后就进入监听socket的accept队列，
+ * 从第一个connect开始计时，到服务器的连接建立回调全部执行完为止，之后用RST关闭这一批连接(不计时)
+ * 对比Acceptor每次可读事件最多accept的连接数(TcpServer::setAcceptBatchSize)，
+ * 同时输出平均每个连接经历的epoll_wait返回次数(所有loop合计，来自Metrics)
+ * 用法: ./connect_storm [每组测量秒数，默认3] [一批连接数，默认256] [服务器subloop个数，默认2] [端口，默认9993]
+ * *************/
+
+class StormServer
+{
+public:
+    StormServer(EventLoop *loop, const InetAddress &addr, int threads, int batchSize)
+        : server_(loop, addr, "StormServer"),
+          established_(0),
+          closed_(0)
+    {
+        server_.setThreadNum(threads);
+        server_.setAcceptBatchSize(batchSize);
+        server_.setConnectionCallback(
+            std::bind(&StormServer::onConnection, this, std::placeholders::_1));
+    }
+
+    void start() { server_.start(); }
+    long established() const { return established_.load(); }
+    long closed() const { return closed_.load(); }
+
+private:
+    void onConnection(const TcpConnectionPtr &conn)
+    {
+        if (conn->connected())
+        {
+            established_.fetch_add(1);
+        }
+        else
+        {
+            closed_.fetch_add(1);
+        }
+    }
+
+    TcpServer server_;
+    std::atomic_long established_;
+    std::atomic_long closed_;
+};
+
+static void runStorm(StormServer &server, uint16_t port, int burst, int batchSize, int serverThreads, double seconds)
+{
+    sockaddr_in addr = *InetAddress(port).getSockAddr();
+    linger lingerOpt = {1, 0};
+    std::vector<int> fds(burst);
+    long accepted = 0;
+    int64_t stormNanos = 0;
+    int64_t wakeupsBefore = Metrics::snapshot()[Metrics::kEpollWakeups];
+    int64_t deadline = benchNowNanos() + static_cast<int64_t>(seconds * 1e9);
+    while (benchNowNanos() < deadline)
+    {
+        long target = server.established() + burst;
+        int64_t start = benchNowNanos();
+        for (int i = 0; i < burst; ++i)
+        {
+            fds[i] = ::socket(AF_INET, SOCK_STREAM, 0);
+            if (::connect(fds[i], (sockaddr *)&addr, sizeof addr) < 0)
+            {
+                perror("connect");
+                exit(1);
+            }
+        }
+        while (server.established() < target)
+        {
+            std::this_thread::yield();
+        }
+        stormNanos += benchNowNanos() - start;
+        accepted += burst;
+
+        long closedTarget = server.closed() + burst;
+        for (int i = 0; i < burst; ++i)
+        {
+            ::setsockopt(fds[i], SOL_SOCKET, SO_LINGER, &lingerOpt, sizeof lingerOpt);
+            ::close(fds[i]);
+        }
+        // 下一批开始之前等服务器处理完这一批的关闭，避免两批混在一起
+        while (server.closed() < closedTarget)
+        {
+            std::this_thread::yield();
+        }
+    }
+    int64_t wakeups = Metrics::snapshot()[Metrics::kEpollWakeups] - wakeupsBefore;
+    double sec = stormNanos / 1e9;
+
+    JsonLine("connect_storm")
+        .add("accept_batch", batchSize)
+        .add("burst", burst)
+        .add("server_threads", serverThreads)
+        .add("seconds", sec)
+        .add("connections_completed", accepted)
+        .add("accepts_per_sec", accepted / sec)
+        .add("epoll_wakeups_per_connection", static_cast<double>(wakeups) / accepted)
+        .print();
+}
+
+int main(int argc, char *argv[])
+{
+    double seconds = argc > 1 ? atof(argv[1]) : 3;
+    int burst = argc > 2 ? atoi(argv[2]) : 256;
+    int serverThreads = argc > 3 ? atoi(argv[3]) : 2;
+    uint16_t port = static_cast<uint16_t>(argc > 4 ? atoi(argv[4]) : 9993);
+    benchQuietLogging();
+    // 每个连接都以RST结束，服务器的handleError会为每个连接打一行ERROR日志，这里只保留FATAL
+    Logger::setLogLevel(FATAL);
+
+    // 每组用一个新的TcpServer，accept的批大小在start之前设置
+    const int batchSizes[] = {1, 4, 32, 128};
+    for (int batchSize : batchSizes)
+    {
+        EventLoop loop;
+        StormServer server(&loop, InetAddress(port), serverThreads, batchSize);
+        server.start();
+
+        std::thread driver([&]()
+                           {
+                               runStorm(server, port, burst, batchSize, serverThreads, seconds);
+                               loop.quit();
+                           });
+        loop.loop();
+        driver.join();
+    }
+    return 0;
+}
@@ -0,0 +1,169 @@
+#include <mymuduo/TcpServer.h>
+#include <mymuduo/Logger.h>
+
+#include "BenchUtil.h"
+
+#include <string>
+#include <functional>
+#include <thread>
+#include <chrono>
+#include <vector>
+#include <atomic>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+
+/****************
+ * 建立/关闭连接的速率:
+ * 服务器在连接建立回调里发出1字节问候，客户端线程循环执行 connect -> 读到问候 -> close，
+ * 读到问候说明服务器已经完成accept、分配subloop和注册channel，一次循环就是一个完整的连接生命周期
+ * 客户端用SO_LINGER{1, 0}关闭，直接发RST，两端都不留TIME_WAIT，不会耗尽本地端口
+ * 输出每秒完成的连接数，以及服务器统计到的建立/关闭次数
+ * 开启CPU分流(TcpServer::setCpuSteering)时另外输出收包CPU与服务loop绑定的CPU一致的连接比例
+ * 用法: ./connection_churn [每组测量秒数，默认3] [服务器subloop个数，默认1] [端口，默认9992] [CPU分流，默认0]
+ * *************/
+
+class ChurnServer
+{
+public:
+    ChurnServer(EventLoop *loop, const InetAddress &addr, int threads, bool cpuSteering)
+        : server_(loop, addr, "ChurnServer"),
+          accepted_(0),
+          closed_(0)
+    {
+        server_.setThreadNum(threads);
+        server_.setCpuSteering(cpuSteering);
+        server_.setConnectionCallback(
+            std::bind(&ChurnServer::onConnection, this, std::placeholders::_1));
+    }
+
+    void start() { server_.start(); }
+    long accepted() const { return accepted_.load(); }
+    long closed() const { return closed_.load(); }
+    TcpServer::CpuSteeringStats cpuSteeringStats() const { return server_.cpuSteeringStats(); }
+
+private:
+    void onConnection(const TcpConnectionPtr &conn)
+    {
+        if (conn->connected())
+        {
+            accepted_.fetch_add(1);
+            conn->send("g", 1);
+        }
+        else
+        {
+            closed_.fetch_add(1);
+        }
+    }
+
+    TcpServer server_;
+    std::atomic_long accepted_;
+    std::atomic_long closed_;
+};
+
+// 在deadline之前循环建立并关闭连接，返回完成的次数
+static long churn(uint16_t port, int64_t deadline)
+{
+    sockaddr_in addr = *InetAddress(port).getSockAddr();
+    linger lingerOpt = {1, 0};
+    long done = 0;
+    while (benchNowNanos() < deadline)
+    {
+        int sockfd = ::socket(AF_INET, SOCK_STREAM, 0);
+        if (::connect(sockfd, (sockaddr *)&addr, sizeof addr) < 0)
+        {
+            perror("connect");
+            exit(1);
+        }
+        char greeting;
+        if (!readFull(sockfd, &greeting, 1))
+        {
+            perror("read greeting");
+            exit(1);
+        }
+        ::setsockopt(sockfd, SOL_SOCKET, SO_LINGER, &lingerOpt, sizeof lingerOpt);
+        ::close(sockfd);
+        ++done;
+    }
+    return done;
+}
+
+static void runCase(ChurnServer &server, uint16_t port, int clientThreads, int serverThreads,
+                    bool cpuSteering, double seconds)
+{
+    TcpServer::CpuSteeringStats steeringStart = server.cpuSteeringStats();
+    long acceptedStart = server.accepted();
+    long closedStart = server.closed();
+    std::vector<long> counts(clientThreads);
+    std::vector<std::thread> clients;
+    int64_t start = benchNowNanos();
+    int64_t deadline = start + static_cast<int64_t>(seconds * 1e9);
+    for (int i = 0; i < clientThreads; ++i)
+    {
+        clients.emplace_back([&counts, i, port, deadline]()
+                             { counts[i] = churn(port, deadline); });
+    }
+    for (std::thread &t : clients)
+    {
+        t.join();
+    }
+    double sec = (benchNowNanos() - start) / 1e9;
+    long connections = 0;
+    for (long n : counts)
+    {
+        connections += n;
+    }
+
+    // 等服务器处理完最后一批RST
+    for (int i = 0; i < 1000 && server.closed() - closedStart < connections; ++i)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    TcpServer::CpuSteeringStats steering = server.cpuSteeringStats();
+    steering.connections -= steeringStart.connections;
+    steering.cpuMatched -= steeringStart.cpuMatched;
+    JsonLine line("connection_churn");
+    line.add("client_threads", clientThreads)
+        .add("server_threads", serverThreads)
+        .add("cpu_steering", cpuSteering ? 1 : 0)
+        .add("seconds", sec)
+        .add("connections_completed", connections)
+        .add("connections_per_sec", connections / sec)
+        .add("server_accepted", server.accepted() - acceptedStart)
+        .add("server_closed", server.closed() - closedStart);
+    if (cpuSteering)
+    {
+        line.add("cpu_match_ratio", steering.matchRatio());
+    }
+    line.print();
+}
+
+int main(int argc, char *argv[])
+{
+    double seconds = argc > 1 ? atof(argv[1]) : 3;
+    int serverThreads = argc > 2 ? atoi(argv[2]) : 1;
+    uint16_t port = static_cast<uint16_t>(argc > 3 ? atoi(argv[3]) : 9992);
+    bool cpuSteering = argc > 4 && atoi(argv[4]) != 0;
+    benchQuietLogging();
+    // 每个连接都以RST结束，服务器的handleError会为每个连接打一行ERROR日志，这里只保留FATAL
+    Logger::setLogLevel(FATAL);
+
+    EventLoop loop;
+    ChurnServer server(&loop, InetAddress(port), serverThreads, cpuSteering);
+    server.start();
+
+    std::thread driver([&]()
+                       {
+                           const int clientThreadCounts[] = {1, 4};
+                           for (int clientThreads : clientThreadCounts)
+                           {
+                               runCase(server, port, clientThreads, serverThreads, cpuSteering, seconds);
+                           }
+                           loop.quit();
+                       });
+    loop.loop();
+    driver.join();
+    return 0;
+}
@@ -0,0 +1,196 @@
+#include <mymuduo/TcpServer.h>
+#include <mymuduo/TcpClient.h>
+#include <mymuduo/EventLoopThread.h>
+#include <mymuduo/Logger.h>
+
+#include "BenchUtil.h"
+
+#include <string>
+#include <functional>
+#include <thread>
+#include <chrono>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <stdio.h>
+#include <stdlib.h>
+
+/****************
+ * 大块数据的echo吞吐，对应muduo的pingpong吞吐测试:
+ * 客户端的每个会话连上之后先发一个block，之后两端都把收到的数据原样发回，数据一直在连接上来回流动
+ * 服务器的subloop个数从1翻倍到最大值，客户端用同样个数的loop线程，会话数固定
+ * 所有会话连上之后才开始计时，统计测量窗口内客户端收到的字节数，输出MiB/s
+ * 用法: ./echo_throughput [每组测量秒数，默认3] [最大subloop个数，默认4] [会话数，默认16]
+ *                        [block字节数，默认16384] [端口，默认9991]
+ * *************/
+
+class EchoSession : noncopyable
+{
+public:
+    EchoSession(EventLoop *loop, const InetAddress &addr, size_t blockSize, std::atomic_int *connected)
+        : client_(loop, addr, "EchoClient"),
+          block_(blockSize, 'e'),
+          bytesRead_(0),
+          connected_(connected)
+    {
+        client_.setConnectionCallback(
+            std::bind(&EchoSession::onConnection, this, std::placeholders::_1));
+        client_.setMessageCallback(
+            std::bind(&EchoSession::onMessage, this,
+                      std::placeholders::_1, std::placeholders::_2, std::placeholders::_3));
+    }
+
+    void start() { client_.connect(); }
+    void stop() { client_.disconnect(); }
+    long bytesRead() const { return bytesRead_.load(std::memory_order_relaxed); }
+
+private:
+    void onConnection(const TcpConnectionPtr &conn)
+    {
+        if (conn->connected())
+        {
+            conn->setTcpNoDelay(true);
+            connected_->fetch_add(1);
+            conn->send(block_);
+        }
+        else
+        {
+            connected_->fetch_sub(1);
+        }
+    }
+
+    void onMessage(const TcpConnectionPtr &conn, Buffer *buf, TimeStamp)
+    {
+        bytesRead_.fetch_add(buf->readAbleBytes(), std::memory_order_relaxed);
+        conn->send(buf);
+    }
+
+    TcpClient client_;
+    std::string block_;
+    std::atomic_long bytesRead_; // 只在所属loop线程里增加，测量线程读取
+    std::atomic_int *connected_;
+};
+
+static void onServerConnection(const TcpConnectionPtr &conn)
+{
+    if (conn->connected())
+    {
+        conn->setTcpNoDelay(true);
+    }
+}
+
+static void onServerMessage(const TcpConnectionPtr &conn, Buffer *buf, TimeStamp)
+{
+    conn->send(buf);
+}
+
+static long totalBytesRead(const std::vector<std::unique_ptr<EchoSession>> &sessions)
+{
+    long total = 0;
+    for (const std::unique_ptr<EchoSession> &session : sessions)
+    {
+        total += session->bytesRead();
+    }
+    return total;
+}
+
+// 等待条件成立，超时返回false
+template <typename Pred>
+static bool waitFor(Pred pred, int timeoutMs)
+{
+    for (int i = 0; i < timeoutMs && !pred(); ++i)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return pred();
+}
+
+static void runClients(uint16_t port, int threads, int sessionCount, size_t blockSize, double seconds)
+{
+    std::vector<std::unique_ptr<EventLoopThread>> loopThreads;
+    std::vector<EventLoop *> loops;
+    for (int i = 0; i < threads; ++i)
+    {
+        loopThreads.emplace_back(new EventLoopThread());
+        loops.push_back(loopThreads.back()->startLoop());
+    }
+
+    std::atomic_int connected(0);
+    std::vector<std::unique_ptr<EchoSession>> sessions;
+    for (int i = 0; i < sessionCount; ++i)
+    {
+        sessions.emplace_back(new EchoSession(loops[i % threads], InetAddress(port), blockSize, &connected));
+        sessions.back()->start();
+    }
+    if (!waitFor([&]()
+                 { return connected.load() == sessionCount; },
+                 5000))
+    {
+        fprintf(stderr, "only %d of %d sessions connected\n", connected.load(), sessionCount);
+        exit(1);
+    }
+
+    long startBytes = totalBytesRead(sessions);
+    int64_t start = benchNowNanos();
+    std::this_thread::sleep_for(std::chrono::duration<double>(seconds));
+    long bytes = totalBytesRead(sessions) - startBytes;
+    double sec = (benchNowNanos() - start) / 1e9;
+
+    for (std::unique_ptr<EchoSession> &session : sessions)
+    {
+        session->stop();
+    }
+    waitFor([&]()
+            { return connected.load() == 0; },
+            5000);
+    sessions.clear();
+    loopThreads.clear();
+
+    JsonLine("echo_throughput")
+        .add("server_threads", threads)
+        .add("client_threads", threads)
+        .add("sessions", sessionCount)
+        .add("block_bytes", blockSize)
+        .add("seconds", sec)
+        .add("bytes", bytes)
+        .add("mib_per_sec", bytes / sec / 1024 / 1024)
+        .add("blocks_per_sec", bytes / sec / blockSize)
+        .print();
+}
+
+int main(int argc, char *argv[])
+{
+    double seconds = argc > 1 ? atof(argv[1]) : 3;
+    int maxThreads = argc > 2 ? atoi(argv[2]) : 4;
+    int sessionCount = argc > 3 ? atoi(argv[3]) : 16;
+    size_t blockSize = argc > 4 ? atol(argv[4]) : 16384;
+    uint16_t port = static_cast<uint16_t>(argc > 5 ? atoi(argv[5]) : 9991);
+    benchQuietLogging();
+
+    std::vector<int> threadCounts;
+    for (int n = 1; n < maxThreads; n *= 2)
+    {
+        threadCounts.push_back(n);
+    }
+    threadCounts.push_back(maxThreads);
+
+    // 每组用一个新的TcpServer，subloop个数只能在start之前设置
+    for (int threads : threadCounts)
+    {
+        EventLoop loop;
+        TcpServer server(&loop, InetAddress(port), "EchoServer");
+        server.setThreadNum(threads);
+        server.setConnectionCallback(onServerConnection);
+        server.setMessageCallback(onServerMessage);
+        server.start();
+
+        std::thread driver([&]()
+                           {
+                               runClients(port, threads, sessionCount, blockSize, seconds);
+                               loop.quit();
+                           });
+        loop.loop();
+        driver.join();
+    }
+    return 0;
+}
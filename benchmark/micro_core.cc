@@ -0,0 +1,286 @@
+#include <mymuduo/Buffer.h>
+#include <mymuduo/Channel.h>
+#include <mymuduo/EventLoop.h>
+#include <mymuduo/EventLoopThread.h>
+
+#include "BenchUtil.h"
+
+#include <benchmark/benchmark.h>
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <thread>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/eventfd.h>
+#include <sys/epoll.h>
+
+/****************
+ * 核心组件的微基准，基于Google Benchmark:
+ *   Buffer的append/retrieve稳态、逐块增长(makeSpace扩容)和回收已读空间(makeSpace搬移)
+ *   Buffer::readFd从socketpair读数据
+ *   跨线程queueInLoop/runInLoop的往返延迟，以及loop线程内runInLoop的直接调用
+ *   EPoller::updateChannel的MOD和ADD/DEL抖动，poller中已注册不同数量的channel
+ *   Channel::handleEvent的分发开销，区分是否tie
+ * 用法: ./micro_core --benchmark_out=result.json --benchmark_out_format=json
+ *       python3 compare.py before.json after.json
+ * *************/
+
+// append固定长度后全部取走，可读数据每轮都归零，不触发makeSpace
+static void BM_BufferAppendRetrieve(benchmark::State &state)
+{
+    const size_t len = state.range(0);
+    std::string data(len, 'b');
+    Buffer buf;
+    for (auto _ : state)
+    {
+        buf.append(data.data(), len);
+        benchmark::DoNotOptimize(buf.peek());
+        buf.retrieve(len);
+    }
+    state.SetBytesProcessed(state.iterations() * len);
+}
+BENCHMARK(BM_BufferAppendRetrieve)->Arg(16)->Arg(256)->Arg(4096)->Arg(65536);
+
+// 从空Buffer开始每次append 64字节直到total，统计逐步扩容的总开销
+static void BM_BufferGrowth(benchmark::State &state)
+{
+    const size_t total = state.range(0);
+    const size_t kChunk = 64;
+    char chunk[kChunk] = {0};
+    for (auto _ : state)
+    {
+        Buffer buf;
+        for (size_t n = 0; n < total; n += kChunk)
+        {
+            buf.append(chunk, kChunk);
+        }
+        benchmark::DoNotOptimize(buf.peek());
+    }
+    state.SetBytesProcessed(state.iterations() * total);
+}
+BENCHMARK(BM_BufferGrowth)->Arg(4096)->Arg(65536)->Arg(1 << 20);
+
+// 可读数据始终保留16字节，读指针不断后移，每轮append都要走makeSpace把剩余数据搬回头部
+static void BM_BufferCompact(benchmark::State &state)
+{
+    const size_t len = state.range(0);
+    const size_t kResidual = 16;
+    std::string data(len, 'c');
+    Buffer buf(len + kResidual);
+    buf.append(data.data(), kResidual);
+    for (auto _ : state)
+    {
+        buf.append(data.data(), len);
+        benchmark::DoNotOptimize(buf.peek());
+        buf.retrieve(len);
+    }
+    state.SetBytesProcessed(state.iterations() * len);
+}
+BENCHMARK(BM_BufferCompact)->Arg(256)->Arg(4096)->Arg(65536);
+
+// 往socketpair一端写len字节，另一端用readFd读完
+static void BM_BufferReadFd(benchmark::State &state)
+{
+    const size_t len = state.range(0);
+    int fds[2];
+    if (::socketpair(AF_UNIX, SOCK_STREAM, 0, fds) < 0)
+    {
+        state.SkipWithError("socketpair failed");
+        return;
+    }
+    int sndbuf = 4 * 1024 * 1024;
+    ::setsockopt(fds[0], SOL_SOCKET, SO_SNDBUF, &sndbuf, sizeof sndbuf);
+    ::setsockopt(fds[1], SOL_SOCKET, SO_RCVBUF, &sndbuf, sizeof sndbuf);
+    std::string data(len, 'r');
+    Buffer buf;
+    int saveErrno = 0;
+    for (auto _ : state)
+    {
+        if (!writeFull(fds[0], data.data(), len))
+        {
+            state.SkipWithError("write failed");
+            break;
+        }
+        while (buf.readAbleBytes() < len)
+        {
+            if (buf.readFd(fds[1], &saveErrno) <= 0)
+            {
+                state.SkipWithError("readFd failed");
+                break;
+            }
+        }
+        buf.retrieveAll();
+    }
+    state.SetBytesProcessed(state.iterations() * len);
+    ::close(fds[0]);
+    ::close(fds[1]);
+}
+BENCHMARK(BM_BufferReadFd)->Arg(64)->Arg(4096)->Arg(65536)->Arg(262144);
+
+// 从当前线程向另一个loop线程投递batch个回调，等最后一个执行完，统计一次投递-执行的往返
+static void BM_QueueInLoopRoundTrip(benchmark::State &state)
+{
+    const int batch = state.range(0);
+    EventLoopThread thread;
+    EventLoop *loop = thread.startLoop();
+    std::atomic_int done(0);
+    for (auto _ : state)
+    {
+        done.store(0, std::memory_order_relaxed);
+        for (int i = 0; i < batch; ++i)
+        {
+            loop->queueInLoop([&done]()
+                              { done.fetch_add(1, std::memory_order_release); });
+        }
+        while (done.load(std::memory_order_acquire) < batch)
+        {
+            std::this_thread::yield(); // CPU少于两个时让出CPU给loop线程
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * batch);
+}
+BENCHMARK(BM_QueueInLoopRoundTrip)->Arg(1)->Arg(16)->Arg(256)->UseRealTime();
+
+// runInLoop在非loop线程中调用时退化为queueInLoop，这里同样统计往返
+static void BM_RunInLoopCrossThread(benchmark::State &state)
+{
+    EventLoopThread thread;
+    EventLoop *loop = thread.startLoop();
+    std::atomic_bool done(false);
+    for (auto _ : state)
+    {
+        done.store(false, std::memory_order_relaxed);
+        loop->runInLoop([&done]()
+                        { done.store(true, std::memory_order_release); });
+        while (!done.load(std::memory_order_acquire))
+        {
+            std::this_thread::yield();
+        }
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_RunInLoopCrossThread)->UseRealTime();
+
+// loop线程内的runInLoop直接执行回调，只剩std::function的构造和调用
+static void BM_RunInLoopSameThread(benchmark::State &state)
+{
+    EventLoop loop;
+    long count = 0;
+    for (auto _ : state)
+    {
+        loop.runInLoop([&count]()
+                       { ++count; });
+    }
+    benchmark::DoNotOptimize(count);
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_RunInLoopSameThread);
+
+// 预先注册registered个eventfd的channel，让poller的channelsMap_有相应的规模
+class RegisteredChannels
+{
+public:
+    RegisteredChannels(EventLoop *loop, int count)
+    {
+        for (int i = 0; i < count; ++i)
+        {
+            int fd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+            fds_.push_back(fd);
+            channels_.emplace_back(new Channel(loop, fd));
+            channels_.back()->enableReading();
+        }
+    }
+    ~RegisteredChannels()
+    {
+        for (size_t i = 0; i < channels_.size(); ++i)
+        {
+            channels_[i]->disableAll();
+            channels_[i]->remove();
+            ::close(fds_[i]);
+        }
+    }
+
+private:
+    std::vector<int> fds_;
+    std::vector<std::unique_ptr<Channel>> channels_;
+};
+
+// 已注册的channel反复开关写事件，每次一个EPOLL_CTL_MOD
+static void BM_UpdateChannelModify(benchmark::State &state)
+{
+    EventLoop loop;
+    RegisteredChannels others(&loop, state.range(0));
+    int fd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    Channel channel(&loop, fd);
+    channel.enableReading();
+    for (auto _ : state)
+    {
+        channel.enableWriting();
+        channel.disableWriting();
+    }
+    state.SetItemsProcessed(state.iterations() * 2);
+    channel.disableAll();
+    channel.remove();
+    ::close(fd);
+}
+BENCHMARK(BM_UpdateChannelModify)->Arg(0)->Arg(64)->Arg(4096);
+
+// 连接建立和关闭时的路径: enableReading(ADD) -> disableAll(DEL) -> remove
+static void BM_UpdateChannelAddRemove(benchmark::State &state)
+{
+    EventLoop loop;
+    RegisteredChannels others(&loop, state.range(0));
+    int fd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    Channel channel(&loop, fd);
+    for (auto _ : state)
+    {
+        channel.enableReading();
+        channel.disableAll();
+        channel.remove();
+    }
+    state.SetItemsProcessed(state.iterations());
+    ::close(fd);
+}
+BENCHMARK(BM_UpdateChannelAddRemove)->Arg(0)->Arg(64)->Arg(4096);
+
+// Channel::handleEvent按revents分发到读回调，参数为1时先tie一个对象，每次分发都要提升weak_ptr
+static void BM_ChannelHandleEvent(benchmark::State &state)
+{
+    EventLoop loop;
+    Channel channel(&loop, -1);
+    long reads = 0;
+    channel.setReadCallback([&reads](TimeStamp)
+                            { ++reads; });
+    std::shared_ptr<int> owner = std::make_shared<int>(0);
+    if (state.range(0))
+    {
+        channel.tie(owner);
+    }
+    channel.set_revents(EPOLLIN);
+    TimeStamp now = TimeStamp::now();
+    for (auto _ : state)
+    {
+        channel.handleEvent(now);
+    }
+    benchmark::DoNotOptimize(reads);
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_ChannelHandleEvent)->ArgName("tied")->Arg(0)->Arg(1);
+
+int main(int argc, char **argv)
+{
+    benchQuietLogging();
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv))
+    {
+        return 1;
+    }
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
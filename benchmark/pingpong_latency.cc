@@ -0,0 +1,150 @@
+#include <mymuduo/TcpServer.h>
+#include <mymuduo/Logger.h>
+
+#include "BenchUtil.h"
+
+#include <string>
+#include <functional>
+#include <thread>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+/****************
+ * pingpong往返延迟:
+ * 服务器把收到的数据原样发回，每个客户端线程一个阻塞连接，发出一条消息后等完整的回应再发下一条，
+ * 记录每次往返的耗时，输出每秒往返次数和延迟的百分位数(微秒)
+ * 每个连接先做rounds/10次预热往返，不计入统计
+ * 采样间隔大于0时服务器对连接做延迟采样(TcpServer::setLatencySampling)，
+ * 额外输出服务器端queue/handler/flush/total各阶段的延迟
+ * 用法: ./pingpong_latency [每个连接的往返次数，默认20000] [服务器subloop个数，默认1] [端口，默认9990]
+ *                         [服务器延迟采样间隔，默认0不采样]
+ * *************/
+
+static void onConnection(const TcpConnectionPtr &conn)
+{
+    if (conn->connected())
+    {
+        conn->setTcpNoDelay(true);
+    }
+}
+
+static void onMessage(const TcpConnectionPtr &conn, Buffer *buf, TimeStamp)
+{
+    conn->send(buf);
+}
+
+// 一个连接上的往返，每次往返的耗时追加到samples
+static void pingpong(uint16_t port, size_t size, long rounds, std::vector<int64_t> *samples)
+{
+    int sockfd = ::socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr = *InetAddress(port).getSockAddr();
+    if (::connect(sockfd, (sockaddr *)&addr, sizeof addr) < 0)
+    {
+        perror("connect");
+        exit(1);
+    }
+    int on = 1;
+    ::setsockopt(sockfd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof on);
+
+    std::string message(size, 'p');
+    std::vector<char> reply(size);
+    long warmup = rounds / 10;
+    samples->reserve(rounds);
+    for (long i = 0; i < warmup + rounds; ++i)
+    {
+        int64_t start = benchNowNanos();
+        if (!writeFull(sockfd, message.data(), size) || !readFull(sockfd, reply.data(), size))
+        {
+            perror("pingpong");
+            exit(1);
+        }
+        if (i >= warmup)
+        {
+            samples->push_back(benchNowNanos() - start);
+        }
+    }
+    ::close(sockfd);
+}
+
+static void runCase(TcpServer &server, uint16_t port, size_t size, int connections, long rounds,
+                    int serverThreads, bool traced)
+{
+    server.resetLatencyStats();
+    std::vector<std::vector<int64_t>> perConnection(connections);
+    std::vector<std::thread> clients;
+    int64_t start = benchNowNanos();
+    for (int i = 0; i < connections; ++i)
+    {
+        clients.emplace_back(pingpong, port, size, rounds, &perConnection[i]);
+    }
+    for (std::thread &t : clients)
+    {
+        t.join();
+    }
+    double sec = (benchNowNanos() - start) / 1e9;
+
+    std::vector<int64_t> samples;
+    for (const std::vector<int64_t> &s : perConnection)
+    {
+        samples.insert(samples.end(), s.begin(), s.end());
+    }
+    LatencySummary latency = summarizeLatency(samples);
+    JsonLine line("pingpong_latency");
+    line.add("message_bytes", size)
+        .add("connections", connections)
+        .add("server_threads", serverThreads)
+        .add("round_trips", latency.count)
+        .add("seconds", sec)
+        .add("round_trips_per_sec", latency.count / sec)
+        .add("latency_us", latency);
+    if (traced)
+    {
+        // 预热的往返也在服务器的统计里
+        for (int stage = 0; stage < LatencyStats::kNumStages; ++stage)
+        {
+            std::string key = std::string("server_") +
+                              LatencyStats::stageName(static_cast<LatencyStats::Stage>(stage)) + "_us";
+            line.add(key.c_str(), summarizeLatency(server.latencySnapshot(static_cast<LatencyStats::Stage>(stage))));
+        }
+    }
+    line.print();
+}
+
+int main(int argc, char *argv[])
+{
+    long rounds = argc > 1 ? atol(argv[1]) : 20000;
+    int serverThreads = argc > 2 ? atoi(argv[2]) : 1;
+    uint16_t port = static_cast<uint16_t>(argc > 3 ? atoi(argv[3]) : 9990);
+    int traceEvery = argc > 4 ? atoi(argv[4]) : 0;
+    benchQuietLogging();
+
+    EventLoop loop;
+    TcpServer server(&loop, InetAddress(port), "PingpongServer");
+    server.setThreadNum(serverThreads);
+    server.setConnectionCallback(onConnection);
+    server.setMessageCallback(onMessage);
+    server.setLatencySampling(traceEvery);
+    server.start();
+
+    std::thread driver([&]()
+                       {
+                           const size_t sizes[] = {64, 1024, 16384};
+                           const int connectionCounts[] = {1, 8};
+                           for (int connections : connectionCounts)
+                           {
+                               for (size_t size : sizes)
+                               {
+                                   runCase(server, port, size, connections, rounds, serverThreads, traceEvery > 0);
+                               }
+                           }
+                           loop.quit();
+                       });
+    loop.loop();
+    driver.join();
+    return 0;
+}
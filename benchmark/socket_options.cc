@@ -0,0 +1,233 @@
+#include <mymuduo/TcpServer.h>
+#include <mymuduo/SocketOptions.h>
+#include <mymuduo/Logger.h>
+
+#include "BenchUtil.h"
+
+#include <string>
+#include <functional>
+#include <thread>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+#ifndef TCP_FASTOPEN_CONNECT
+#define TCP_FASTOPEN_CONNECT 30
+#endif
+
+/****************
+ * 服务器SocketOptions各项对小RPC延迟和建连速率的影响，每组选项输出一行:
+ *   rpc: 单个连接上客户端发64字节请求，服务器分两次send写回4字节头部和60字节消息体(常见的RPC写法)，
+ *        没有TCP_NODELAY时第二次写要等第一个包的ACK，会和客户端的延迟确认叠在一起
+ *   connect: 客户端connect -> 发1字节 -> 读到应答 -> 等服务器关闭 -> close，服务器应答后主动关闭，
+ *        用来观察TCP_DEFER_ACCEPT、TCP_FASTOPEN、SO_LINGER和backlog
+ * 客户端始终开启TCP_NODELAY，只比较服务器一侧的选项；fastopen一组的客户端使用TCP_FASTOPEN_CONNECT，
+ * 服务端需要net.ipv4.tcp_fastopen的第2位才会真正走TFO
+ * 用法: ./socket_options [每个阶段的测量秒数，默认1] [端口，默认9995]
+ * *************/
+
+static const size_t kRequestBytes = 64;
+static const size_t kHeaderBytes = 4;
+
+static void onConnection(const TcpConnectionPtr &) {}
+
+static void onMessage(const TcpConnectionPtr &conn, Buffer *buf, TimeStamp)
+{
+    while (buf->readAbleBytes() > 0)
+    {
+        if (buf->peek()[0] == 'c') // 建连测试: 应答之后由服务器关闭
+        {
+            buf->retrieveAll();
+            conn->send("c", 1);
+            conn->forceClose();
+            return;
+        }
+        if (buf->readAbleBytes() < kRequestBytes)
+        {
+            return;
+        }
+        std::string request(buf->peek(), kRequestBytes);
+        buf->retrieve(kRequestBytes);
+        conn->send(request.data(), kHeaderBytes);
+        conn->send(request.data() + kHeaderBytes, kRequestBytes - kHeaderBytes);
+    }
+}
+
+static int connectTo(uint16_t port, bool fastOpen)
+{
+    sockaddr_in addr = *InetAddress(port).getSockAddr();
+    int sockfd = ::socket(AF_INET, SOCK_STREAM, 0);
+    int on = 1;
+    ::setsockopt(sockfd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof on);
+    if (fastOpen)
+    {
+        ::setsockopt(sockfd, IPPROTO_TCP, TCP_FASTOPEN_CONNECT, &on, sizeof on);
+    }
+    if (::connect(sockfd, (sockaddr *)&addr, sizeof addr) < 0)
+    {
+        perror("connect");
+        exit(1);
+    }
+    return sockfd;
+}
+
+static void runRpc(uint16_t port, double seconds, JsonLine &result)
+{
+    int sockfd = connectTo(port, false);
+    char request[kRequestBytes];
+    char response[kRequestBytes];
+    for (size_t i = 0; i < kRequestBytes; ++i)
+    {
+        request[i] = 'r';
+    }
+    std::vector<int64_t> samples;
+    int64_t start = benchNowNanos();
+    int64_t deadline = start + static_cast<int64_t>(seconds * 1e9);
+    int64_t now = start;
+    while (now < deadline)
+    {
+        if (!writeFull(sockfd, request, kRequestBytes) || !readFull(sockfd, response, kRequestBytes))
+        {
+            perror("rpc");
+            exit(1);
+        }
+        int64_t end = benchNowNanos();
+        samples.push_back(end - now);
+        now = end;
+    }
+    ::close(sockfd);
+    double sec = (now - start) / 1e9;
+    long rounds = static_cast<long>(samples.size());
+    result.add("round_trips", rounds)
+        .add("round_trips_per_sec", rounds / sec)
+        .add("latency_us", summarizeLatency(samples));
+}
+
+static void runConnect(uint16_t port, double seconds, bool fastOpen, JsonLine &result)
+{
+    long connections = 0;
+    int64_t start = benchNowNanos();
+    int64_t deadline = start + static_cast<int64_t>(seconds * 1e9);
+    while (benchNowNanos() < deadline)
+    {
+        int sockfd = connectTo(port, fastOpen);
+        char reply;
+        if (!writeFull(sockfd, "c", 1) || !readFull(sockfd, &reply, 1))
+        {
+            perror("connect round");
+            exit(1);
+        }
+        // 等服务器先关闭(FIN或者linger为0时的RST)，客户端不留TIME_WAIT
+        ::read(sockfd, &reply, 1);
+        ::close(sockfd);
+        ++connections;
+    }
+    double sec = (benchNowNanos() - start) / 1e9;
+    result.add("connections_completed", connections)
+        .add("connections_per_sec", connections / sec);
+}
+
+struct Variant
+{
+    const char *name;
+    SocketOptions options;
+};
+
+static std::vector<Variant> variants()
+{
+    std::vector<Variant> result;
+    Variant v;
+    v.name = "default";
+    result.push_back(v);
+
+    v = Variant();
+    v.name = "nodelay";
+    v.options.tcpNoDelay = true;
+    result.push_back(v);
+
+    v = Variant();
+    v.name = "quickack";
+    v.options.quickAck = true;
+    result.push_back(v);
+
+    v = Variant();
+    v.name = "nodelay_quickack";
+    v.options.tcpNoDelay = true;
+    v.options.quickAck = true;
+    result.push_back(v);
+
+    v = Variant();
+    v.name = "buffers_16k";
+    v.options.tcpNoDelay = true;
+    v.options.sendBufferBytes = 16 * 1024;
+    v.options.recvBufferBytes = 16 * 1024;
+    result.push_back(v);
+
+    v = Variant();
+    v.name = "notsent_lowat_16k";
+    v.options.tcpNoDelay = true;
+    v.options.notSentLowat = 16 * 1024;
+    result.push_back(v);
+
+    v = Variant();
+    v.name = "linger_0";
+    v.options.tcpNoDelay = true;
+    v.options.lingerSeconds = 0;
+    result.push_back(v);
+
+    v = Variant();
+    v.name = "defer_accept";
+    v.options.tcpNoDelay = true;
+    v.options.deferAcceptSeconds = 1;
+    result.push_back(v);
+
+    v = Variant();
+    v.name = "fastopen";
+    v.options.tcpNoDelay = true;
+    v.options.fastOpenQueue = 256;
+    result.push_back(v);
+
+    v = Variant();
+    v.name = "backlog_64";
+    v.options.tcpNoDelay = true;
+    v.options.listenBacklog = 64;
+    result.push_back(v);
+    return result;
+}
+
+int main(int argc, char *argv[])
+{
+    double seconds = argc > 1 ? atof(argv[1]) : 1;
+    uint16_t port = static_cast<uint16_t>(argc > 2 ? atoi(argv[2]) : 9995);
+    benchQuietLogging();
+    // linger_0一组的连接以RST结束，客户端读到ECONNRESET，服务器没有错误日志；其余组保持ERROR
+
+    // 每组用一个新的TcpServer，监听socket的选项要在listen之前设置
+    for (const Variant &variant : variants())
+    {
+        EventLoop loop;
+        TcpServer server(&loop, InetAddress(port), "SocketOptionsServer");
+        server.setSocketOptions(variant.options);
+        server.setConnectionCallback(onConnection);
+        server.setMessageCallback(onMessage);
+        server.start();
+
+        std::thread driver([&]()
+                           {
+                               JsonLine result("socket_options");
+                               result.add("option", variant.name);
+                               runRpc(port, seconds, result);
+                               runConnect(port, seconds, variant.options.fastOpenQueue > 0, result);
+                               result.add("seconds", seconds).print();
+                               loop.quit();
+                           });
+        loop.loop();
+        driver.join();
+    }
+    return 0;
+}
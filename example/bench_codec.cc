@@ -0,0 +1,226 @@
+#include <mymuduo/TcpServer.h>
+#include <mymuduo/LengthHeaderCodec.h>
+#include <mymuduo/Crc32c.h>
+#include <mymuduo/Logger.h>
+
+#include <string>
+#include <functional>
+#include <thread>
+#include <chrono>
+#include <atomic>
+#include <iostream>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <endian.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+
+/****************
+ * LengthHeaderCodec解码吞吐，客户端通过loopback连续发送固定长度的帧(4字节长度头)，对比三种方式:
+ * view: LengthHeaderCodec回调指向inputBuffer_的指针/长度
+ * crc:  view + CRC32C尾部校验
+ * copy: 在messageCallback里逐帧retrieveAsString拿到一份拷贝(原来各服务手写分帧的做法)
+ * 用法: ./bench_codec [每组帧数，默认2000000] [端口，默认9985]
+ * 结果输出到stderr
+ * *************/
+
+enum Mode
+{
+    kView,
+    kCrc,
+    kCopy,
+};
+
+class SinkServer
+{
+public:
+    SinkServer(EventLoop *loop, const InetAddress &addr)
+        : server_(loop, addr, "SinkServer"),
+          plainCodec_(std::bind(&SinkServer::onFrame, this, std::placeholders::_1, std::placeholders::_2,
+                                std::placeholders::_3, std::placeholders::_4)),
+          crcCodec_(std::bind(&SinkServer::onFrame, this, std::placeholders::_1, std::placeholders::_2,
+                              std::placeholders::_3, std::placeholders::_4),
+                    4, LengthHeaderCodec::kDefaultMaxFrameSize, true),
+          mode_(kView),
+          expectFrames_(0),
+          frames_(0),
+          checksum_(0)
+    {
+        server_.setConnectionCallback(
+            std::bind(&SinkServer::onConnection, this, std::placeholders::_1));
+        server_.setMessageCallback(
+            std::bind(&SinkServer::onMessage, this,
+                      std::placeholders::_1, std::placeholders::_2, std::placeholders::_3));
+    }
+
+    void start() { server_.start(); }
+
+    // 由客户端线程在发起连接前设置
+    void setCase(Mode mode, long frames)
+    {
+        mode_ = mode;
+        expectFrames_ = frames;
+    }
+    long frames() const { return frames_; }
+
+private:
+    void onConnection(const TcpConnectionPtr &conn)
+    {
+        if (conn->connected())
+        {
+            frames_ = 0;
+        }
+    }
+
+    void onMessage(const TcpConnectionPtr &conn, Buffer *buf, TimeStamp receiveTime)
+    {
+        switch (mode_)
+        {
+        case kView:
+            plainCodec_.onMessage(conn, buf, receiveTime);
+            break;
+        case kCrc:
+            crcCodec_.onMessage(conn, buf, receiveTime);
+            break;
+        default:
+            while (buf->readAbleBytes() >= 4)
+            {
+                uint32_t be32;
+                ::memcpy(&be32, buf->peek(), sizeof be32);
+                size_t len = be32toh(be32);
+                if (buf->readAbleBytes() < 4 + len)
+                {
+                    break;
+                }
+                buf->retrieve(4);
+                std::string frame = buf->retrieveAsString(len);
+                onFrame(conn, frame.data(), frame.size(), receiveTime);
+            }
+            break;
+        }
+    }
+
+    void onFrame(const TcpConnectionPtr &conn, const char *data, size_t len, TimeStamp)
+    {
+        // 读一下帧的首尾，避免整个回调被优化掉
+        checksum_ += data[0] + data[len - 1];
+        if (++frames_ == expectFrames_)
+        {
+            conn->shutdown();
+        }
+    }
+
+    TcpServer server_;
+    LengthHeaderCodec plainCodec_;
+    LengthHeaderCodec crcCodec_;
+    std::atomic<Mode> mode_;
+    std::atomic_long expectFrames_;
+    std::atomic_long frames_;
+    long checksum_;
+};
+
+// 预先编码好一段包含多帧的数据，发送时重复写出
+static std::string encodeBatch(size_t payloadLen, bool crc, long *framesPerBatch)
+{
+    const size_t kBatchBytes = 1024 * 1024;
+    std::string payload(payloadLen, 'p');
+    uint32_t header = htobe32(static_cast<uint32_t>(payloadLen));
+    uint32_t trailer = htobe32(Crc32c::value(payload.data(), payload.size()));
+    std::string batch;
+    *framesPerBatch = 0;
+    while (batch.size() < kBatchBytes)
+    {
+        batch.append(reinterpret_cast<const char *>(&header), sizeof header);
+        batch.append(payload);
+        if (crc)
+        {
+            batch.append(reinterpret_cast<const char *>(&trailer), sizeof trailer);
+        }
+        ++*framesPerBatch;
+    }
+    return batch;
+}
+
+// 发送frames帧并等服务器收齐后关闭连接，返回发送的字节数
+static size_t runClient(uint16_t port, size_t payloadLen, bool crc, long frames)
+{
+    int sockfd = ::socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr = *InetAddress(port).getSockAddr();
+    if (::connect(sockfd, (sockaddr *)&addr, sizeof addr) < 0)
+    {
+        perror("connect");
+        exit(1);
+    }
+    long framesPerBatch = 0;
+    std::string batch = encodeBatch(payloadLen, crc, &framesPerBatch);
+    size_t frameLen = batch.size() / framesPerBatch;
+    size_t total = 0;
+    for (long sent = 0; sent < frames;)
+    {
+        long n = std::min(framesPerBatch, frames - sent);
+        const char *p = batch.data();
+        size_t remain = n * frameLen;
+        while (remain > 0)
+        {
+            ssize_t w = ::write(sockfd, p, remain);
+            if (w <= 0)
+            {
+                perror("write");
+                exit(1);
+            }
+            p += w;
+            remain -= w;
+        }
+        sent += n;
+        total += n * frameLen;
+    }
+    char c;
+    ::read(sockfd, &c, 1); // 服务器收齐全部帧后关闭写端
+    ::close(sockfd);
+    return total;
+}
+
+int main(int argc, char *argv[])
+{
+    long frames = argc > 1 ? atol(argv[1]) : 2000000;
+    uint16_t port = static_cast<uint16_t>(argc > 2 ? atoi(argv[2]) : 9985);
+    std::cout.setstate(std::ios::badbit); // 关掉库的日志
+
+    EventLoop loop;
+    SinkServer server(&loop, InetAddress(port));
+    server.start();
+
+    std::thread client([&]()
+                       {
+                           const size_t sizes[] = {64, 4096};
+                           const char *names[] = {"view", "crc", "copy"};
+                           fprintf(stderr, "crc32c hardware: %s\n", Crc32c::hardwareAccelerated() ? "yes" : "no");
+                           fprintf(stderr, "%6s %6s %14s %10s\n", "size", "mode", "frames/s", "MiB/s");
+                           for (size_t size : sizes)
+                           {
+                               // 大帧每组的数据量按比例减少，保持每组耗时相近
+                               long n = size > 64 ? frames / 16 : frames;
+                               for (int mode = kView; mode <= kCopy; ++mode)
+                               {
+                                   server.setCase(static_cast<Mode>(mode), n);
+                                   auto start = std::chrono::steady_clock::now();
+                                   size_t bytes = runClient(port, size, mode == kCrc, n);
+                                   double sec = std::chrono::duration<double>(
+                                                    std::chrono::steady_clock::now() - start)
+                                                    .count();
+                                   if (server.frames() != n)
+                                   {
+                                       fprintf(stderr, "FAIL: %ld of %ld frames decoded\n", server.frames(), n);
+                                   }
+                                   fprintf(stderr, "%6zu %6s %14.0f %10.1f\n", size, names[mode],
+                                           n / sec, bytes / sec / 1024 / 1024);
+                               }
+                           }
+                           loop.quit();
+                       });
+    loop.loop();
+    client.join();
+    return 0;
+}
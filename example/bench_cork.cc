@@ -0,0 +1,167 @@
+#include <mymuduo/TcpServer.h>
+#include <mymuduo/Logger.h>
+
+#include <string>
+#include <functional>
+#include <thread>
+#include <chrono>
+#include <vector>
+#include <atomic>
+#include <fstream>
+#include <iostream>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+
+/****************
+ * 流水线小请求场景下合并写的效果:
+ * 客户端一次写入depth个16字节请求，服务器在一次messageCallback里逐个send 16字节响应，
+ * 对比开启和关闭TcpConnection::setCorkWrites时，服务器每个请求的写系统调用次数
+ * 系统调用次数取自/proc/thread-self/io的syscw(write/writev都会计入)
+ * 用法: ./bench_cork [请求总数，默认200000] [流水线深度，默认20] [端口，默认9984]
+ * 结果输出到stderr，库的日志被关掉，否则日志的write也会计入syscw
+ * *************/
+
+static const size_t kMessageLen = 16;
+
+// 当前线程累计的写系统调用次数
+static long threadWriteSyscalls()
+{
+    std::ifstream io("/proc/thread-self/io");
+    std::string key;
+    long value = 0;
+    while (io >> key >> value)
+    {
+        if (key == "syscw:")
+        {
+            return value;
+        }
+    }
+    return -1;
+}
+
+class PipelineServer
+{
+public:
+    PipelineServer(EventLoop *loop, const InetAddress &addr)
+        : server_(loop, addr, "PipelineServer"),
+          cork_(false),
+          syscallStart_(0),
+          syscalls_(0)
+    {
+        server_.setConnectionCallback(
+            std::bind(&PipelineServer::onConnection, this, std::placeholders::_1));
+        server_.setMessageCallback(
+            std::bind(&PipelineServer::onMessage, this,
+                      std::placeholders::_1, std::placeholders::_2, std::placeholders::_3));
+    }
+
+    void start() { server_.start(); }
+    void setCork(bool on) { cork_ = on; }
+    long syscalls() const { return syscalls_; }
+
+private:
+    void onConnection(const TcpConnectionPtr &conn)
+    {
+        if (conn->connected())
+        {
+            // 关掉Nagle，否则不合并时一次回调里的多个小响应会等待对端的延迟确认
+            conn->setTcpNoDelay(true);
+            conn->setCorkWrites(cork_);
+            syscallStart_ = threadWriteSyscalls();
+        }
+        else
+        {
+            syscalls_ = threadWriteSyscalls() - syscallStart_;
+        }
+    }
+
+    void onMessage(const TcpConnectionPtr &conn, Buffer *buf, TimeStamp)
+    {
+        while (buf->readAbleBytes() >= kMessageLen)
+        {
+            conn->send(std::string(buf->peek(), kMessageLen));
+            buf->retrieve(kMessageLen);
+        }
+    }
+
+    TcpServer server_;
+    std::atomic_bool cork_; // 由客户端线程在发起连接前设置
+    long syscallStart_;
+    std::atomic_long syscalls_;
+};
+
+static bool readFull(int fd, char *buf, size_t len)
+{
+    while (len > 0)
+    {
+        ssize_t n = ::read(fd, buf, len);
+        if (n <= 0)
+        {
+            return false;
+        }
+        buf += n;
+        len -= n;
+    }
+    return true;
+}
+
+static void runClient(uint16_t port, long requests, int depth)
+{
+    int sockfd = ::socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr = *InetAddress(port).getSockAddr();
+    if (::connect(sockfd, (sockaddr *)&addr, sizeof addr) < 0)
+    {
+        perror("connect");
+        exit(1);
+    }
+    std::string batch(kMessageLen * depth, 'q');
+    std::vector<char> reply(batch.size());
+    for (long done = 0; done < requests; done += depth)
+    {
+        if (::write(sockfd, batch.data(), batch.size()) != static_cast<ssize_t>(batch.size()) ||
+            !readFull(sockfd, reply.data(), reply.size()))
+        {
+            perror("pipeline");
+            exit(1);
+        }
+    }
+    ::close(sockfd);
+}
+
+int main(int argc, char *argv[])
+{
+    long requests = argc > 1 ? atol(argv[1]) : 200000;
+    int depth = argc > 2 ? atoi(argv[2]) : 20;
+    uint16_t port = static_cast<uint16_t>(argc > 3 ? atoi(argv[3]) : 9984);
+    requests = (requests + depth - 1) / depth * depth;
+    std::cout.setstate(std::ios::badbit); // Logger输出到std::cout，置为失败状态后不再产生write调用
+
+    EventLoop loop;
+    PipelineServer server(&loop, InetAddress(port));
+    server.start();
+
+    std::thread client([&]()
+                       {
+                           for (int cork = 0; cork < 2; ++cork)
+                           {
+                               server.setCork(cork == 1);
+                               auto start = std::chrono::steady_clock::now();
+                               runClient(port, requests, depth);
+                               double sec = std::chrono::duration<double>(
+                                                std::chrono::steady_clock::now() - start)
+                                                .count();
+                               // 等服务器处理完连接关闭，拿到系统调用计数
+                               std::this_thread::sleep_for(std::chrono::milliseconds(200));
+                               fprintf(stderr, "cork=%d depth=%d %.0f req/s, %.3f write syscalls/request\n",
+                                       cork, depth, requests / sec,
+                                       static_cast<double>(server.syscalls()) / requests);
+                           }
+                           loop.quit();
+                       });
+    loop.loop();
+    client.join();
+    return 0;
+}
@@ -0,0 +1,196 @@
+#include <mymuduo/HttpServer.h>
+#include <mymuduo/Logger.h>
+
+#include <string>
+#include <thread>
+#include <chrono>
+#include <vector>
+#include <atomic>
+#include <iostream>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+/****************
+ * wrk风格的loopback压测: 若干客户端线程各自持有多条长连接，每条连接一次发出depth个管道化请求，
+ * 收齐应答后再发下一批，统计固定时长内的请求数
+ * /plaintext返回"Hello, World!"，/json返回{"message":"Hello, World!"}
+ * 用法: ./bench_http [秒数，默认5] [连接数，默认64] [客户端线程数，默认4] [服务器IO线程数，默认4] [端口，默认9986]
+ * 结果输出到stderr
+ * *************/
+
+static void onRequest(const HttpRequest &req, HttpResponse *resp)
+{
+    if (req.path() == "/plaintext")
+    {
+        resp->setStatusCode(HttpResponse::k200Ok);
+        resp->setContentType("text/plain");
+        resp->setBody("Hello, World!");
+    }
+    else if (req.path() == "/json")
+    {
+        resp->setStatusCode(HttpResponse::k200Ok);
+        resp->setContentType("application/json");
+        resp->setBody("{\"message\":\"Hello, World!\"}");
+    }
+    else
+    {
+        resp->setStatusCode(HttpResponse::k404NotFound);
+    }
+}
+
+// 客户端的一条连接，统计已经收齐的应答数
+struct ClientConn
+{
+    int fd;
+    std::string input;
+};
+
+// 从input开头取出完整的应答，返回取出的个数
+static int consumeResponses(std::string *input)
+{
+    int count = 0;
+    size_t pos = 0;
+    while (true)
+    {
+        size_t headerEnd = input->find("\r\n\r\n", pos);
+        if (headerEnd == std::string::npos)
+        {
+            break;
+        }
+        size_t cl = input->find("Content-Length: ", pos);
+        if (cl == std::string::npos || cl > headerEnd)
+        {
+            fprintf(stderr, "bad response\n");
+            exit(1);
+        }
+        size_t bodyLen = strtoul(input->c_str() + cl + 16, nullptr, 10);
+        size_t next = headerEnd + 4 + bodyLen;
+        if (next > input->size())
+        {
+            break;
+        }
+        pos = next;
+        ++count;
+    }
+    input->erase(0, pos);
+    return count;
+}
+
+static long runClientThread(uint16_t port, const std::string &path, int conns, int depth,
+                            const std::atomic_bool &stop)
+{
+    std::string request = "GET " + path + " HTTP/1.1\r\nHost: localhost\r\nUser-Agent: bench_http\r\n\r\n";
+    std::string batch;
+    for (int i = 0; i < depth; ++i)
+    {
+        batch += request;
+    }
+    std::vector<ClientConn> clients(conns);
+    for (ClientConn &c : clients)
+    {
+        c.fd = ::socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in addr = *InetAddress(port).getSockAddr();
+        if (::connect(c.fd, (sockaddr *)&addr, sizeof addr) < 0)
+        {
+            perror("connect");
+            exit(1);
+        }
+        int one = 1;
+        ::setsockopt(c.fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof one);
+    }
+
+    long completed = 0;
+    char buf[64 * 1024];
+    while (!stop)
+    {
+        for (ClientConn &c : clients)
+        {
+            if (::write(c.fd, batch.data(), batch.size()) != static_cast<ssize_t>(batch.size()))
+            {
+                perror("write");
+                exit(1);
+            }
+        }
+        for (ClientConn &c : clients)
+        {
+            int got = 0;
+            while (got < depth)
+            {
+                ssize_t n = ::read(c.fd, buf, sizeof buf);
+                if (n <= 0)
+                {
+                    perror("read");
+                    exit(1);
+                }
+                c.input.append(buf, n);
+                got += consumeResponses(&c.input);
+            }
+            completed += got;
+        }
+    }
+    for (ClientConn &c : clients)
+    {
+        ::close(c.fd);
+    }
+    return completed;
+}
+
+int main(int argc, char *argv[])
+{
+    int seconds = argc > 1 ? atoi(argv[1]) : 5;
+    int conns = argc > 2 ? atoi(argv[2]) : 64;
+    int clientThreads = argc > 3 ? atoi(argv[3]) : 4;
+    int ioThreads = argc > 4 ? atoi(argv[4]) : 4;
+    uint16_t port = static_cast<uint16_t>(argc > 5 ? atoi(argv[5]) : 9986);
+    std::cout.setstate(std::ios::badbit); // 关掉库的日志
+
+    EventLoop loop;
+    HttpServer server(&loop, InetAddress(port), "HttpBench");
+    server.setHttpCallback(onRequest);
+    server.setThreadNum(ioThreads);
+    server.start();
+
+    std::thread driver([&]()
+                       {
+                           const char *paths[] = {"/plaintext", "/json"};
+                           const int depths[] = {1, 16};
+                           fprintf(stderr, "%d connections, %d client threads, %d server io threads\n",
+                                   conns, clientThreads, ioThreads);
+                           fprintf(stderr, "%12s %6s %14s\n", "path", "depth", "requests/s");
+                           for (const char *path : paths)
+                           {
+                               for (int depth : depths)
+                               {
+                                   std::atomic_bool stop(false);
+                                   std::atomic_long total(0);
+                                   std::vector<std::thread> threads;
+                                   auto start = std::chrono::steady_clock::now();
+                                   for (int i = 0; i < clientThreads; ++i)
+                                   {
+                                       threads.emplace_back([&]()
+                                                            { total += runClientThread(port, path, conns / clientThreads,
+                                                                                       depth, stop); });
+                                   }
+                                   std::this_thread::sleep_for(std::chrono::seconds(seconds));
+                                   stop = true;
+                                   for (std::thread &t : threads)
+                                   {
+                                       t.join();
+                                   }
+                                   double sec = std::chrono::duration<double>(
+                                                    std::chrono::steady_clock::now() - start)
+                                                    .count();
+                                   fprintf(stderr, "%12s %6d %14.0f\n", path, depth, total / sec);
+                               }
+                           }
+                           loop.quit();
+                       });
+    loop.loop();
+    driver.join();
+    return 0;
+}
@@ -0,0 +1,137 @@
+#include <mymuduo/Logger.h>
+#include <mymuduo/AsyncLogging.h>
+#include <mymuduo/LogFile.h>
+
+#include <thread>
+#include <chrono>
+#include <vector>
+#include <functional>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <glob.h>
+
+/****************
+ * 多线程写日志的吞吐，对比两种输出:
+ * sync:  默认输出，调用线程直接写std::cout并逐行刷新
+ * async: AsyncLogging，调用线程只拷贝到缓冲区，后台线程批量write
+ * file:  LogFile直接作为输出，调用线程在锁内写stdio缓冲区，64M滚动一次
+ * async+file: AsyncLogging的后台线程写LogFile
+ * 日志文件写在/tmp/bench_logging.*，结束后删除
+ * 输出每个线程每秒写入的行数(前端耗时)以及包括后台写完在内的总吞吐，
+ * 最后是低于运行期阈值的LOG_DEBUG语句的单次开销
+ * 用法: ./bench_logging [每个线程的行数，默认200000] > /dev/null
+ * 日志写到stdout，应重定向到/dev/null或文件，结果输出到stderr
+ * *************/
+
+static void produce(long lines, double *seconds)
+{
+    auto start = std::chrono::steady_clock::now();
+    for (long i = 0; i < lines; ++i)
+    {
+        LOG_INFO("bench_logging line %ld from a worker thread, payload %d %s", i, 42, "abcdefghijklmnop");
+    }
+    *seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static void runCase(const char *name, int threads, long lines, AsyncLogging *async)
+{
+    std::vector<std::thread> workers;
+    std::vector<double> seconds(threads);
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < threads; ++i)
+    {
+        workers.emplace_back(produce, lines, &seconds[i]);
+    }
+    for (std::thread &t : workers)
+    {
+        t.join();
+    }
+    if (async)
+    {
+        async->flush();
+    }
+    double total = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    double slowest = 0;
+    for (double s : seconds)
+    {
+        slowest = std::max(slowest, s);
+    }
+    fprintf(stderr, "%-10s threads=%d %12.0f lines/s/thread %12.0f lines/s total\n",
+            name, threads, lines / slowest, lines * threads / total);
+}
+
+// 关闭的日志语句应该只剩一次分支，参数也不会求值
+static void disabledCost(long lines)
+{
+    Logger::setLogLevel(INFO);
+    long evaluated = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (long i = 0; i < lines; ++i)
+    {
+        LOG_DEBUG("disabled line %ld %ld", i, ++evaluated);
+    }
+    double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    fprintf(stderr, "disabled LOG_DEBUG %.2f ns/statement, arguments evaluated %ld times\n",
+            sec * 1e9 / lines, evaluated);
+}
+
+int main(int argc, char *argv[])
+{
+    long lines = argc > 1 ? atol(argv[1]) : 200000;
+    const int threadCounts[] = {1, 2, 4, 8};
+
+    for (int threads : threadCounts)
+    {
+        runCase("sync", threads, lines, nullptr);
+    }
+
+    AsyncLogging async;
+    async.start();
+    Logger::instance().setOutput(std::bind(&AsyncLogging::append, &async,
+                                           std::placeholders::_1, std::placeholders::_2));
+    Logger::instance().setFlush(std::bind(&AsyncLogging::flush, &async));
+    for (int threads : threadCounts)
+    {
+        runCase("async", threads, lines, &async);
+    }
+    async.stop();
+    fprintf(stderr, "async dropped %llu lines\n", static_cast<unsigned long long>(async.droppedLines()));
+
+    {
+        LogFile file("/tmp/bench_logging", 64 * 1024 * 1024);
+        Logger::instance().setOutput(std::bind(&LogFile::append, &file,
+                                               std::placeholders::_1, std::placeholders::_2));
+        Logger::instance().setFlush(std::bind(&LogFile::flush, &file));
+        for (int threads : threadCounts)
+        {
+            runCase("file", threads, lines, nullptr);
+        }
+
+        AsyncLogging asyncFile;
+        asyncFile.setSink(std::bind(&LogFile::append, &file, std::placeholders::_1, std::placeholders::_2),
+                          std::bind(&LogFile::flush, &file));
+        asyncFile.start();
+        Logger::instance().setOutput(std::bind(&AsyncLogging::append, &asyncFile,
+                                               std::placeholders::_1, std::placeholders::_2));
+        Logger::instance().setFlush(std::bind(&AsyncLogging::flush, &asyncFile));
+        for (int threads : threadCounts)
+        {
+            runCase("async+file", threads, lines, &asyncFile);
+        }
+        asyncFile.stop();
+        Logger::instance().setOutput(Logger::OutputFunc([](const char *, size_t) {}));
+    }
+    glob_t files;
+    if (::glob("/tmp/bench_logging.*.log", 0, nullptr, &files) == 0)
+    {
+        fprintf(stderr, "%zu log files written\n", files.gl_pathc);
+        for (size_t i = 0; i < files.gl_pathc; ++i)
+        {
+            ::unlink(files.gl_pathv[i]);
+        }
+        globfree(&files);
+    }
+    disabledCost(lines * 100);
+    return 0;
+}
@@ -0,0 +1,174 @@
+#include <mymuduo/RpcServer.h>
+#include <mymuduo/RpcClient.h>
+#include <mymuduo/TcpClient.h>
+#include <mymuduo/EventLoopThread.h>
+#include <mymuduo/Logger.h>
+
+#include <string>
+#include <functional>
+#include <thread>
+#include <chrono>
+#include <vector>
+#include <future>
+#include <algorithm>
+#include <iostream>
+#include <stdio.h>
+#include <stdlib.h>
+
+/****************
+ * 单连接上的RPC吞吐和延迟: 客户端在一条连接上保持1/16/256个未完成的调用，
+ * 每收到一个应答立即补发一个，对比处理函数在loop线程中执行和交给offload线程池执行
+ * 用法: ./bench_rpc [每组调用数，默认200000] [端口，默认9987]
+ * 结果输出到stderr
+ * *************/
+
+static const size_t kPayloadLen = 64;
+
+static int64_t nowNanos()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+// 保持inflight个并发调用直到完成total个
+class CallDriver
+{
+public:
+    CallDriver(RpcClient *client, const std::string &method, long total, int inflight)
+        : client_(client), method_(method), payload_(kPayloadLen, 'r'),
+          total_(total), inflight_(inflight), issued_(0), done_(0), failed_(0)
+    {
+        latencies_.reserve(total);
+    }
+
+    // 在客户端loop线程中调用
+    void start()
+    {
+        for (int i = 0; i < inflight_ && issued_ < total_; ++i)
+        {
+            issue();
+        }
+    }
+
+    std::future<void> finished() { return finished_.get_future(); }
+    std::vector<int64_t> &latencies() { return latencies_; }
+    long failed() const { return failed_; }
+
+private:
+    void issue()
+    {
+        ++issued_;
+        int64_t start = nowNanos();
+        client_->call(method_, payload_, [this, start](RpcStatus status, const StringPiece &)
+                      { onResponse(status, start); });
+    }
+
+    void onResponse(RpcStatus status, int64_t start)
+    {
+        latencies_.push_back(nowNanos() - start);
+        if (status != kRpcOk)
+        {
+            ++failed_;
+        }
+        if (++done_ == total_)
+        {
+            finished_.set_value();
+        }
+        else if (issued_ < total_)
+        {
+            issue();
+        }
+    }
+
+    RpcClient *client_;
+    std::string method_;
+    std::string payload_;
+    long total_;
+    int inflight_;
+    long issued_;
+    long done_;
+    long failed_;
+    std::vector<int64_t> latencies_;
+    std::promise<void> finished_;
+};
+
+int main(int argc, char *argv[])
+{
+    long calls = argc > 1 ? atol(argv[1]) : 200000;
+    uint16_t port = static_cast<uint16_t>(argc > 2 ? atoi(argv[2]) : 9987);
+    std::cout.setstate(std::ios::badbit); // 关掉库的日志
+
+    EventLoop loop;
+    RpcServer server(&loop, InetAddress(port), "RpcBench");
+    server.setThreadNum(1);
+    server.setOffloadThreadNum(4);
+    RpcServer::RpcHandler echo = [](const StringPiece &request, const RpcResponder &responder)
+    { responder.reply(request); };
+    server.registerMethod("echo", echo, RpcServer::kInLoop);
+    server.registerMethod("echo.offload", echo, RpcServer::kOffload);
+    server.setConnectionCallback([](const TcpConnectionPtr &conn)
+                                 {
+                                     if (conn->connected())
+                                     {
+                                         conn->setTcpNoDelay(true);
+                                     }
+                                 });
+    server.start();
+
+    std::thread driver([&]()
+                       {
+                           EventLoopThread clientThread;
+                           EventLoop *clientLoop = clientThread.startLoop();
+                           RpcClient client(clientLoop);
+                           TcpClient tcpClient(clientLoop, InetAddress(port), "RpcBenchClient");
+                           std::promise<void> connected;
+                           tcpClient.setConnectionCallback([&](const TcpConnectionPtr &conn)
+                                                           {
+                                                               client.onConnection(conn);
+                                                               if (conn->connected())
+                                                               {
+                                                                   conn->setTcpNoDelay(true);
+                                                                   connected.set_value();
+                                                               }
+                                                           });
+                           tcpClient.setMessageCallback(std::bind(&RpcClient::onMessage, &client, std::placeholders::_1,
+                                                                  std::placeholders::_2, std::placeholders::_3));
+                           // 一批应答回调中补发的多个调用合并成一次写
+                           tcpClient.setCorkWrites(true);
+                           tcpClient.connect();
+                           connected.get_future().wait();
+
+                           const char *methods[] = {"echo", "echo.offload"};
+                           const int inflights[] = {1, 16, 256};
+                           fprintf(stderr, "%14s %9s %12s %10s %10s\n", "method", "inflight", "calls/s",
+                                   "p50 us", "p99 us");
+                           for (const char *method : methods)
+                           {
+                               for (int inflight : inflights)
+                               {
+                                   // 单个在途调用时每次都是一个完整的往返，减少调用数以控制耗时
+                                   long total = inflight == 1 ? calls / 4 : calls;
+                                   CallDriver callDriver(&client, method, total, inflight);
+                                   std::future<void> finished = callDriver.finished();
+                                   auto start = std::chrono::steady_clock::now();
+                                   clientLoop->runInLoop(std::bind(&CallDriver::start, &callDriver));
+                                   finished.wait();
+                                   double sec = std::chrono::duration<double>(
+                                                    std::chrono::steady_clock::now() - start)
+                                                    .count();
+                                   std::vector<int64_t> &lat = callDriver.latencies();
+                                   std::sort(lat.begin(), lat.end());
+                                   fprintf(stderr, "%14s %9d %12.0f %10.1f %10.1f%s\n", method, inflight,
+                                           total / sec, lat[lat.size() / 2] / 1e3, lat[lat.size() * 99 / 100] / 1e3,
+                                           callDriver.failed() > 0 ? "  (failures)" : "");
+                               }
+                           }
+                           tcpClient.disconnect();
+                           std::this_thread::sleep_for(std::chrono::milliseconds(100));
+                           loop.quit();
+                       });
+    loop.loop();
+    driver.join();
+    return 0;
+}
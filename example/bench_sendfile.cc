@@ -0,0 +1,166 @@
+#include <mymuduo/TcpServer.h>
+#include <mymuduo/Logger.h>
+
+#include <string>
+#include <functional>
+#include <thread>
+#include <chrono>
+#include <vector>
+#include <atomic>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+/****************
+ * 通过loopback发送一个大文件，对比两种方式的吞吐:
+ * sendfile: TcpConnection::sendFile，数据不经过用户态
+ * copy:     每次pread 1M数据到string再send，数据在用户态拷贝两次
+ * 用法: ./bench_sendfile [文件大小MB，默认1024] [端口，默认9981] > /dev/null
+ * 结果输出到stderr
+ * *************/
+
+static const size_t kChunkSize = 1024 * 1024;
+
+class FileServer
+{
+public:
+    FileServer(EventLoop *loop, const InetAddress &addr, int fd, size_t fileSize)
+        : server_(loop, addr, "FileServer"),
+          fd_(fd),
+          fileSize_(fileSize),
+          useSendfile_(true),
+          offset_(0)
+    {
+        server_.setConnectionCallback(
+            std::bind(&FileServer::onConnection, this, std::placeholders::_1));
+        server_.setWriteCompleteCallback(
+            std::bind(&FileServer::onWriteComplete, this, std::placeholders::_1));
+    }
+
+    void start() { server_.start(); }
+    void setUseSendfile(bool on) { useSendfile_ = on; }
+
+private:
+    void onConnection(const TcpConnectionPtr &conn)
+    {
+        if (!conn->connected())
+        {
+            return;
+        }
+        offset_ = 0;
+        if (useSendfile_)
+        {
+            conn->sendFile(fd_, 0, fileSize_);
+            offset_ = fileSize_;
+        }
+        else
+        {
+            sendChunk(conn);
+        }
+    }
+
+    void onWriteComplete(const TcpConnectionPtr &conn)
+    {
+        if (offset_ < fileSize_)
+        {
+            sendChunk(conn);
+        }
+        else
+        {
+            conn->shutdown();
+        }
+    }
+
+    void sendChunk(const TcpConnectionPtr &conn)
+    {
+        std::string chunk(std::min(kChunkSize, fileSize_ - offset_), '\0');
+        ssize_t n = ::pread(fd_, &chunk[0], chunk.size(), offset_);
+        if (n <= 0)
+        {
+            conn->shutdown();
+            return;
+        }
+        offset_ += n;
+        conn->send(chunk);
+    }
+
+    TcpServer server_;
+    int fd_;
+    size_t fileSize_;
+    std::atomic_bool useSendfile_; // 由客户端线程在发起连接前切换
+    size_t offset_;
+};
+
+// 阻塞方式读完服务器发来的全部数据，返回读到的字节数
+static size_t fetch(uint16_t port)
+{
+    int sockfd = ::socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr = *InetAddress(port).getSockAddr();
+    if (::connect(sockfd, (sockaddr *)&addr, sizeof addr) < 0)
+    {
+        perror("connect");
+        exit(1);
+    }
+    std::vector<char> buf(256 * 1024);
+    size_t total = 0;
+    ssize_t n;
+    while ((n = ::read(sockfd, buf.data(), buf.size())) > 0)
+    {
+        total += n;
+    }
+    ::close(sockfd);
+    return total;
+}
+
+int main(int argc, char *argv[])
+{
+    size_t fileSize = (argc > 1 ? atol(argv[1]) : 1024) * 1024 * 1024;
+    uint16_t port = static_cast<uint16_t>(argc > 2 ? atoi(argv[2]) : 9981);
+
+    char path[] = "/tmp/bench_sendfile_XXXXXX";
+    int fd = ::mkstemp(path);
+    if (fd < 0)
+    {
+        perror("mkstemp");
+        return 1;
+    }
+    ::unlink(path);
+    std::string pattern(kChunkSize, 'x');
+    for (size_t written = 0; written < fileSize; written += pattern.size())
+    {
+        if (::write(fd, pattern.data(), std::min(pattern.size(), fileSize - written)) < 0)
+        {
+            perror("write");
+            return 1;
+        }
+    }
+
+    EventLoop loop;
+    FileServer server(&loop, InetAddress(port), fd, fileSize);
+    server.start();
+
+    std::thread client([&]()
+                       {
+                           const char *modes[] = {"sendfile", "copy"};
+                           for (int i = 0; i < 2; ++i)
+                           {
+                               server.setUseSendfile(i == 0);
+                               auto start = std::chrono::steady_clock::now();
+                               size_t bytes = fetch(port);
+                               double sec = std::chrono::duration<double>(
+                                                std::chrono::steady_clock::now() - start)
+                                                .count();
+                               fprintf(stderr, "%-8s %zu bytes in %.3f s, %.1f MiB/s\n",
+                                       modes[i], bytes, sec, bytes / sec / 1024 / 1024);
+                           }
+                           loop.quit();
+                       });
+    loop.loop();
+    client.join();
+    ::close(fd);
+    return 0;
+}
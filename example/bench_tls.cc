@@ -0,0 +1,222 @@
+#include <mymuduo/TcpServer.h>
+#include <mymuduo/TlsContext.h>
+#include <mymuduo/Logger.h>
+
+#include <string>
+#include <functional>
+#include <thread>
+#include <chrono>
+#include <vector>
+#include <atomic>
+#include <iostream>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <openssl/ssl.h>
+#include <openssl/evp.h>
+#include <openssl/pem.h>
+#include <openssl/x509.h>
+
+/****************
+ * loopback上用sendFile批量发送一个文件，对比三种方式的吞吐和服务器loop线程的CPU时间:
+ * plain: 不加密，sendfile
+ * tls:   用户态TLS，文件内容pread出来经SSL_write加密
+ * ktls:  握手后由内核加密，TcpConnection照常走sendfile；内核没有tls模块时会退回用户态，输出中ktls=0
+ * 客户端是阻塞的OpenSSL客户端，解密在客户端线程中完成
+ * 用法: ./bench_tls [文件大小MB，默认512] [端口，默认9989] > /dev/null
+ * 结果输出到stderr
+ * *************/
+
+static double threadCpuSeconds()
+{
+    timespec ts;
+    ::clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// 生成自签名的EC证书，写到临时文件里交给TlsContext
+static void makeCertificate(std::string *certFile, std::string *keyFile)
+{
+    EVP_PKEY *key = EVP_EC_gen("prime256v1");
+    X509 *cert = X509_new();
+    ASN1_INTEGER_set(X509_get_serialNumber(cert), 1);
+    X509_gmtime_adj(X509_getm_notBefore(cert), 0);
+    X509_gmtime_adj(X509_getm_notAfter(cert), 3600);
+    X509_set_pubkey(cert, key);
+    X509_NAME *name = X509_get_subject_name(cert);
+    X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC, (const unsigned char *)"localhost", -1, -1, 0);
+    X509_set_issuer_name(cert, name);
+    X509_sign(cert, key, EVP_sha256());
+
+    char certPath[] = "/tmp/bench_tls_cert_XXXXXX";
+    char keyPath[] = "/tmp/bench_tls_key_XXXXXX";
+    FILE *cf = fdopen(::mkstemp(certPath), "w");
+    FILE *kf = fdopen(::mkstemp(keyPath), "w");
+    PEM_write_X509(cf, cert);
+    PEM_write_PrivateKey(kf, key, nullptr, nullptr, 0, nullptr, nullptr);
+    fclose(cf);
+    fclose(kf);
+    X509_free(cert);
+    EVP_PKEY_free(key);
+    *certFile = certPath;
+    *keyFile = keyPath;
+}
+
+class FileServer
+{
+public:
+    FileServer(EventLoop *loop, const InetAddress &addr, int fd, size_t fileSize,
+               const std::shared_ptr<TlsContext> &tls)
+        : server_(loop, addr, "FileServer"),
+          fd_(fd),
+          fileSize_(fileSize),
+          cpuStart_(0),
+          cpuSeconds_(0),
+          kernelTls_(false)
+    {
+        if (tls)
+        {
+            server_.setTlsContext(tls);
+        }
+        server_.setConnectionCallback(
+            std::bind(&FileServer::onConnection, this, std::placeholders::_1));
+        server_.setWriteCompleteCallback(
+            std::bind(&FileServer::onWriteComplete, this, std::placeholders::_1));
+    }
+
+    void start() { server_.start(); }
+    double cpuSeconds() const { return cpuSeconds_; }
+    bool kernelTls() const { return kernelTls_; }
+
+private:
+    void onConnection(const TcpConnectionPtr &conn)
+    {
+        if (!conn->connected())
+        {
+            return;
+        }
+        kernelTls_ = conn->kernelTlsSend();
+        cpuStart_ = threadCpuSeconds();
+        conn->sendFile(fd_, 0, fileSize_);
+    }
+
+    void onWriteComplete(const TcpConnectionPtr &conn)
+    {
+        if (conn->pendingOutputBytes() == 0)
+        {
+            cpuSeconds_ = threadCpuSeconds() - cpuStart_;
+            conn->shutdown();
+        }
+    }
+
+    TcpServer server_;
+    int fd_;
+    size_t fileSize_;
+    double cpuStart_;
+    std::atomic<double> cpuSeconds_;
+    std::atomic_bool kernelTls_;
+};
+
+static size_t fetch(uint16_t port, SSL_CTX *ctx)
+{
+    int sockfd = ::socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr = *InetAddress(port).getSockAddr();
+    if (::connect(sockfd, (sockaddr *)&addr, sizeof addr) < 0)
+    {
+        perror("connect");
+        exit(1);
+    }
+    std::vector<char> buf(256 * 1024);
+    size_t total = 0;
+    if (ctx == nullptr)
+    {
+        ssize_t n;
+        while ((n = ::read(sockfd, buf.data(), buf.size())) > 0)
+        {
+            total += n;
+        }
+    }
+    else
+    {
+        SSL *ssl = SSL_new(ctx);
+        SSL_set_fd(ssl, sockfd);
+        if (SSL_connect(ssl) != 1)
+        {
+            fprintf(stderr, "SSL_connect failed: %s\n", TlsContext::lastError().c_str());
+            exit(1);
+        }
+        int n;
+        while ((n = SSL_read(ssl, buf.data(), static_cast<int>(buf.size()))) > 0)
+        {
+            total += n;
+        }
+        SSL_free(ssl);
+    }
+    ::close(sockfd);
+    return total;
+}
+
+int main(int argc, char *argv[])
+{
+    size_t fileSize = (argc > 1 ? atol(argv[1]) : 512) * 1024 * 1024;
+    uint16_t port = static_cast<uint16_t>(argc > 2 ? atoi(argv[2]) : 9989);
+    std::cout.setstate(std::ios::badbit);
+
+    char path[] = "/tmp/bench_tls_XXXXXX";
+    int fd = ::mkstemp(path);
+    ::unlink(path);
+    std::string pattern(1024 * 1024, 'x');
+    for (size_t written = 0; written < fileSize; written += pattern.size())
+    {
+        if (::write(fd, pattern.data(), std::min(pattern.size(), fileSize - written)) < 0)
+        {
+            perror("write");
+            return 1;
+        }
+    }
+
+    std::string certFile, keyFile;
+    makeCertificate(&certFile, &keyFile);
+    std::shared_ptr<TlsContext> userTls = std::make_shared<TlsContext>(TlsContext::kServer);
+    std::shared_ptr<TlsContext> kernelTls = std::make_shared<TlsContext>(TlsContext::kServer);
+    userTls->useCertificateFile(certFile, keyFile);
+    kernelTls->useCertificateFile(certFile, keyFile);
+    kernelTls->setKernelTls(true);
+    ::unlink(certFile.c_str());
+    ::unlink(keyFile.c_str());
+    TlsContext client(TlsContext::kClient);
+    client.setVerifyPeer(false);
+
+    EventLoop loop;
+    FileServer plain(&loop, InetAddress(port), fd, fileSize, nullptr);
+    FileServer user(&loop, InetAddress(port + 1), fd, fileSize, userTls);
+    FileServer kernel(&loop, InetAddress(port + 2), fd, fileSize, kernelTls);
+    plain.start();
+    user.start();
+    kernel.start();
+
+    std::thread thread([&]()
+                       {
+                           FileServer *servers[] = {&plain, &user, &kernel};
+                           const char *names[] = {"plain", "tls", "ktls"};
+                           for (int i = 0; i < 3; ++i)
+                           {
+                               auto start = std::chrono::steady_clock::now();
+                               size_t bytes = fetch(port + i, i == 0 ? nullptr : client.get());
+                               double sec = std::chrono::duration<double>(
+                                                std::chrono::steady_clock::now() - start)
+                                                .count();
+                               fprintf(stderr, "%-6s %10.1f MiB/s  server cpu %.3f s  ktls=%d\n",
+                                       names[i], bytes / sec / 1024 / 1024,
+                                       servers[i]->cpuSeconds(), servers[i]->kernelTls());
+                           }
+                           loop.quit();
+                       });
+    loop.loop();
+    thread.join();
+    ::close(fd);
+    return 0;
+}
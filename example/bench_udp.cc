@@ -0,0 +1,157 @@
+#include <mymuduo/UdpServer.h>
+#include <mymuduo/EventLoop.h>
+#include <mymuduo/Logger.h>
+
+#include <string>
+#include <thread>
+#include <chrono>
+#include <vector>
+#include <atomic>
+#include <iostream>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/udp.h>
+
+#ifndef SOL_UDP
+#define SOL_UDP 17
+#endif
+#ifndef UDP_SEGMENT
+#define UDP_SEGMENT 103
+#endif
+
+/****************
+ * loopback上UDP小包的接收能力:
+ * 服务器4个loop线程，每个线程一个SO_REUSEPORT socket；多个客户端线程各自用一个socket持续发64字节数据报
+ * batch=1:  服务器每次recvmmsg只收1个，客户端每个数据报一次sendto，相当于recvfrom/sendto
+ * batch=64: 服务器一次最多收64个，客户端一次sendmmsg发64个
+ * gro/gso:  服务器开启UDP_GRO，客户端用UDP_SEGMENT一次交给内核64个分段
+ * 输出服务器实际收到的包速和接收批次的平均大小，发送多于接收的部分是内核丢弃的(接收缓冲区满)
+ * 用法: ./bench_udp [每组秒数，默认2] [客户端线程数，默认4] [端口，默认9987] > /dev/null
+ * 结果输出到stderr
+ * *************/
+
+static const size_t kPayload = 64;
+static const int kClientBatch = 64;
+static const int kServerThreads = 4;
+
+enum Mode
+{
+    kSingle,
+    kBatch,
+    kGso,
+};
+
+static void runClient(uint16_t port, Mode mode, const std::atomic_bool &stop, std::atomic<uint64_t> &sent)
+{
+    int sockfd = ::socket(AF_INET, SOCK_DGRAM, 0);
+    sockaddr_in addr = *InetAddress(port).getSockAddr();
+    // connect之后源端口固定，内核按四元组把各客户端分发到不同的服务器socket
+    if (::connect(sockfd, (sockaddr *)&addr, sizeof addr) < 0)
+    {
+        perror("connect");
+        exit(1);
+    }
+    std::vector<char> payload(kPayload * kClientBatch, 'u');
+    std::vector<mmsghdr> msgs(kClientBatch);
+    std::vector<iovec> iovecs(kClientBatch);
+    for (int i = 0; i < kClientBatch; ++i)
+    {
+        iovecs[i].iov_base = &payload[i * kPayload];
+        iovecs[i].iov_len = kPayload;
+        ::memset(&msgs[i], 0, sizeof msgs[i]);
+        msgs[i].msg_hdr.msg_iov = &iovecs[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+    if (mode == kGso)
+    {
+        int segment = kPayload;
+        if (::setsockopt(sockfd, SOL_UDP, UDP_SEGMENT, &segment, sizeof segment) < 0)
+        {
+            perror("UDP_SEGMENT");
+            exit(1);
+        }
+    }
+
+    uint64_t count = 0;
+    while (!stop.load(std::memory_order_relaxed))
+    {
+        ssize_t n;
+        switch (mode)
+        {
+        case kSingle:
+            n = ::send(sockfd, payload.data(), kPayload, 0);
+            count += n > 0 ? 1 : 0;
+            break;
+        case kBatch:
+            n = ::sendmmsg(sockfd, msgs.data(), kClientBatch, 0);
+            count += n > 0 ? n : 0;
+            break;
+        case kGso:
+            n = ::send(sockfd, payload.data(), payload.size(), 0);
+            count += n > 0 ? kClientBatch : 0;
+            break;
+        }
+    }
+    sent += count;
+    ::close(sockfd);
+}
+
+static void runCase(EventLoop *loop, uint16_t port, Mode mode, double seconds, int clients)
+{
+    UdpSocket::Options options;
+    options.batchSize = mode == kSingle ? 1 : 64;
+    options.gro = mode == kGso;
+    UdpServer server(loop, InetAddress(port), "UdpBench", options);
+    server.setThreadNum(kServerThreads);
+    server.setBatchCallback([](UdpSocket *, const Datagram *, size_t, TimeStamp) {});
+    server.start();
+
+    std::atomic_bool stop(false);
+    std::atomic<uint64_t> sent(0);
+    std::vector<std::thread> threads;
+    for (int i = 0; i < clients; ++i)
+    {
+        threads.emplace_back(runClient, port, mode, std::cref(stop), std::ref(sent));
+    }
+    std::this_thread::sleep_for(std::chrono::duration<double>(seconds));
+    stop = true;
+    for (std::thread &t : threads)
+    {
+        t.join();
+    }
+    // 等服务器收完还在接收缓冲区里的数据
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    uint64_t received = 0;
+    uint64_t batches = 0;
+    for (const std::unique_ptr<UdpSocket> &socket : server.sockets())
+    {
+        received += socket->receivedPackets();
+        batches += socket->receivedBatches();
+    }
+    const char *names[] = {"batch=1", "batch=64", "gro/gso"};
+    fprintf(stderr, "%-9s %12.0f pps received, %6.1f datagrams/batch, %5.1f%% dropped%s\n",
+            names[mode], received / seconds,
+            batches ? static_cast<double>(received) / batches : 0.0,
+            sent ? 100.0 * (sent - std::min<uint64_t>(sent, received)) / sent : 0.0,
+            mode == kGso && !server.sockets()[0]->gro() ? " (GRO unsupported)" : "");
+}
+
+int main(int argc, char *argv[])
+{
+    double seconds = argc > 1 ? atof(argv[1]) : 2.0;
+    int clients = argc > 2 ? atoi(argv[2]) : 4;
+    uint16_t port = static_cast<uint16_t>(argc > 3 ? atoi(argv[3]) : 9987);
+    std::cout.setstate(std::ios::badbit);
+
+    // 各组的socket都在UdpServer自己的loop线程里，baseLoop不需要运行
+    EventLoop loop;
+    runCase(&loop, port, kSingle, seconds, clients);
+    runCase(&loop, port, kBatch, seconds, clients);
+    runCase(&loop, port, kGso, seconds, clients);
+    return 0;
+}
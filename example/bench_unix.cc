@@ -0,0 +1,138 @@
+#include <mymuduo/TcpServer.h>
+#include <mymuduo/Logger.h>
+
+#include <string>
+#include <functional>
+#include <thread>
+#include <chrono>
+#include <vector>
+#include <iostream>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+/****************
+ * 同一台机器上的pingpong，对比TCP loopback和Unix域socket(文件路径和抽象命名空间):
+ * 服务器把收到的数据原样发回，每个客户端线程一个连接，发出一条消息后等完整的回应再发下一条
+ * 输出每秒往返次数、平均往返延迟和吞吐
+ * 用法: ./bench_unix [每个连接的往返次数，默认20000] [连接数，默认4] [端口，默认9988] > /dev/null
+ * 结果输出到stderr
+ * *************/
+
+static void onConnection(const TcpConnectionPtr &conn)
+{
+    if (conn->connected())
+    {
+        conn->setTcpNoDelay(true); // Unix域socket上是空操作
+    }
+}
+
+static void onMessage(const TcpConnectionPtr &conn, Buffer *buf, TimeStamp)
+{
+    conn->send(buf);
+}
+
+static bool readFull(int fd, char *buf, size_t len)
+{
+    while (len > 0)
+    {
+        ssize_t n = ::read(fd, buf, len);
+        if (n <= 0)
+        {
+            return false;
+        }
+        buf += n;
+        len -= n;
+    }
+    return true;
+}
+
+static void pingpong(const InetAddress &addr, size_t size, long rounds)
+{
+    int sockfd = ::socket(addr.family(), SOCK_STREAM, 0);
+    if (::connect(sockfd, addr.sockAddr(), addr.sockAddrLen()) < 0)
+    {
+        perror("connect");
+        exit(1);
+    }
+    if (!addr.isUnix())
+    {
+        int on = 1;
+        ::setsockopt(sockfd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof on);
+    }
+    std::string message(size, 'p');
+    std::vector<char> reply(size);
+    for (long i = 0; i < rounds; ++i)
+    {
+        if (::write(sockfd, message.data(), size) != static_cast<ssize_t>(size) ||
+            !readFull(sockfd, reply.data(), size))
+        {
+            perror("pingpong");
+            exit(1);
+        }
+    }
+    ::close(sockfd);
+}
+
+static void runCase(const char *name, const InetAddress &addr, size_t size, long rounds, int connections)
+{
+    std::vector<std::thread> clients;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < connections; ++i)
+    {
+        clients.emplace_back(pingpong, std::cref(addr), size, rounds);
+    }
+    for (std::thread &t : clients)
+    {
+        t.join();
+    }
+    double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    double total = static_cast<double>(rounds) * connections;
+    fprintf(stderr, "%-9s %6zu bytes %10.0f round trips/s %8.1f us/rtt %10.1f MiB/s\n",
+            name, size, total / sec, sec * 1e6 / rounds, total * size / sec / 1024 / 1024);
+}
+
+int main(int argc, char *argv[])
+{
+    long rounds = argc > 1 ? atol(argv[1]) : 20000;
+    int connections = argc > 2 ? atoi(argv[2]) : 4;
+    uint16_t port = static_cast<uint16_t>(argc > 3 ? atoi(argv[3]) : 9988);
+    std::cout.setstate(std::ios::badbit);
+
+    const InetAddress addrs[] = {
+        InetAddress(port),
+        InetAddress::fromUnixPath("/tmp/mymuduo_bench_unix.sock"),
+        InetAddress::fromUnixPath("@mymuduo_bench_unix"),
+    };
+    const char *names[] = {"tcp", "unix", "abstract"};
+
+    EventLoop loop;
+    std::vector<std::unique_ptr<TcpServer>> servers;
+    for (const InetAddress &addr : addrs)
+    {
+        servers.emplace_back(new TcpServer(&loop, addr, "PingPong"));
+        servers.back()->setConnectionCallback(onConnection);
+        servers.back()->setMessageCallback(onMessage);
+        servers.back()->setThreadNum(connections);
+        servers.back()->start();
+    }
+
+    std::thread client([&]()
+                       {
+                           const size_t sizes[] = {64, 16384};
+                           for (size_t size : sizes)
+                           {
+                               for (int i = 0; i < 3; ++i)
+                               {
+                                   runCase(names[i], addrs[i], size, rounds, connections);
+                               }
+                           }
+                           loop.quit();
+                       });
+    loop.loop();
+    client.join();
+    return 0;
+}
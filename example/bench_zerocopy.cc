@@ -0,0 +1,168 @@
+#include <mymuduo/TcpServer.h>
+#include <mymuduo/Logger.h>
+
+#include <string>
+#include <functional>
+#include <thread>
+#include <chrono>
+#include <vector>
+#include <atomic>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+
+/****************
+ * 测量MSG_ZEROCOPY相对于普通拷贝发送的收益拐点:
+ * 对每种消息大小分别用拷贝和零拷贝方式通过loopback发送固定总量的数据，
+ * 统计吞吐和服务器loop线程消耗的CPU时间
+ * 注意loopback上内核最终仍会拷贝一次(完成通知带SO_EE_CODE_ZEROCOPY_COPIED)，
+ * 真实网卡上的拐点会更低
+ * 用法: ./bench_zerocopy [每组发送量MB，默认512] [端口，默认9982] > /dev/null
+ * 结果输出到stderr
+ * *************/
+
+static const size_t kBatchBytes = 4 * 1024 * 1024; // 每次写完成回调之后补充的数据量
+
+static double threadCpuSeconds()
+{
+    timespec ts;
+    ::clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+class StreamServer
+{
+public:
+    StreamServer(EventLoop *loop, const InetAddress &addr)
+        : server_(loop, addr, "StreamServer"),
+          messageSize_(0),
+          totalBytes_(0),
+          zeroCopy_(false),
+          sentBytes_(0),
+          cpuStart_(0),
+          cpuSeconds_(0)
+    {
+        server_.setConnectionCallback(
+            std::bind(&StreamServer::onConnection, this, std::placeholders::_1));
+        server_.setWriteCompleteCallback(
+            std::bind(&StreamServer::onWriteComplete, this, std::placeholders::_1));
+    }
+
+    void start() { server_.start(); }
+
+    // 由客户端线程在发起连接前设置
+    void setCase(size_t messageSize, size_t totalBytes, bool zeroCopy)
+    {
+        messageSize_ = messageSize;
+        totalBytes_ = totalBytes;
+        zeroCopy_ = zeroCopy;
+    }
+    double cpuSeconds() const { return cpuSeconds_; }
+
+private:
+    void onConnection(const TcpConnectionPtr &conn)
+    {
+        if (!conn->connected())
+        {
+            return;
+        }
+        // 阈值设为0，让每种大小都走选定的发送方式
+        conn->setZeroCopy(zeroCopy_, 0);
+        sentBytes_ = 0;
+        cpuStart_ = threadCpuSeconds();
+        sendBatch(conn);
+    }
+
+    void onWriteComplete(const TcpConnectionPtr &conn)
+    {
+        // 批次中直接写完的send也会触发写完成回调，只在数据全部发完时补充下一批
+        if (conn->pendingOutputBytes() > 0)
+        {
+            return;
+        }
+        if (sentBytes_ < totalBytes_)
+        {
+            sendBatch(conn);
+        }
+        else
+        {
+            cpuSeconds_ = threadCpuSeconds() - cpuStart_;
+            conn->shutdown();
+        }
+    }
+
+    void sendBatch(const TcpConnectionPtr &conn)
+    {
+        for (size_t batch = 0; batch < kBatchBytes && sentBytes_ < totalBytes_; batch += messageSize_)
+        {
+            conn->send(std::string(messageSize_, 'x'));
+            sentBytes_ += messageSize_;
+        }
+    }
+
+    TcpServer server_;
+    std::atomic<size_t> messageSize_;
+    std::atomic<size_t> totalBytes_;
+    std::atomic_bool zeroCopy_;
+    size_t sentBytes_;
+    double cpuStart_;
+    std::atomic<double> cpuSeconds_;
+};
+
+static size_t fetch(uint16_t port)
+{
+    int sockfd = ::socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr = *InetAddress(port).getSockAddr();
+    if (::connect(sockfd, (sockaddr *)&addr, sizeof addr) < 0)
+    {
+        perror("connect");
+        exit(1);
+    }
+    std::vector<char> buf(256 * 1024);
+    size_t total = 0;
+    ssize_t n;
+    while ((n = ::read(sockfd, buf.data(), buf.size())) > 0)
+    {
+        total += n;
+    }
+    ::close(sockfd);
+    return total;
+}
+
+int main(int argc, char *argv[])
+{
+    size_t totalBytes = (argc > 1 ? atol(argv[1]) : 512) * 1024 * 1024;
+    uint16_t port = static_cast<uint16_t>(argc > 2 ? atoi(argv[2]) : 9982);
+
+    EventLoop loop;
+    StreamServer server(&loop, InetAddress(port));
+    server.start();
+
+    std::thread client([&]()
+                       {
+                           const size_t sizes[] = {4096, 16384, 32768, 65536, 262144, 1048576};
+                           fprintf(stderr, "%10s %10s %12s %12s\n", "size", "mode", "MiB/s", "server cpu s");
+                           for (size_t size : sizes)
+                           {
+                               for (int zeroCopy = 0; zeroCopy < 2; ++zeroCopy)
+                               {
+                                   server.setCase(size, totalBytes, zeroCopy == 1);
+                                   auto start = std::chrono::steady_clock::now();
+                                   size_t bytes = fetch(port);
+                                   double sec = std::chrono::duration<double>(
+                                                    std::chrono::steady_clock::now() - start)
+                                                    .count();
+                                   fprintf(stderr, "%10zu %10s %12.1f %12.3f\n", size,
+                                           zeroCopy ? "zerocopy" : "copy",
+                                           bytes / sec / 1024 / 1024, server.cpuSeconds());
+                               }
+                           }
+                           loop.quit();
+                       });
+    loop.loop();
+    client.join();
+    return 0;
+}
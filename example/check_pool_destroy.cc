@@ -0,0 +1,82 @@
+#include <mymuduo/TcpConnectionPool.h>
+#include <mymuduo/TcpServer.h>
+#include <mymuduo/TcpConnection.h>
+#include <mymuduo/Logger.h>
+
+#include <memory>
+#include <stdio.h>
+
+/****************
+ * 析构一个既有空闲连接、又有连接已经交给调用者的TcpConnectionPool:
+ * 空闲连接由TcpClient析构时关闭，交出去的连接在池析构之后再由调用者关闭，
+ * 两种关闭都不能回调到已经析构的池
+ * 用AddressSanitizer编译运行才能发现释放后使用: make check_pool_destroy_asan && ./check_pool_destroy_asan
+ * 成功时输出OK并返回0
+ * *************/
+
+static const uint16_t kPort = 9957;
+static const size_t kMinIdle = 3;
+
+int main()
+{
+    Logger::setLogLevel(ERROR);
+    EventLoop loop;
+    TcpServer server(&loop, InetAddress(kPort), "PoolUpstream");
+    server.setConnectionCallback([](const TcpConnectionPtr &) {});
+    server.start();
+
+    std::unique_ptr<TcpConnectionPool> pool(
+        new TcpConnectionPool(&loop, InetAddress(kPort), "Pool", kMinIdle, kMinIdle));
+    pool->start();
+
+    bool ok = true;
+    int step = 0;
+    int ticks = 0;
+    TcpConnectionPtr borrowed;
+    loop.runEvery(0.001, [&]()
+                  {
+                      if (++ticks > 5000)
+                      {
+                          fprintf(stderr, "FAIL: timeout at step %d\n", step);
+                          ok = false;
+                          loop.quit();
+                          return;
+                      }
+                      switch (step)
+                      {
+                      case 0: // 等所有连接建立，借走一条
+                          if (pool->idleConnections() == kMinIdle)
+                          {
+                              borrowed = pool->tryAcquire();
+                              ++step;
+                          }
+                          break;
+                      case 1: // 池里还剩两条空闲连接，析构池
+                          pool.reset();
+                          ++step;
+                          break;
+                      case 2: // 空闲连接的关闭已经处理完，再关闭借走的那条
+                          borrowed->forceClose();
+                          ++step;
+                          break;
+                      case 3: // 描述符随最后一个引用一起关闭，之后服务器才看到连接断开
+                          if (!borrowed->connected())
+                          {
+                              borrowed.reset();
+                              ++step;
+                          }
+                          break;
+                      case 4:
+                          if (server.numConnections() == 0)
+                          {
+                              loop.quit();
+                          }
+                          break;
+                      }
+                  });
+    loop.loop();
+
+    fprintf(stderr, "%s: pool destroyed with %zu idle and 1 borrowed connection\n", ok ? "OK" : "FAIL",
+            kMinIdle - 1);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,172 @@
+#include <mymuduo/TcpConnection.h>
+#include <mymuduo/EventLoop.h>
+#include <mymuduo/Logger.h>
+
+#include <string>
+#include <functional>
+#include <algorithm>
+#include <utility>
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+
+/****************
+ * 高水位线回调与读端流量控制(setBackpressureSource)互不干扰:
+ *   1. 高水位线回调在用户设置的64K触发，而不是流量控制的1M
+ *   2. 待发送数据回落到64K以下(没有清空)之后再次越过，回调第二次
+ *   3. 越过1M时暂停读，高水位线回调不再触发；对端读空之后恢复读
+ * 服务端连接直接用TcpConnection包装一对本机TCP socket，对端在loop线程中用非阻塞的recv一点一点读取
+ * 用法: ./check_watermarks，成功时输出OK并返回0
+ * *************/
+
+static const size_t kHighWaterMark = 64 * 1024;
+static const size_t kBackpressureHigh = 1024 * 1024;
+static const size_t kBackpressureLow = 256 * 1024;
+
+static bool g_ok = true;
+
+static void expect(bool cond, const char *what)
+{
+    if (!cond)
+    {
+        fprintf(stderr, "FAIL: %s\n", what);
+        g_ok = false;
+    }
+}
+
+// 返回已经连接的一对socket，first交给TcpConnection(非阻塞)，second由测试读取
+static std::pair<int, int> tcpPair()
+{
+    int listenfd = ::socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr = *InetAddress(0, "127.0.0.1").getSockAddr();
+    socklen_t len = sizeof addr;
+    if (::bind(listenfd, (sockaddr *)&addr, sizeof addr) < 0 || ::listen(listenfd, 1) < 0 ||
+        ::getsockname(listenfd, (sockaddr *)&addr, &len) < 0)
+    {
+        perror("listen");
+        exit(1);
+    }
+    int peer = ::socket(AF_INET, SOCK_STREAM, 0);
+    // 收发两端的内核缓冲区都设小，待发送数据大部分留在用户态的缓冲区里
+    int small = 4096;
+    ::setsockopt(peer, SOL_SOCKET, SO_RCVBUF, &small, sizeof small);
+    if (::connect(peer, (sockaddr *)&addr, sizeof addr) < 0)
+    {
+        perror("connect");
+        exit(1);
+    }
+    int conn = ::accept4(listenfd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    ::setsockopt(conn, SOL_SOCKET, SO_SNDBUF, &small, sizeof small);
+    ::close(listenfd);
+    return std::make_pair(conn, peer);
+}
+
+// 从对端最多读n个字节，不阻塞
+static size_t drain(int fd, size_t n)
+{
+    char buf[4096];
+    size_t total = 0;
+    while (total < n)
+    {
+        ssize_t r = ::recv(fd, buf, std::min(sizeof buf, n - total), MSG_DONTWAIT);
+        if (r <= 0)
+        {
+            break;
+        }
+        total += r;
+    }
+    return total;
+}
+
+int main()
+{
+    Logger::setLogLevel(ERROR);
+    EventLoop loop;
+    std::pair<int, int> fds = tcpPair();
+    TcpConnectionPtr conn(new TcpConnection(&loop, "watermarks", fds.first, InetAddress(), InetAddress()));
+
+    int highWaterHits = 0;
+    size_t firstHitLen = 0;
+    conn->setConnectionCallback([](const TcpConnectionPtr &) {});
+    conn->setMessageCallback([](const TcpConnectionPtr &, Buffer *buf, TimeStamp) { buf->retrieveAll(); });
+    conn->setHighWaterMarkCallback([&](const TcpConnectionPtr &, size_t len)
+                                   {
+                                       if (++highWaterHits == 1)
+                                       {
+                                           firstHitLen = len;
+                                       }
+                                   },
+                                   kHighWaterMark);
+    conn->setBackpressureSource(conn, kBackpressureHigh, kBackpressureLow);
+    conn->connectEstablished();
+
+    // 每毫秒推进一步，每一步都等上一步的发送/回调在loop中处理完
+    int step = 0;
+    int ticks = 0;
+    loop.runEvery(0.001, [&]()
+                  {
+                      if (++ticks > 10000)
+                      {
+                          fprintf(stderr, "FAIL: timeout at step %d, pending %zu\n", step, conn->pendingOutputBytes());
+                          g_ok = false;
+                          loop.quit();
+                          return;
+                      }
+                      switch (step)
+                      {
+                      case 0: // 越过64K
+                          conn->send(std::string(256 * 1024, 'a'));
+                          ++step;
+                          break;
+                      case 1:
+                          expect(highWaterHits == 1, "high water callback on first crossing");
+                          expect(firstHitLen >= kHighWaterMark && firstHitLen < kBackpressureHigh,
+                                 "high water callback uses the user's mark");
+                          expect(conn->isReading(), "reading not paused below the backpressure mark");
+                          ++step;
+                          break;
+                      case 2: // 一点一点读，让待发送数据回落到64K以下但不清空
+                          if (conn->pendingOutputBytes() >= kHighWaterMark / 2)
+                          {
+                              drain(fds.second, 4096);
+                              break;
+                          }
+                          expect(conn->pendingOutputBytes() > 0, "pending output not drained to zero");
+                          conn->send(std::string(128 * 1024, 'b'));
+                          ++step;
+                          break;
+                      case 3:
+                          expect(highWaterHits == 2, "high water callback on second crossing");
+                          conn->send(std::string(kBackpressureHigh, 'c'));
+                          ++step;
+                          break;
+                      case 4:
+                          expect(!conn->isReading(), "reading paused above the backpressure mark");
+                          expect(highWaterHits == 2, "no high water callback without a new crossing");
+                          ++step;
+                          break;
+                      case 5: // 读空，回落到256K以下时恢复读
+                          drain(fds.second, 1024 * 1024);
+                          if (conn->pendingOutputBytes() == 0)
+                          {
+                              ++step;
+                          }
+                          break;
+                      case 6:
+                          expect(conn->isReading(), "reading resumed below the backpressure low mark");
+                          loop.quit();
+                          break;
+                      }
+                  });
+    loop.loop();
+
+    conn->connectDestroyed();
+    conn.reset();
+    ::close(fds.second);
+    fprintf(stderr, "%s: %d high water callbacks\n", g_ok ? "OK" : "FAIL", highWaterHits);
+    return g_ok ? 0 : 1;
+}
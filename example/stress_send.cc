@@ -0,0 +1,211 @@
+#include <mymuduo/TcpServer.h>
+#include <mymuduo/Logger.h>
+
+#include <string>
+#include <functional>
+#include <thread>
+#include <vector>
+#include <atomic>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+
+/****************
+ * 32个生产者线程同时对同一个连接调用send，覆盖跨线程发送的各个重载:
+ * send(std::string &&)、send(std::vector<char> &&)、send(Buffer *)和send(const std::string &)
+ * 客户端校验每个生产者的消息按序完整到达
+ * 用ThreadSanitizer编译运行: make stress_send_tsan && ./stress_send_tsan > /dev/null
+ * *************/
+
+static const int kProducers = 32;
+static const int kMessagesPerProducer = 2000;
+static const size_t kHeaderLen = 12; // producer + seq + len，各4字节
+
+static size_t messageLen(int seq)
+{
+    // 覆盖小块拷贝和大块接管两条路径
+    return (seq * 7919) % 20000 + 1;
+}
+
+static char messageByte(int producer, int seq, size_t i)
+{
+    return static_cast<char>(producer + seq + i);
+}
+
+static void fillMessage(char *out, int producer, int seq, size_t len)
+{
+    uint32_t header[3] = {static_cast<uint32_t>(producer), static_cast<uint32_t>(seq),
+                          static_cast<uint32_t>(len)};
+    ::memcpy(out, header, kHeaderLen);
+    for (size_t i = 0; i < len; ++i)
+    {
+        out[kHeaderLen + i] = messageByte(producer, seq, i);
+    }
+}
+
+static void produce(const TcpConnectionPtr &conn, int producer)
+{
+    for (int seq = 0; seq < kMessagesPerProducer; ++seq)
+    {
+        size_t len = messageLen(seq);
+        switch (seq % 4)
+        {
+        case 0:
+        {
+            std::string msg(kHeaderLen + len, '\0');
+            fillMessage(&msg[0], producer, seq, len);
+            conn->send(std::move(msg));
+            break;
+        }
+        case 1:
+        {
+            std::vector<char> msg(kHeaderLen + len);
+            fillMessage(msg.data(), producer, seq, len);
+            conn->send(std::move(msg));
+            break;
+        }
+        case 2:
+        {
+            Buffer msg;
+            msg.ensureWriteAbleBytes(kHeaderLen + len);
+            fillMessage(msg.beginWrite(), producer, seq, len);
+            msg.hasWritten(kHeaderLen + len);
+            conn->send(&msg);
+            break;
+        }
+        default:
+        {
+            // 调用返回后立即析构，验证const引用版本不会引用到已释放的内存
+            std::string msg(kHeaderLen + len, '\0');
+            fillMessage(&msg[0], producer, seq, len);
+            conn->send(msg);
+            break;
+        }
+        }
+    }
+}
+
+class StressServer
+{
+public:
+    StressServer(EventLoop *loop, const InetAddress &addr)
+        : server_(loop, addr, "StressServer")
+    {
+        server_.setConnectionCallback(
+            std::bind(&StressServer::onConnection, this, std::placeholders::_1));
+    }
+    ~StressServer()
+    {
+        if (coordinator_.joinable())
+        {
+            coordinator_.join();
+        }
+    }
+
+    void start() { server_.start(); }
+
+private:
+    void onConnection(const TcpConnectionPtr &conn)
+    {
+        if (!conn->connected())
+        {
+            return;
+        }
+        // 不能阻塞loop线程，由单独的线程启动生产者并在它们结束后关闭连接
+        coordinator_ = std::thread([conn]()
+                                   {
+                                       std::vector<std::thread> producers;
+                                       for (int i = 0; i < kProducers; ++i)
+                                       {
+                                           producers.emplace_back(produce, conn, i);
+                                       }
+                                       for (std::thread &t : producers)
+                                       {
+                                           t.join();
+                                       }
+                                       conn->shutdown();
+                                   });
+    }
+
+    TcpServer server_;
+    std::thread coordinator_;
+};
+
+// 读完全部数据并校验，返回是否通过
+static bool verify(uint16_t port)
+{
+    int sockfd = ::socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr = *InetAddress(port).getSockAddr();
+    if (::connect(sockfd, (sockaddr *)&addr, sizeof addr) < 0)
+    {
+        perror("connect");
+        return false;
+    }
+
+    std::vector<int> nextSeq(kProducers, 0);
+    Buffer input;
+    int saveErrno = 0;
+    ssize_t n;
+    long messages = 0;
+    while ((n = input.readFd(sockfd, &saveErrno)) > 0)
+    {
+        while (input.readAbleBytes() >= kHeaderLen)
+        {
+            uint32_t header[3];
+            ::memcpy(header, input.peek(), kHeaderLen);
+            if (input.readAbleBytes() < kHeaderLen + header[2])
+            {
+                break;
+            }
+            int producer = header[0];
+            int seq = header[1];
+            if (producer >= kProducers || seq != nextSeq[producer] || header[2] != messageLen(seq))
+            {
+                fprintf(stderr, "FAIL: producer %d seq %d (expect %d) len %u\n",
+                        producer, seq, producer < kProducers ? nextSeq[producer] : -1, header[2]);
+                ::close(sockfd);
+                return false;
+            }
+            const char *body = input.peek() + kHeaderLen;
+            for (size_t i = 0; i < header[2]; ++i)
+            {
+                if (body[i] != messageByte(producer, seq, i))
+                {
+                    fprintf(stderr, "FAIL: producer %d seq %d corrupted at byte %zu\n", producer, seq, i);
+                    ::close(sockfd);
+                    return false;
+                }
+            }
+            ++nextSeq[producer];
+            ++messages;
+            input.retrieve(kHeaderLen + header[2]);
+        }
+    }
+    ::close(sockfd);
+
+    bool ok = messages == static_cast<long>(kProducers) * kMessagesPerProducer && input.readAbleBytes() == 0;
+    fprintf(stderr, "%s: %ld messages from %d producers\n", ok ? "OK" : "FAIL", messages, kProducers);
+    return ok;
+}
+
+int main(int argc, char *argv[])
+{
+    uint16_t port = static_cast<uint16_t>(argc > 1 ? atoi(argv[1]) : 9983);
+
+    EventLoop loop;
+    StressServer server(&loop, InetAddress(port));
+    server.start();
+
+    std::atomic_bool ok(false);
+    std::thread client([&]()
+                       {
+                           ok = verify(port);
+                           loop.quit();
+                       });
+    loop.loop();
+    client.join();
+    return ok ? 0 : 1;
+}